@@ -8,8 +8,16 @@
  * delete the block and then insert the new block. A smart replace_block() could avoid all the
  * deallocation and reallocation of the EditList nodes.
  *
- * The current version of insert_block() leaves its parameter alone. If the function was able to
- * remove lines from the parameter the copying of the EditBuffers would not be necessary.
+ * The functions insert_block() and get_block() leave their source alone and so must copy the
+ * lines. However, get_block() gathers any text that is not already shared into a single
+ * TextBlock, so the copies it makes (and any copies of those copies) share their text. The
+ * functions take_block() and extract_block() move lines between the file and the EditList
+ * without copying anything.
+ *
+ * Whole ranges of lines are moved into or out of the file data with EditList::splice(), so the
+ * cost of restructuring the file's line list does not depend on the size of the block. In
+ * particular, delete_block() splices the block into a temporary list and lets that list delete
+ * the lines.
  */
 
 #include <cstddef>
@@ -17,6 +25,7 @@
 #include "BlockEditFile.hpp"
 #include "EditBuffer.hpp"
 #include "support.hpp"
+#include "TextBlock.hpp"
 
 /*=====================================================================*/
 /*           Public Member Functions of Class Block_EditFile          */
@@ -75,6 +84,19 @@ bool BlockEditFile::get_block( EditList &result )
     // Get the current block extent.
     block_limits( top, bottom );
 
+    // Find out how much of the block's text is not already shared.
+    std::size_t total = 0;
+    long        line_number = top;
+    file_data.jump_to( top );
+    while( ( line = file_data.next( ) ) != NULL  &&  line_number++ <= bottom ) {
+        if( !line->is_borrowed( ) ) total += line->length( );
+    }
+
+    // Gather that text into one block that the copies can share. Without a block, the text of
+    // each line is copied separately.
+    TextBlock  *shared = ( total == 0 ) ? NULL : TextBlock::make( total );
+    std::size_t offset = 0;
+
     // Position the main EditList to the top line (lower line number).
     file_data.jump_to( top );
 
@@ -82,10 +104,20 @@ bool BlockEditFile::get_block( EditList &result )
     while( !abort  &&  ( line = file_data.next( ) ) != NULL  &&  top <= bottom ) {
 
         // Make a copy of the line and insert it into the parameter.
-        EditBuffer *new_copy = new EditBuffer( *line );
+        EditBuffer *new_copy;
+        const std::size_t length = line->length( );
+        if( shared != NULL  &&  !line->is_borrowed( )  &&  length != 0 ) {
+            line->copy( shared->data( ) + offset, length );
+            new_copy = new EditBuffer( shared, offset, length );
+            offset += length;
+        }
+        else {
+            new_copy = new EditBuffer( *line );
+        }
         if( result.insert(new_copy) == NULL ) abort = true;
         top++;
     }
+    if( shared != NULL ) shared->release( );
 
     // If we didn't get all the lines (ran out of list), insert blanks.
     while( !abort  &&  top <= bottom ) {
@@ -102,6 +134,43 @@ bool BlockEditFile::get_block( EditList &result )
 }
 
 
+//! Move the current block to a temporary storage area.
+/*!
+ * This function has the same effect as get_block() followed by delete_block() except that the
+ * lines are moved into the specified EditList rather than copied. This function does not turn
+ * block mode off; the caller must do so.
+ *
+ * \param result [in-out] The edit list that will receive the lines of the current block. Note
+ * that the initial contents of the given EditList are not erased by this operation. The block
+ * is inserted at the list's current point.
+ */
+bool BlockEditFile::extract_block( EditList &result )
+{
+    long top, bottom;    // Block limits.
+
+    // Get the current block extent.
+    block_limits( top, bottom );
+
+    // Removing real lines will mark the object as changed.
+    if( top < file_data.size( ) ) is_changed = true;
+
+    // Move the lines in the block. Only the lines that exist are moved.
+    const long old_size = result.size( );
+    journal_delete( top, bottom - top + 1 );
+    file_data.jump_to( top );
+    result.splice( file_data, bottom - top + 1 );
+
+    // If we didn't get all the lines (ran out of list), insert blanks.
+    for( long current = top + result.size( ) - old_size; current <= bottom; current++ ) {
+        result.insert( new EditBuffer );
+    }
+
+    // Make sure the current point is at the line number of the block's top.
+    current_point.jump_to_line( top );
+    return true;
+}
+
+
 //! Delete the current block.
 /*!
  * This function deletes the currently active block (or the current line if there is no active
@@ -109,7 +178,8 @@ bool BlockEditFile::get_block( EditList &result )
  */
 void BlockEditFile::delete_block( )
 {
-    long top, current, bottom;    // Block limits and current line number.
+    long     top, bottom;    // Block limits.
+    EditList trash;          // Receives the lines of the block.
 
     // Get the current block extent.
     block_limits( top, bottom );
@@ -117,15 +187,11 @@ void BlockEditFile::delete_block( )
     // Deleting a real lines will mark the object as changed.
     if( top < file_data.size( ) ) is_changed = true;
 
-    // Position the data to the top line.
+    // Move the block out of the file in one step. Stops if we go off the end. The lines are
+    // deleted when trash is destroyed.
+    journal_delete( top, bottom - top + 1 );
     file_data.jump_to( top );
-
-    // For each line in the block trash that line. Stop if we go off the end.
-    for( current = top; current <= bottom; current++ ) {
-        if( file_data.get( ) == NULL ) break;
-        delete file_data.get( );
-        file_data.erase( );
-    }
+    trash.splice( file_data, bottom - top + 1 );
 
     // Make sure the current point is at the line number of the block's top.
     current_point.jump_to_line( top );
@@ -142,7 +208,7 @@ void BlockEditFile::delete_block( )
  * exists (if the current line is not line 0).
  *
  * \bug There is a memory leak if allocating a new line succeeds but inserting that line into
- * the file data fails.
+ * the list of copies fails.
  *
  * \param new_stuff The EditList to insert.
  * \return false if the insertion fails for some reason (out of memory?); true otherwise.
@@ -151,6 +217,7 @@ bool BlockEditFile::insert_block( EditList &new_stuff )
 {
     bool        abort = false;  // Assume it will work.
     EditBuffer *line;           // Points at a line in the block.
+    EditList    copies;         // Copies of the lines, spliced into the file all at once.
 
     // Insertions always change this object if there's something coming in.
     if( new_stuff.size( ) > 0L ) is_changed = true;
@@ -165,11 +232,17 @@ bool BlockEditFile::insert_block( EditList &new_stuff )
     // While there are still lines in the parameter.
     while( !abort && ( line = new_stuff.next( ) ) != NULL ) {
 
-        // Build a new copy of the line and stuff it into this object.
+        // Build a new copy of the line.
         EditBuffer *new_copy = new EditBuffer( *line );
-        if( file_data.insert( new_copy ) == NULL) abort = true;
+        if( copies.insert( new_copy ) == NULL) abort = true;
     }
 
+    // Stuff the copies that were made into this object.
+    const long copy_count = copies.size( );
+    copies.jump_to( 0 );
+    file_data.splice( copies, copy_count );
+    journal_insert( current_point.cursor_line( ), copy_count );
+
     if( abort ) {
         memory_message( "Can't insert entire block into file" );
     }
@@ -180,3 +253,30 @@ bool BlockEditFile::insert_block( EditList &new_stuff )
 
     return !abort;
 }
+
+
+//! Insert block above current point, taking ownership of its lines.
+/*!
+ * This function is like insert_block() except that the lines are moved out of the parameter
+ * rather than copied. The parameter is left empty.
+ *
+ * \param new_stuff The EditList to insert.
+ * \return false if the insertion fails for some reason (out of memory?); true otherwise.
+ */
+bool BlockEditFile::take_block( EditList &new_stuff )
+{
+    const long count = new_stuff.size( );
+
+    // Insertions always change this object if there's something coming in.
+    if( count > 0L ) is_changed = true;
+
+    // Adjust the internal list. Make sure the current line exists.
+    if( !extend_to_line( current_point.cursor_line( ) ) ) return false;
+    file_data.jump_to( current_point.cursor_line( ) );
+    file_data.take( new_stuff );
+    journal_insert( current_point.cursor_line( ), count );
+
+    // Jump down to just past the end of new stuff.
+    current_point.jump_to_line( current_point.cursor_line( ) + count );
+    return true;
+}
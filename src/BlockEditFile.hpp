@@ -38,8 +38,10 @@ public:
     void set_blockinfo( const BlockInfo & );
     void toggle_block( );
     bool get_block( EditList & );
+    bool extract_block( EditList & );
     void delete_block( );
     bool insert_block( EditList & );
+    bool take_block( EditList & );
 };
 
 #endif
@@ -56,6 +56,7 @@ bool CharacterEditFile::new_line()
         file_data.next( );
         if( blank == NULL ) return_value = false;
             else return_value = static_cast< bool >( file_data.insert( blank ) != NULL );
+        if( return_value ) journal_insert( current_point.cursor_line( ) + 1, 1 );
     }
     else {
         // Otherwise, transfer text to next line.
@@ -73,6 +74,8 @@ bool CharacterEditFile::new_line()
             // Now, delete the text on the old line only if the above worked.
             if( return_value != false ) {
                 file_data.get( )->trim( current_point.cursor_column( ) );
+                journal_change( current_point.cursor_line( ), file_data.get( ) );
+                journal_insert( current_point.cursor_line( ) + 1, 1 );
             }
         }
     }
@@ -111,6 +114,7 @@ bool CharacterEditFile::insert_char( char letter )
     // Loop over all lines in the block, inserting as we go.
     while( top++ <= Bottom && return_value == true ) {
         file_data.get( )->insert( letter, current_point.cursor_column( ) );
+        journal_change( file_data.current_index( ), file_data.get( ) );
         file_data.next( );
     }
 
@@ -149,6 +153,7 @@ bool CharacterEditFile::replace_char( char letter )
     while( top++ <= bottom && return_value == true ) {
         new_letter   = letter;
         file_data.get( )->replace( new_letter, current_point.cursor_column( ) );
+        journal_change( file_data.current_index( ), file_data.get( ) );
         file_data.next( );
     }
 
@@ -187,7 +192,9 @@ bool CharacterEditFile::backspace( )
             if( current != NULL ) {
                 file_data.previous( );
                 file_data.get( )->append( *current );
+                journal_change( file_data.current_index( ), file_data.get( ) );
                 file_data.next( );
+                journal_delete( file_data.current_index( ), 1 );
                 delete current;
                 file_data.erase( );
             }
@@ -209,6 +216,7 @@ bool CharacterEditFile::backspace( )
         // Loop over all lines in the block, backspacing as we go.
         while( top++ <= bottom && file_data.get( ) != NULL ) {
             file_data.get( )->erase( current_point.cursor_column( ) - 1 );
+            journal_change( file_data.current_index( ), file_data.get( ) );
             file_data.next( );
         }
     }
@@ -246,11 +254,13 @@ bool CharacterEditFile::delete_char()
         file_data.next( );
         if( file_data.get( ) != NULL && return_value != false ) {
             Current->append( *file_data.get( ) );
+            journal_delete( file_data.current_index( ), 1 );
             if( return_value != false ) file_data.erase( );
         }
 
         // Delete extra character introduced in the replace action.
         Current->erase( current_point.cursor_column( ) );
+        journal_change( current_point.cursor_line( ), Current );
     }
 
     // Otherwise try to do the delete for the whole block (or line).
@@ -269,6 +279,7 @@ bool CharacterEditFile::delete_char()
         while( return_value == true && top++ <= bottom && file_data.get( ) != NULL ) {
             return_value =
                 static_cast< bool >( file_data.get( )->erase( current_point.cursor_column( ) ) != '\0' );
+            journal_change( file_data.current_index( ), file_data.get( ) );
             file_data.next( );
         }
     }
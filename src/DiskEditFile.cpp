@@ -3,139 +3,1409 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "environ.hpp"
 
-#if eOPSYS != ePOSIX
+#if eOPSYS == ePOSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
 #include <dos.h>
 #endif
 
 #include "DiskEditFile.hpp"
 #include "EditBuffer.hpp"
 #include "FileNameMatcher.hpp"
+#include "Journal.hpp"
 #include "MessageWindow.hpp"
+#include "scan.hpp"
 #include "scr.hpp"
 #include "support.hpp"
+#include "TextBlock.hpp"
 
 /*=======================================*/
 /*           Support Functions           */
 /*=======================================*/
 
-static bool write_line( EditBuffer *line, std::FILE *disk )
+//! Writes raw bytes to a file, bypassing the file's stdio buffer where possible.
+/*!
+ * \return false if the write fails.
+ */
+static bool write_bytes( std::FILE *disk, const char *data, std::size_t count )
+{
+    #if eOPSYS == ePOSIX
+    const int descriptor = fileno( disk );
+    while( count > 0 ) {
+        const ssize_t written = ::write( descriptor, data, count );
+        if( written < 0 ) {
+            if( errno == EINTR ) continue;
+            return false;
+        }
+        data  += written;
+        count -= static_cast< std::size_t >( written );
+    }
+    return true;
+    #else
+    return( std::fwrite( data, 1, count, disk ) == count );
+    #endif
+}
+
+
+//! Collects lines of text into large chunks for writing to a file.
+/*!
+ * Each line is copied into the chunk, trailing spaces are dropped, and a newline is added. When
+ * the chunk is full it is written with one system call. Lines longer than a chunk enlarge it.
+ */
+class LineWriter {
+public:
+    explicit LineWriter( std::FILE *disk );
+    bool put_line( const EditBuffer &line );
+    bool flush( );
+
+private:
+    static const std::size_t chunk_size = 256 * 1024;
+
+    std::FILE          *disk;    //!< The file being written.
+    std::vector< char > chunk;   //!< Text waiting to be written.
+    std::size_t         used;    //!< Number of bytes of chunk in use.
+    bool                failed;  //!< True if any write has failed.
+};
+
+
+LineWriter::LineWriter( std::FILE *disk ) :
+    disk  ( disk ),
+    chunk ( chunk_size ),
+    used  ( 0 ),
+    failed( false )
+{
+    // Anything already written through stdio must go out first.
+    if( std::fflush( disk ) != 0 ) failed = true;
+}
+
+
+//! Adds a line to the chunk, writing the chunk first if the line will not fit.
+/*!
+ * \return false if a write has failed.
+ */
+bool LineWriter::put_line( const EditBuffer &line )
+{
+    const std::size_t length = line.length( );
+    if( chunk.size( ) - used < length + 1 ) {
+        flush( );
+        if( chunk.size( ) < length + 1 ) chunk.resize( length + 1 );
+    }
+
+    char *const text = chunk.data( ) + used;
+    line.copy( text, length );
+    char *const end = const_cast< char * >( find_trailing_spaces( text, text + length ) );
+    *end = '\n';
+    used = ( end + 1 ) - chunk.data( );
+    return !failed;
+}
+
+
+//! Writes the text in the chunk to the file.
+/*!
+ * \return false if this or any earlier write has failed.
+ */
+bool LineWriter::flush( )
+{
+    if( !failed  &&  used > 0  &&  !write_bytes( disk, chunk.data( ), used ) ) failed = true;
+    used = 0;
+    return !failed;
+}
+
+
+//! Reads the rest of a file into a new TextBlock.
+/*!
+ * The size of the file is determined first so that the text can normally be read with a single
+ * operation. If the size can't be determined (or if the file grows while it is being read),
+ * the block is enlarged as necessary.
+ *
+ * \param disk The file to read.
+ * \return A pointer to a block holding the text or NULL if there is insufficient memory. The
+ * caller owns the only reference to the block.
+ */
+static TextBlock *read_block( std::FILE *disk )
 {
-    int result = 0;    // Result of a disk write operation.
-    int space_count;   // Number of spaces found so far.
+    std::size_t expected = 0;
+    const long start = std::ftell( disk );
+    if( start >= 0  &&  std::fseek( disk, 0, SEEK_END ) == 0 ) {
+        const long end = std::ftell( disk );
+        if( end > start ) expected = static_cast< std::size_t >( end - start );
+        std::fseek( disk, start, SEEK_SET );
+    }
 
-    space_count = 0;
+    // Ask for one extra byte so that a short read confirms the end of the file was reached.
+    TextBlock *const block = TextBlock::make( expected + 1 );
+    if( block == NULL ) return NULL;
 
-    // For each character on that line...
-    for( std::size_t offset = 0; result != EOF  &&  offset < line->length( ); offset++ ) {
+    std::size_t count = std::fread( block->data( ), 1, block->size( ), disk );
+    while( count == block->size( ) ) {
+        if( !block->resize( 2 * block->size( ) + 4096 ) ) {
+            block->release( );
+            return NULL;
+        }
+        count += std::fread( block->data( ) + count, 1, block->size( ) - count, disk );
+    }
+    block->resize( count );
+    return( block );
+}
 
-        // Don't print spaces yet.. may be nothing else on line.
-        if( (*line)[offset] == ' ' ) space_count++;
+
+//! Creates a line from text that needs cooking.
+/*!
+ * Non-ASCII characters are ignored (note that control characters are still processed). Tabs are
+ * expanded assuming 8 column tab stops.
+ *
+ * \param workspace Scratch space for the cooked text. It is reused from line to line so that
+ * cooking a line normally allocates only the storage of the new line itself.
+ */
+static EditBuffer *cook_line( const char *text, std::size_t length, std::string &workspace )
+{
+    cook_text( text, length, workspace );
+    return new EditBuffer( workspace.data( ), workspace.size( ) );
+}
+
+
+//! Makes the lines in part of a TextBlock and adds them to a list.
+/*!
+ * The part must start at the beginning of a line. Each line is added before the list's current
+ * point. If the part doesn't end with a newline, its last line is the last line of the file;
+ * it is added only if it isn't empty. Lines that need no processing borrow their text from the
+ * block.
+ *
+ * \param block The block holding the text.
+ * \param first The offset in the block of the first byte of the part.
+ * \param last The offset in the block just past the last byte of the part.
+ * \param lines The list to receive the lines.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+static void parse_lines( TextBlock *block, std::size_t first, std::size_t last, EditList &lines )
+{
+    const char *const text   = block->data( );
+    const char *const finish = text + last;
+    const char       *start  = text + first;
+    std::string       workspace;
+
+    while( start < finish ) {
+        const char *end = find_line_special( start, finish );
+
+        // If the line needs processing, just find its end.
+        const bool raw = ( end != finish  &&  *end != '\n' );
+        if( raw ) {
+            end = static_cast< const char * >( std::memchr( end, '\n', finish - end ) );
+            if( end == NULL ) end = finish;
+        }
+
+        EditBuffer *new_line;
+        if( raw ) {
+            new_line = cook_line( start, end - start, workspace );
+        }
         else {
+            new_line = new EditBuffer( block, start - text, end - start );
+        }
+
+        // Install the line. The last partial line is only installed if it isn't empty.
+        if( end == finish  &&  new_line->length( ) == 0 ) {
+            delete new_line;
+        }
+        else lines.insert( new_line );
+
+        start = end + 1;
+    }
+}
 
-            // Print any pending spaces.
-            for( int i = 0; result != EOF  &&  i < space_count; i++ ) {
-                result = std::putc(' ', disk);
+
+//! Makes the lines in part of a TextBlock using several threads.
+/*!
+ * The part is divided into pieces at line boundaries and the pieces are parsed by a group of
+ * threads, each into a list of its own. The lists are then spliced into the given list in
+ * order. The result is exactly what parse_lines would produce.
+ *
+ * \param block The block holding the text.
+ * \param first The offset in the block of the first byte of the part.
+ * \param last The offset in the block just past the last byte of the part.
+ * \param lines The list to receive the lines. They are added before its current point.
+ * \throws std::bad_alloc if there is insufficient memory. The list is unchanged in that case.
+ */
+static void parse_lines_parallel(
+    TextBlock *block, std::size_t first, std::size_t last, EditList &lines )
+{
+    // There is no point dividing the text into very small pieces.
+    const std::size_t smallest_piece = 256 * 1024;
+
+    const unsigned    threads = std::max( 1U, std::thread::hardware_concurrency( ) );
+    const std::size_t pieces  = std::max< std::size_t >(
+        1, std::min< std::size_t >( 4 * threads, ( last - first ) / smallest_piece ) );
+
+    // Find the boundaries of the pieces. Each piece but the first starts after a newline.
+    const char *const text = block->data( );
+    std::vector< std::size_t > bounds( 1, first );
+    for( std::size_t i = 1; i < pieces; ++i ) {
+        const std::size_t guess = std::max( bounds.back( ), first + ( last - first ) / pieces * i );
+        const void *const newline = std::memchr( text + guess, '\n', last - guess );
+        if( newline == NULL ) break;
+        const std::size_t bound = static_cast< const char * >( newline ) - text + 1;
+        if( bound < last ) bounds.push_back( bound );
+    }
+    bounds.push_back( last );
+
+    // Parse the pieces. Each thread takes the next unparsed piece until none are left.
+    const std::size_t          count = bounds.size( ) - 1;
+    std::unique_ptr< EditList[] > results( new EditList[count] );
+    std::atomic< std::size_t > next_piece( 0 );
+    std::atomic< bool >        failed( false );
+
+    auto parse_pieces = [&]( ) {
+        std::size_t piece;
+        while( ( piece = next_piece.fetch_add( 1 ) ) < count ) {
+            try {
+                parse_lines( block, bounds[piece], bounds[piece + 1], results[piece] );
             }
+            catch( std::bad_alloc & ) {
+                failed = true;
+            }
+        }
+    };
+
+    // This thread helps, so one less thread is started. Starting fewer threads than expected
+    // just makes the parse slower.
+    std::vector< std::thread > helpers;
+    for( unsigned i = 1; i < threads  &&  i < count; ++i ) {
+        try {
+            helpers.push_back( std::thread( parse_pieces ) );
+        }
+        catch( std::system_error & ) {
+            break;
+        }
+    }
+    parse_pieces( );
+    for( std::thread &helper : helpers ) helper.join( );
+
+    if( failed ) throw std::bad_alloc( );
+    for( std::size_t i = 0; i < count; ++i ) {
+        results[i].jump_to( 0 );
+        lines.splice( results[i], results[i].size( ) );
+    }
+}
+
+
+long DiskEditFile::parallel_load_size = 1024L * 1024;
+unsigned long long DiskEditFile::view_size = 0;
+
+
+//! Makes the lines in part of a TextBlock, using several threads if the part is large.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+static void parse_text( TextBlock *block, std::size_t first, std::size_t last, EditList &lines )
+{
+    const long threshold = DiskEditFile::parallel_load_size;
+    if( threshold > 0  &&  last - first >= static_cast< std::size_t >( threshold ) ) {
+        parse_lines_parallel( block, first, last, lines );
+    }
+    else {
+        parse_lines( block, first, last, lines );
+    }
+}
+
+
+//! Files at least this large are loaded lazily (see LazyLoader).
+static const long lazy_load_size = 16L * 1024 * 1024;
+
+//! Reads a file in the background and supplies its lines as they are needed.
+/*!
+ * A background thread reads the entire file into a single TextBlock and finds the end of each
+ * line. The lines themselves are made on the main thread, when the EditList they are added to
+ * needs them. Thus the beginning of a large file can be displayed and edited before the file
+ * has been completely read. The lines are exactly the ones read_disk would make.
+ *
+ * The block is allocated at the size of the file so its text never moves. The background
+ * thread only writes to the part of the block that has not yet been published and the main
+ * thread only uses the part that has been. Line ends are published in batches under a mutex.
+ */
+class LazyLoader : public LineSource {
+public:
+    static LazyLoader *start( std::FILE *disk, const char *the_name );
+   ~LazyLoader( );
+
+    EditBuffer *next_line( );
+    bool ready( );
+    void take_all( EditList &lines );
+
+private:
+    // A line end is the offset of its newline in the block combined with these flags.
+    static const std::size_t raw_flag    = ~( ~std::size_t( 0 ) >> 1 ); //!< Needs cooking.
+    static const std::size_t last_flag   = raw_flag >> 1;  //!< Ends at the end of the file.
+    static const std::size_t offset_mask = ~( raw_flag | last_flag );
+
+    //! The amount of text read and indexed before the line ends found are published.
+    static const std::size_t chunk_size = 1024 * 1024;
+
+    LazyLoader( std::FILE *disk, const char *the_name, TextBlock *block );
+    void index( );
+    bool take_ends( bool wait );
+
+    std::string         name;     //!< The name of the file (for messages).
+    std::FILE          *disk;     //!< The file being read.
+    TextBlock          *block;    //!< Holds the entire text of the file.
+    std::thread         indexer;  //!< Reads the file and finds the line ends.
+    std::atomic< bool > stop;     //!< Set to ask the indexer to stop early.
+
+    // Shared with the indexer. Protected by lock.
+    std::mutex                 lock;
+    std::condition_variable    published;  //!< Signaled when line ends are published.
+    std::vector< std::size_t > new_ends;   //!< Line ends published but not yet taken.
+    bool                       finished;   //!< True when the indexer is finished.
+    bool                       failed;     //!< True if the file could not be read completely.
+    std::size_t                total;      //!< Number of bytes read once finished is true.
+
+    // Used only by the main thread.
+    std::vector< std::size_t > ends;        //!< Line ends taken from new_ends.
+    std::size_t                next_end;    //!< Index in ends of the next line's end.
+    std::size_t                line_start;  //!< Offset of the next line in the block.
+    std::string                workspace;   //!< Scratch space for cook_line.
+};
+
+const std::size_t LazyLoader::chunk_size;
+
+
+LazyLoader::LazyLoader( std::FILE *disk, const char *the_name, TextBlock *block ) :
+    name      ( the_name ),
+    disk      ( disk ),
+    block     ( block ),
+    stop      ( false ),
+    finished  ( false ),
+    failed    ( false ),
+    total     ( 0 ),
+    next_end  ( 0 ),
+    line_start( 0 )
+{ }
+
+
+//! Starts loading a file lazily if it is large enough to be worth it.
+/*!
+ * \param disk The file to load, positioned where loading should start. If a loader is
+ * returned, it owns the file and closes it when it is finished.
+ * \param the_name The name of the file as it should be shown to the user.
+ * \return A new loader or NULL if the file should be loaded in the usual way.
+ */
+LazyLoader *LazyLoader::start( std::FILE *disk, const char *the_name )
+{
+    std::size_t expected = 0;
+    const long start = std::ftell( disk );
+    if( start >= 0  &&  std::fseek( disk, 0, SEEK_END ) == 0 ) {
+        const long end = std::ftell( disk );
+        if( end > start ) expected = static_cast< std::size_t >( end - start );
+        std::fseek( disk, start, SEEK_SET );
+    }
+    if( expected < static_cast< std::size_t >( lazy_load_size ) ) return NULL;
+
+    TextBlock *const block = TextBlock::make( expected );
+    if( block == NULL ) return NULL;
 
-            space_count = 0;
+    LazyLoader *const loader = new LazyLoader( disk, the_name, block );
+    try {
+        loader->indexer = std::thread( &LazyLoader::index, loader );
+    }
+    catch( std::system_error & ) {
+        // No thread is available. The caller still owns the file.
+        loader->disk = NULL;
+        delete loader;
+        return NULL;
+    }
+    return( loader );
+}
+
+
+LazyLoader::~LazyLoader( )
+{
+    stop.store( true, std::memory_order_relaxed );
+    if( indexer.joinable( ) ) indexer.join( );
+    if( disk != NULL ) std::fclose( disk );
+    block->release( );
+}
 
-            // Print the character.
-            if( result != EOF ) {
-                result = std::putc( (*line)[offset], disk );
+
+//! Reads the file and finds the line ends. This is the body of the background thread.
+void LazyLoader::index( )
+{
+    char *const       text     = block->data( );
+    const std::size_t capacity = block->size( );
+    std::size_t       bytes    = 0;  // Number of bytes read.
+    std::size_t       start    = 0;  // Offset of the line being scanned.
+    bool              raw      = false;
+    bool              error    = false;
+    std::vector< std::size_t > found;
+
+    while( !stop.load( std::memory_order_relaxed )  &&  bytes < capacity ) {
+        const std::size_t wanted = std::min( chunk_size, capacity - bytes );
+        const std::size_t count  = std::fread( text + bytes, 1, wanted, disk );
+
+        // Scan the new text. Raw bytes only mark their line; the scan continues after them.
+        const char *const end = text + bytes + count;
+        const char       *p   = text + bytes;
+        while( ( p = find_line_special( p, end ) ) != end ) {
+            if( *p != '\n' ) raw = true;
+            else {
+                found.push_back( static_cast< std::size_t >( p - text ) | ( raw ? raw_flag : 0 ) );
+                start = static_cast< std::size_t >( p - text ) + 1;
+                raw   = false;
             }
+            ++p;
+        }
+        bytes += count;
+
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            new_ends.insert( new_ends.end( ), found.begin( ), found.end( ) );
+        }
+        published.notify_one( );
+        found.clear( );
+
+        if( count < wanted ) {
+            error = ( std::ferror( disk ) != 0 );
+            break;
         }
     }
 
-    // Store a '\n' at the end of each line.
-    if( result != EOF ) result = std::putc( '\n', disk );
+    std::lock_guard< std::mutex > guard( lock );
+    if( start < bytes ) new_ends.push_back( bytes | last_flag | ( raw ? raw_flag : 0 ) );
+    finished = true;
+    failed   = error;
+    total    = bytes;
+    published.notify_one( );
+}
+
+
+//! Takes the line ends published by the indexer.
+/*!
+ * \param wait If true, wait for the indexer to publish something if necessary.
+ * \return false if there were no line ends to take.
+ */
+bool LazyLoader::take_ends( const bool wait )
+{
+    std::unique_lock< std::mutex > guard( lock );
+    if( wait ) {
+        published.wait( guard, [this]{ return( !new_ends.empty( )  ||  finished ); } );
+    }
+    if( new_ends.empty( ) ) return false;
 
-    return ( result == EOF ) ? false : true;
+    ends.clear( );
+    ends.swap( new_ends );
+    next_end = 0;
+    return true;
 }
 
 
-/*=======================================*/
-/*           Protected Members           */
-/*=======================================*/
+//! Returns true if next_line( ) won't have to wait for the indexer.
+bool LazyLoader::ready( )
+{
+    if( next_end < ends.size( ) ) return true;
 
-//! Reads a file into file_data. Returns false if out of memory.
+    std::lock_guard< std::mutex > guard( lock );
+    return( !new_ends.empty( )  ||  finished );
+}
+
+
+//! Makes all the remaining lines of the file, waiting for the indexer to finish.
 /*!
- * Reads a previously opened disk file. Lines from the file are inserted into the object's data.
- * Whatever data is already in the object is not destroyed or anyway touched.
+ * This is faster than calling next_line( ) repeatedly because the remaining text can be parsed
+ * by several threads.
  *
- * Notice that the name of the file is not considered. The function can handle arbitraryly long
- * lines by using a dynamic memory technique. In addition, tabs are expanded assuming 8 column
- * tab stops.
+ * \param lines The list to receive the lines. They are added before its current point.
+ * \throws std::bad_alloc if there is insufficient memory.
  */
-bool DiskEditFile::read_disk( std::FILE *disk )
+void LazyLoader::take_all( EditList &lines )
 {
-          int   ch;          // A character from the file.
-          char *workspace;   // Pointer to the current line from file being read.
-    const int   chunk_size = 128; // Memory chunk size used to handling incoming lines.
-          int   chunk_count; // Number of chunks in workspace.
-          int   count;       // Number of characters installed in the workspace.
+    {
+        std::unique_lock< std::mutex > guard( lock );
+        published.wait( guard, [this]{ return finished; } );
+        new_ends.clear( );
+    }
+    ends.clear( );
+    next_end = 0;
 
-    // Get some memory for the incoming line. Start with chunk_size bytes.
-    workspace = static_cast< char * >( std::malloc( chunk_size * sizeof( char ) ) );
-    chunk_count = 1;
-    if( workspace == NULL ) return false;
+    parse_text( block, line_start, total, lines );
+    line_start = total;
 
-    // Loop until an error occurs or the entire file is read.
-    count = 0;
-    bool abort = false;
-    while( !abort  &&  ( ch = std::getc( disk ) ) != EOF ) {
+    if( failed ) {
+        warning_message( "Problems reading %s. File may be incomplete", name.c_str( ) );
+        failed = false;
+    }
+}
 
-        // Ignore non-ASCII characters (not that control characters are still processed).
-        if( ch == 0 || ( ch & 0x80 ) ) continue;
 
-        if( ch == '\n' ) {
-        
-            // Terminate the workspace (there will always be room) and install the line.
-            workspace[count] = '\0';
-            EditBuffer *new_copy = new EditBuffer( workspace );
-            if( file_data.insert( new_copy ) == NULL ) abort = true;
+//! Makes the next line of the file, waiting for the indexer to find it if necessary.
+/*!
+ * \return The new line or NULL if the entire file has been loaded.
+ */
+EditBuffer *LazyLoader::next_line( )
+{
+    EditBuffer *line = NULL;
 
-            // Release the current workspace and grab another initial one.
-            std::free( workspace );
-            workspace = static_cast< char * >( std::malloc( chunk_size * sizeof( char ) ) );
-            chunk_count = 1;
-            if( workspace == NULL ) abort = true;
+    while( line == NULL ) {
+        if( next_end == ends.size( )  &&  !take_ends( true ) ) {
+            if( failed ) {
+                warning_message( "Problems reading %s. File may be incomplete", name.c_str( ) );
+                failed = false;
+            }
+            return NULL;
+        }
 
-            // Reset character counter.
-            count = 0;
+        const std::size_t mark   = ends[next_end++];
+        const std::size_t end    = mark & offset_mask;
+        const std::size_t length = end - line_start;
+        if( mark & raw_flag ) {
+            line = cook_line( block->data( ) + line_start, length, workspace );
         }
         else {
+            line = new EditBuffer( block, line_start, length );
+        }
+        line_start = end + 1;
 
-            // Install the character (there will always be room even if tabs are expanded).
-            if( ch != '\t' ) workspace[count++] = static_cast< char >( ch );
-            else {
-                int skip_distance = 8 - ( count % 8 );
-                for( int i = 0; i < skip_distance; i++ ) workspace[count++] = ' ';
+        // The last partial line is only used if it isn't empty.
+        if( ( mark & last_flag )  &&  line->length( ) == 0 ) {
+            delete line;
+            line = NULL;
+        }
+    }
+    return( line );
+}
+
+
+#if eOPSYS == ePOSIX
+//! Shows a file that is too large to load without reading all of it into memory.
+/*!
+ * The file is mapped into memory. A background thread finds the start of every stride-th line
+ * so that any line can be found by scanning at most stride lines from the nearest one known.
+ * Lines are made only when they are used, borrowing their text from the mapping where possible.
+ * Thus the memory used is a small fraction of the file's size.
+ */
+class MappedView : public LineView {
+public:
+    static bool must_show( const struct stat &file_status );
+    static MappedView *open( std::FILE *disk );
+   ~MappedView( );
+    bool has_line( long index );
+    long size( );
+    EditBuffer *make_line( long index );
+
+private:
+    //! The number of lines between the lines whose starts are recorded.
+    static const long stride = 1024;
+
+    //! The amount of text scanned before the line starts found are published.
+    static const std::size_t chunk_size = 4 * 1024 * 1024;
+
+    explicit MappedView( TextBlock *block );
+    void index( );
+    void wait_for( long index );
+    std::size_t line_end( std::size_t start );
+
+    TextBlock          *block;    //!< The mapping of the file.
+    std::thread         indexer;  //!< Finds the line starts.
+    std::atomic< bool > stop;     //!< Set to ask the indexer to stop early.
+
+    // Shared with the indexer. Protected by lock.
+    std::mutex                 lock;
+    std::condition_variable    published;  //!< Signaled when line starts are published.
+    std::vector< std::size_t > starts;     //!< starts[i] is the offset of line i * stride.
+    long                       lines;      //!< The number of lines found so far.
+    bool                       finished;   //!< True when all the lines have been found.
+
+    // Used only by the main thread.
+    long        known_lines;     //!< The value of lines when last seen.
+    bool        known_finished;  //!< The value of finished when last seen.
+    long        recent_index;    //!< The index of the line most recently made (-1 if none).
+    std::size_t recent_start;    //!< The offset of that line.
+    std::size_t recent_end;      //!< The offset just past the end of that line's text.
+    std::string workspace;       //!< Scratch space for cook_line.
+};
+
+const long        MappedView::stride;
+const std::size_t MappedView::chunk_size;
+
+
+MappedView::MappedView( TextBlock *block ) :
+    block         ( block ),
+    stop          ( false ),
+    starts        ( 1, 0 ),
+    lines         ( 0 ),
+    finished      ( false ),
+    known_lines   ( 0 ),
+    known_finished( false ),
+    recent_index  ( -1 ),
+    recent_start  ( 0 ),
+    recent_end    ( 0 )
+{ }
+
+
+//! Returns true if a file is large enough that it must be shown. See DiskEditFile::view_size.
+bool MappedView::must_show( const struct stat &file_status )
+{
+    if( !S_ISREG( file_status.st_mode )  ||  file_status.st_size <= 0 ) return false;
+
+    // By default, files larger than a quarter of memory are shown.
+    unsigned long long threshold = DiskEditFile::view_size;
+    if( threshold == 0 ) {
+        const long pages     = sysconf( _SC_PHYS_PAGES );
+        const long page_size = sysconf( _SC_PAGESIZE );
+        if( pages <= 0  ||  page_size <= 0 ) return false;
+        threshold = static_cast< unsigned long long >( pages ) * page_size / 4;
+    }
+    const unsigned long long file_size = static_cast< unsigned long long >( file_status.st_size );
+    return( file_size >= threshold  &&  file_size <= std::numeric_limits< std::size_t >::max( ) );
+}
+
+
+//! Starts showing a file if it is large enough to need it.
+/*!
+ * \param disk The file to show, positioned at its beginning. The caller still owns it and can
+ * close it at once.
+ * \return A new view or NULL if the file should be loaded in the usual way.
+ */
+MappedView *MappedView::open( std::FILE *disk )
+{
+    struct stat file_status;
+    if( std::ftell( disk ) != 0  ||  fstat( fileno( disk ), &file_status ) != 0 ) return NULL;
+    if( !must_show( file_status ) ) return NULL;
+    const unsigned long long file_size = static_cast< unsigned long long >( file_status.st_size );
+
+    TextBlock *const block =
+        TextBlock::map( fileno( disk ), static_cast< std::size_t >( file_size ) );
+    if( block == NULL ) return NULL;
+    MappedView *const view = new MappedView( block );
+    try {
+        view->indexer = std::thread( &MappedView::index, view );
+    }
+    catch( std::system_error & ) {
+        delete view;
+        return NULL;
+    }
+    return( view );
+}
+
+
+MappedView::~MappedView( )
+{
+    stop.store( true, std::memory_order_relaxed );
+    if( indexer.joinable( ) ) indexer.join( );
+    block->release( );
+}
+
+
+//! Finds the line starts. This is the body of the background thread.
+void MappedView::index( )
+{
+    const char *const text    = block->data( );
+    const std::size_t total   = block->size( );
+    std::size_t       scanned = 0;  // Number of bytes scanned.
+    std::size_t       start   = 0;  // Offset of the line being scanned.
+    long              count   = 0;  // Number of complete lines found.
+    std::vector< std::size_t > found;
+
+    while( !stop.load( std::memory_order_relaxed )  &&  scanned < total ) {
+        const char *const end = text + std::min( total, scanned + chunk_size );
+        const char       *p   = text + scanned;
+        while( ( p = static_cast< const char * >( std::memchr( p, '\n', end - p ) ) ) != NULL ) {
+            start = static_cast< std::size_t >( ++p - text );
+            if( ++count % stride == 0 ) found.push_back( start );
+        }
+        scanned = static_cast< std::size_t >( end - text );
+
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            starts.insert( starts.end( ), found.begin( ), found.end( ) );
+            lines = count;
+        }
+        published.notify_one( );
+        found.clear( );
+    }
+
+    // The last line might not end with a newline.
+    std::lock_guard< std::mutex > guard( lock );
+    if( scanned == total  &&  start < total ) ++lines;
+    finished = true;
+    published.notify_one( );
+}
+
+
+//! Waits until the line with the given index has been found or all lines have been found.
+void MappedView::wait_for( const long index )
+{
+    std::unique_lock< std::mutex > guard( lock );
+    published.wait( guard, [&]{ return( lines > index  ||  finished ); } );
+    known_lines    = lines;
+    known_finished = finished;
+}
+
+
+bool MappedView::has_line( const long index )
+{
+    if( index < known_lines ) return true;
+    if( known_finished ) return false;
+    wait_for( index );
+    return( index < known_lines );
+}
+
+
+long MappedView::size( )
+{
+    if( !known_finished ) wait_for( LONG_MAX );
+    return( known_lines );
+}
+
+
+//! Returns the offset of the end of the line starting at the given offset.
+std::size_t MappedView::line_end( const std::size_t start )
+{
+    if( start >= block->size( ) ) return( block->size( ) );
+    const char *const text    = block->data( );
+    const void *const newline = std::memchr( text + start, '\n', block->size( ) - start );
+    return( newline == NULL ? block->size( ) : static_cast< const char * >( newline ) - text );
+}
+
+
+//! Makes a line of the file.
+/*!
+ * Lines next to the one most recently made are found directly, so moving through the file a
+ * line at a time is fast in either direction. Other lines are found by scanning forward from
+ * the nearest line whose start is known.
+ */
+EditBuffer *MappedView::make_line( const long index )
+{
+    const char *const text = block->data( );
+    std::size_t       start;
+
+    if( index == recent_index ) start = recent_start;
+    else if( recent_index >= 0  &&  index == recent_index + 1 ) start = recent_end + 1;
+    else if( index == recent_index - 1 ) {
+        start = recent_start - 1;
+        while( start > 0  &&  text[start - 1] != '\n' ) --start;
+    }
+    else {
+        long from = index - index % stride;
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            start = starts[index / stride];
+        }
+        if( recent_index > from  &&  recent_index < index ) {
+            from  = recent_index;
+            start = recent_start;
+        }
+        for( ; from < index; ++from ) start = line_end( start ) + 1;
+    }
+
+    // If the file shrank, its missing text has no line ends (see TextBlock::map). The lines
+    // past its new end are empty.
+    start = std::min( start, block->size( ) );
+    const std::size_t end = line_end( start );
+
+    EditBuffer *line;
+    if( find_line_special( text + start, text + end ) != text + end ) {
+        line = cook_line( text + start, end - start, workspace );
+    }
+    else {
+        line = new EditBuffer( block, start, end - start );
+    }
+    recent_index = index;
+    recent_start = start;
+    recent_end   = end;
+    return( line );
+}
+#endif
+
+
+#if eOPSYS == ePOSIX
+
+//! Returns the name of the file a save to the given name should replace.
+/*!
+ * If the name refers to a symbolic link, the link is left alone and the file it refers to is
+ * replaced. Otherwise the name itself is returned.
+ */
+static std::string replacement_target( const char *name )
+{
+    struct stat link_status;
+    if( lstat( name, &link_status ) == 0  &&  S_ISLNK( link_status.st_mode ) ) {
+        char *const resolved = realpath( name, NULL );
+        if( resolved != NULL ) {
+            std::string result( resolved );
+            std::free( resolved );
+            return result;
+        }
+    }
+    return std::string( name );
+}
+
+
+//! Returns the name of the directory containing the given file.
+static std::string directory_of( const std::string &path )
+{
+    const std::string::size_type slash = path.rfind( '/' );
+    if( slash == std::string::npos ) return std::string( "." );
+    if( slash == 0 ) return std::string( "/" );
+    return path.substr( 0, slash );
+}
+
+
+//! Returns the modification time in a file's status, in nanoseconds since the epoch.
+static long long modify_time( const struct stat &status )
+{
+    // macOS gives the field a different name.
+    #if defined( __APPLE__ )
+    const struct timespec &modified = status.st_mtimespec;
+    #else
+    const struct timespec &modified = status.st_mtim;
+    #endif
+    return static_cast< long long >( modified.tv_sec ) * 1000000000LL + modified.tv_nsec;
+}
+
+
+//! Returns true if the given file can be saved by replacing it with a new file.
+static bool can_replace( const std::string &target )
+{
+    struct stat target_status;
+    if( stat( target.c_str( ), &target_status ) == 0 ) {
+        if( !S_ISREG( target_status.st_mode ) )  return false;
+        if( target_status.st_nlink > 1 )         return false;
+        if( access( target.c_str( ), W_OK ) != 0 ) return false;
+    }
+    return( access( directory_of( target ).c_str( ), W_OK ) == 0 );
+}
+
+
+//! Creates a temporary file that can later replace the given target.
+/*!
+ * The temporary file is created in the target's directory. It is given the target's
+ * permissions and (if possible) its owner and group, or the permissions a new file would get if
+ * the target doesn't exist.
+ *
+ * \param target The file that will be replaced.
+ * \param temporary Set to the name of the temporary file.
+ * \return The temporary file, open for writing, or NULL (with errno set) if it can't be
+ * created.
+ */
+static std::FILE *open_replacement( const std::string &target, std::string &temporary )
+{
+    temporary = target + ".yXXXXXX";
+
+    // Create the temporary file. It is made with permissions 0600.
+    const int descriptor = mkstemp( &temporary[0] );
+    if( descriptor < 0 ) return NULL;
+    std::FILE *const disk = fdopen( descriptor, "w" );
+    if( disk == NULL ) {
+        const int error_code = errno;
+        close( descriptor );
+        std::remove( temporary.c_str( ) );
+        errno = error_code;
+        return NULL;
+    }
+
+    // Give the new file the permissions and ownership the target has (or would get if new).
+    struct stat target_status;
+    if( stat( target.c_str( ), &target_status ) == 0 ) {
+        fchmod( descriptor, target_status.st_mode & 07777 );
+
+        // Ordinary users can't give files away but may be able to keep the group.
+        if( fchown( descriptor, target_status.st_uid, target_status.st_gid ) != 0  &&
+            fchown( descriptor, static_cast< uid_t >( -1 ), target_status.st_gid ) != 0 ) {
+            // The new file belongs to the user saving it. That is not an error.
+        }
+    }
+    else {
+        const mode_t mask = umask( 0 );
+        umask( mask );
+        fchmod( descriptor, 0666 & ~mask );
+    }
+    return disk;
+}
+
+
+//! Renames a temporary file over its target and forces the rename to the disk.
+/*!
+ * \return false (with errno set) if the rename fails. The temporary file is removed in that
+ * case and the target is unchanged. Failing to force the rename to the disk is not an error.
+ */
+static bool replace_with( const std::string &temporary, const std::string &target )
+{
+    if( std::rename( temporary.c_str( ), target.c_str( ) ) != 0 ) {
+        const int error_code = errno;
+        std::remove( temporary.c_str( ) );
+        errno = error_code;
+        return false;
+    }
+
+    const int directory_descriptor = open( directory_of( target ).c_str( ), O_RDONLY );
+    if( directory_descriptor >= 0 ) {
+        fsync( directory_descriptor );
+        close( directory_descriptor );
+    }
+    return true;
+}
+
+#endif
+
+
+//! Closes a file that has been written.
+/*!
+ * \param disk The file to close.
+ * \param durable True if the file's data must be forced to the disk before it is closed.
+ * \return false (with errno set) if the data couldn't be forced to the disk or the file
+ * couldn't be closed. The file is closed in any case.
+ */
+static bool close_file( std::FILE *disk, bool durable )
+{
+    bool result = true;
+
+    #if eOPSYS == ePOSIX
+    if( durable ) {
+        result = ( std::fflush( disk ) == 0  &&  fsync( fileno( disk ) ) == 0 );
+    }
+    #endif
+
+    if( std::fclose( disk ) != 0 ) result = false;
+    return result;
+}
+
+//! Computes the hash of a line's text, ignoring trailing spaces since they are never saved.
+static std::uint64_t line_hash( const char *text, std::size_t length )
+{
+    return EditBuffer::hash( text, find_trailing_spaces( text, text + length ) - text );
+}
+
+
+//! Computes the hash of a line, ignoring trailing spaces since they are never saved.
+static std::uint64_t line_hash( const EditBuffer &line )
+{
+    std::size_t length = line.length( );
+    while( length > 0  &&  line[length - 1] == ' ' ) --length;
+    if( length == line.length( ) ) return line.hash( );
+    const std::string text( line.to_string( ) );
+    return EditBuffer::hash( text.data( ), length );
+}
+
+
+//! Returns true if a line has the given text.
+static bool same_text( const EditBuffer &line, const char *text, std::size_t length )
+{
+    char line_text[128];
+
+    if( line.length( ) != length ) return false;
+    for( std::size_t offset = 0; offset < length; offset += sizeof( line_text ) ) {
+        const std::size_t count = line.copy( line_text, sizeof( line_text ), offset );
+        if( std::memcmp( line_text, text + offset, count ) != 0 ) return false;
+    }
+    return true;
+}
+
+
+//! Gets the lines of a list and their hashes (see line_hash( )).
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+static void collect_lines(
+    EditList &list, std::vector< EditBuffer * > &lines, std::vector< std::uint64_t > &hashes )
+{
+    EditBuffer *line;
+
+    lines.reserve( list.size( ) );
+    list.jump_to( 0 );
+    while( ( line = list.next( ) ) != NULL ) lines.push_back( line );
+
+    hashes.reserve( lines.size( ) );
+    for( EditBuffer *p : lines ) hashes.push_back( line_hash( *p ) );
+}
+
+
+//! The lines of a file read from the disk, found and hashed but only made as they are needed.
+/*!
+ * The lines are those parse_lines( ) would make. Lines whose text needs cooking are made when
+ * they are found since their text is not in the block. Lines not taken are deleted with the
+ * object.
+ */
+class DiskVersion {
+public:
+    explicit DiskVersion( TextBlock *file_block );
+   ~DiskVersion( );
+
+    void scan( );
+
+    //! Returns the number of lines.
+    long size( ) const
+        { return( static_cast< long >( lines.size( ) ) ); }
+
+    //! Returns the hashes of the lines (see line_hash( )).
+    std::vector< std::uint64_t > &hashes( )
+        { return( line_hashes ); }
+
+    bool same( const EditBuffer &line, long index ) const;
+    EditBuffer *take_line( long index );
+
+private:
+    //! A line in the block.
+    struct Line {
+        std::size_t offset;  //!< The offset of the line's text in the block.
+        std::size_t length;  //!< The length of the line's text.
+        EditBuffer *cooked;  //!< The line, if its text needed cooking and it hasn't been taken.
+    };
+
+    TextBlock                   *block;        //!< The text of the file.
+    std::vector< Line >          lines;        //!< The lines found.
+    std::vector< std::uint64_t > line_hashes;  //!< The hash of each line.
+
+    // Versions can't be copied.
+    DiskVersion( const DiskVersion & ) = delete;
+    DiskVersion &operator=( const DiskVersion & ) = delete;
+};
+
+
+//! Takes over a reference to a block holding the text of a file.
+DiskVersion::DiskVersion( TextBlock *file_block ) :
+    block( file_block )
+{ }
+
+
+DiskVersion::~DiskVersion( )
+{
+    for( Line &line : lines ) delete line.cooked;
+    block->release( );
+}
+
+
+//! Finds the lines in the block and computes their hashes.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void DiskVersion::scan( )
+{
+    const char *const text   = block->data( );
+    const char *const finish = text + block->size( );
+    const char       *start  = text;
+    std::string       workspace;
+
+    while( start < finish ) {
+        const char *end = find_line_special( start, finish );
+        const std::size_t offset = start - text;
+
+        // The last partial line is only a line if it isn't empty.
+        if( end != finish  &&  *end != '\n' ) {
+            end = static_cast< const char * >( std::memchr( end, '\n', finish - end ) );
+            if( end == NULL ) end = finish;
+            EditBuffer *const cooked = cook_line( start, end - start, workspace );
+            if( end == finish  &&  cooked->length( ) == 0 ) {
+                delete cooked;
+                break;
             }
+            try {
+                lines.push_back( Line{ offset, cooked->length( ), cooked } );
+            }
+            catch( std::bad_alloc & ) {
+                delete cooked;
+                throw;
+            }
+            line_hashes.push_back( line_hash( *cooked ) );
+        }
+        else {
+            if( end == finish  &&  end == start ) break;
+            const std::size_t length = end - start;
+            lines.push_back( Line{ offset, length, NULL } );
+            line_hashes.push_back( line_hash( start, length ) );
+        }
+        start = end + 1;
+    }
+}
+
+
+//! Returns true if a line has the same text as one of the lines of the file.
+bool DiskVersion::same( const EditBuffer &line, long index ) const
+{
+    const Line &other = lines[index];
+    if( other.cooked != NULL ) return( line == *other.cooked );
+    return same_text( line, block->data( ) + other.offset, other.length );
+}
+
+
+//! Makes one of the lines of the file. The caller owns it. Each line can only be taken once.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+EditBuffer *DiskVersion::take_line( long index )
+{
+    Line &line = lines[index];
+    EditBuffer *result = line.cooked;
+    if( result == NULL ) result = new EditBuffer( block, line.offset, line.length );
+    line.cooked = NULL;
+    return( result );
+}
+
 
-            // If workspace getting close to full, get a bigger space.
-            if( chunk_size * chunk_count - count < 10 ) {
-                workspace =
-                    static_cast< char * >( std::realloc(workspace, chunk_size * ( chunk_count + 1 ) ) );
-                chunk_count++;
-                if( workspace == NULL ) abort = true;
+//! A run of lines that are the same in two versions of a file.
+struct CommonRun {
+    long old_start;  //!< The index of the first line of the run in the old version.
+    long new_start;  //!< The index of the first line of the run in the new version.
+    long length;     //!< The number of lines in the run.
+};
+
+
+//! Finds the lines that two versions of a file have in common.
+/*!
+ * Matching lines at the start and end of the versions are common. Between them, the lines that
+ * occur once in each version are matched, and the longest sequence of those that is in the
+ * same order in both versions (found as in "patience diff") divides the versions into smaller
+ * pieces that are handled the same way. Pieces with no such lines are taken to be different.
+ * The result isn't always the smallest set of differences but the time needed is close to
+ * linear in the number of lines, and lines that were edited are found exactly.
+ *
+ * \param old_hashes The hashes of the lines of the old version.
+ * \param new_hashes The hashes of the lines of the new version.
+ * \param same A function taking the index of an old line and a new line and returning true if
+ * they have the same text. It is only called for lines with the same hash.
+ * \return The common runs, in order.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+template< typename Same >
+static std::vector< CommonRun > common_runs( const std::vector< std::uint64_t > &old_hashes,
+                                             const std::vector< std::uint64_t > &new_hashes,
+                                             Same same )
+{
+    //! A piece of the versions still to be compared. A piece with done set is a common run.
+    struct Piece {
+        long old_start, old_end;
+        long new_start, new_end;
+        bool done;
+    };
+
+    //! Where a line appears in the piece being compared.
+    struct Occurrence {
+        long old_count, old_index;
+        long new_count, new_index;
+    };
+
+    auto matches = [&]( long i, long j )
+        { return( old_hashes[i] == new_hashes[j]  &&  same( i, j ) ); };
+
+    std::vector< CommonRun > result;
+    std::vector< Piece > pieces;
+    std::unordered_map< std::uint64_t, Occurrence > occurrences;
+    std::vector< std::pair< long, long > > unique;  // Unique lines (old index, new index).
+    std::vector< long > tails;                       // See the comment below.
+    std::vector< long > previous;
+
+    pieces.push_back( Piece{ 0, static_cast< long >( old_hashes.size( ) ),
+                             0, static_cast< long >( new_hashes.size( ) ), false } );
+
+    // The pieces are on a stack with the first piece on top.
+    while( !pieces.empty( ) ) {
+        Piece piece = pieces.back( );
+        pieces.pop_back( );
+        if( piece.done ) {
+            result.push_back(
+                CommonRun{ piece.old_start, piece.new_start, piece.old_end - piece.old_start } );
+            continue;
+        }
+
+        // The matching lines at the start are a common run.
+        long count = 0;
+        while( piece.old_start + count < piece.old_end  &&
+               piece.new_start + count < piece.new_end  &&
+               matches( piece.old_start + count, piece.new_start + count ) ) ++count;
+        if( count > 0 ) {
+            result.push_back( CommonRun{ piece.old_start, piece.new_start, count } );
+            piece.old_start += count;
+            piece.new_start += count;
+        }
+
+        // The matching lines at the end are a common run after everything else.
+        count = 0;
+        while( piece.old_end - count > piece.old_start  &&
+               piece.new_end - count > piece.new_start  &&
+               matches( piece.old_end - count - 1, piece.new_end - count - 1 ) ) ++count;
+        if( count > 0 ) {
+            piece.old_end -= count;
+            piece.new_end -= count;
+            pieces.push_back( Piece{ piece.old_end, piece.old_end + count,
+                                     piece.new_end, piece.new_end + count, true } );
+        }
+        if( piece.old_start == piece.old_end  ||  piece.new_start == piece.new_end ) continue;
+
+        // Find the lines that occur once in each version of the piece.
+        occurrences.clear( );
+        for( long i = piece.old_start; i < piece.old_end; ++i ) {
+            Occurrence &where = occurrences[old_hashes[i]];
+            ++where.old_count;
+            where.old_index = i;
+        }
+        for( long j = piece.new_start; j < piece.new_end; ++j ) {
+            const auto where = occurrences.find( new_hashes[j] );
+            if( where != occurrences.end( ) ) {
+                ++where->second.new_count;
+                where->second.new_index = j;
+            }
+        }
+        unique.clear( );
+        for( long i = piece.old_start; i < piece.old_end; ++i ) {
+            const Occurrence &where = occurrences[old_hashes[i]];
+            if( where.old_count == 1  &&  where.new_count == 1  &&  same( i, where.new_index ) ) {
+                unique.push_back( std::make_pair( i, where.new_index ) );
             }
         }
+        if( unique.empty( ) ) continue;
+
+        // Find the longest sequence of unique lines in the same order in both versions. The
+        // last line of the best sequence of each length found so far is in tails.
+        tails.clear( );
+        previous.assign( unique.size( ), -1 );
+        for( long k = 0; k < static_cast< long >( unique.size( ) ); ++k ) {
+            std::vector< long >::iterator slot = std::lower_bound(
+                tails.begin( ), tails.end( ), unique[k].second,
+                [&unique]( long tail, long new_index )
+                    { return( unique[tail].second < new_index ); } );
+            if( slot != tails.begin( ) ) previous[k] = *( slot - 1 );
+            if( slot == tails.end( ) ) tails.push_back( k );
+            else *slot = k;
+        }
+
+        // Each line of the sequence starts a smaller piece. Push them last piece first.
+        long old_end = piece.old_end;
+        long new_end = piece.new_end;
+        for( long k = tails.back( ); k >= 0; k = previous[k] ) {
+            pieces.push_back( Piece{ unique[k].first, old_end, unique[k].second, new_end, false } );
+            old_end = unique[k].first;
+            new_end = unique[k].second;
+        }
+        pieces.push_back( Piece{ piece.old_start, old_end, piece.new_start, new_end, false } );
     }
+    return result;
+}
+
+
+//! A change to a list of lines.
+struct LineEdit {
+    long position;  //!< The index of the first line replaced, before any edits are made.
+    long remove;    //!< The number of lines replaced.
+    long insert;    //!< The number of lines replacing them.
+};
 
-    // Install the last partial line, if there is one.
-    workspace[count] = '\0';
-    if( !std::ferror( disk )  &&  std::strlen( workspace ) > 0 ) {
-        EditBuffer *new_copy = new EditBuffer(workspace);
-        if ( file_data.insert( new_copy ) == NULL ) abort = true;
+
+//! Makes a sequence of edits to a list of lines, keeping the cursor with its line.
+/*!
+ * Only the lines replaced are moved, so the time needed depends on the number of edits and not
+ * on the number of lines. No memory is allocated.
+ *
+ * \param lines The list to edit.
+ * \param point The cursor. It stays with its line or, if its line is replaced, moves to the
+ * line replacing it. It is kept at the same place on the screen.
+ * \param edits The edits, in order of position. They must not overlap.
+ * \param replacements The lines inserted by all the edits, in order. They are moved to lines.
+ */
+static void apply_edits( EditList &lines,
+                         FilePosition &point,
+                         const std::vector< LineEdit > &edits,
+                         EditList &replacements )
+{
+    const long cursor_line   = point.cursor_line( );
+    const int  cursor_offset = static_cast< int >( cursor_line - point.window_line( ) );
+    long new_cursor_line = cursor_line;
+    long shift = 0;  // The number of lines added by the edits made so far.
+    EditList discarded;
+
+    replacements.jump_to( 0 );
+    for( const LineEdit &edit : edits ) {
+        if( cursor_line >= edit.position + edit.remove ) {
+            new_cursor_line += edit.insert - edit.remove;
+        }
+        else if( cursor_line >= edit.position ) {
+            new_cursor_line = edit.position + shift +
+                std::min( cursor_line - edit.position, std::max( edit.insert - 1, 0L ) );
+        }
+
+        lines.jump_to( edit.position + shift );
+        if( edit.remove > 0 ) {
+            discarded.set_end( );
+            discarded.splice( lines, edit.remove );
+        }
+        lines.splice( replacements, edit.insert );
+        shift += edit.insert - edit.remove;
+    }
+    point.jump_to_line( new_cursor_line );
+    point.adjust_window_line( cursor_offset );
+}
+
+
+//! Returns true if a version's lines in a piece of the base version are the base's lines.
+/*!
+ * \param match The index in the version of each line of the base, or -1.
+ * \param base_start The index in the base of the first line of the piece.
+ * \param base_end The index in the base just past the last line of the piece.
+ * \param start The index in the version of the first line of the piece.
+ * \param end The index in the version just past the last line of the piece.
+ */
+static bool unchanged( const std::vector< long > &match,
+                       long base_start, long base_end, long start, long end )
+{
+    if( end - start != base_end - base_start ) return false;
+    for( long i = base_start; i < base_end; ++i ) {
+        if( match[i] != start + ( i - base_start ) ) return false;
+    }
+    return true;
+}
+
+
+/*=======================================*/
+/*           Protected Members           */
+/*=======================================*/
+
+//! Reads a file into file_data. Returns false if out of memory.
+/*!
+ * Reads a previously opened disk file. Lines from the file are inserted into the object's data.
+ * Whatever data is already in the object is not destroyed or anyway touched.
+ *
+ * Notice that the name of the file is not considered. The entire file is read into a single
+ * TextBlock and lines that need no processing borrow their text from that block. Thus loading a
+ * file copies its text only once. Tabs are expanded assuming 8 column tab stops.
+ *
+ * The text is scanned only once. Each scan stops at the end of a line or at the first byte that
+ * must be processed, whichever comes first; the scan is vectorized where possible. Lines are
+ * appended to the end of file_data, which costs constant time per line.
+ */
+bool DiskEditFile::read_disk( std::FILE *disk )
+{
+    TextBlock *const block = read_block( disk );
+    if( block == NULL ) {
+        memory_message( "Can't read entire file" );
+        return false;
     }
 
-    // Get rid of the current workspace.
-    std::free( workspace );
+    bool abort = false;
+    try {
+        parse_text( block, 0, block->size( ), file_data );
+    }
+    catch( std::bad_alloc & ) {
+        abort = true;
+    }
+
+    // The lines hold their own references to the block.
+    block->release( );
 
     if( abort ) {
         memory_message( "Can't read entire file" );
@@ -147,6 +1417,140 @@ bool DiskEditFile::read_disk( std::FILE *disk )
 }
 
 
+//! Starts a new journal whose base version is the current base version.
+/*!
+ * This is done whenever the base version changes. If the text differs from the base version,
+ * the differences are recorded so that the new journal recreates the text. Otherwise the old
+ * journal file is deleted since it is no longer needed. The text isn't journaled if its base
+ * version isn't known or if it is shown read-only.
+ */
+void DiskEditFile::restart_journal( )
+{
+    delete journal;
+    journal = NULL;
+    if( journal_name.empty( ) ) return;
+
+    if( base_known  &&  !file_data.has_view( ) ) {
+        try {
+            journal = new Journal( journal_name, Journal::digest( base ) );
+            if( is_changed ) {
+                std::vector< EditBuffer * >  lines;
+                std::vector< std::uint64_t > hashes;
+                collect_lines( file_data, lines, hashes );
+                std::vector< CommonRun > runs =
+                    common_runs( base, hashes, []( long, long ) { return true; } );
+                runs.push_back( CommonRun{ static_cast< long >( base.size( ) ),
+                                           static_cast< long >( lines.size( ) ), 0 } );
+
+                // Replace the lines before each common run with the text's lines.
+                long old_next = 0;
+                long new_next = 0;
+                for( const CommonRun &run : runs ) {
+                    if( run.old_start > old_next ) {
+                        journal->deleted( new_next, run.old_start - old_next );
+                    }
+                    if( run.new_start > new_next ) {
+                        file_data.jump_to( new_next );
+                        journal->inserted( new_next, run.new_start - new_next, file_data );
+                    }
+                    old_next = run.old_start + run.length;
+                    new_next = run.new_start + run.length;
+                }
+            }
+        }
+        catch( std::bad_alloc & ) {
+            delete journal;
+            journal = NULL;
+        }
+    }
+    if( journal == NULL  ||  !journal->pending( ) ) std::remove( journal_name.c_str( ) );
+}
+
+
+//! Makes file_data match a file, keeping the lines that are the same.
+/*!
+ * The lines of the file are found and hashed without being made (see DiskVersion). They are
+ * compared with the lines in file_data by their hashes (see common_runs( )) and only the lines
+ * in the runs that differ are made and replaced. Thus a file with a few changes costs little
+ * more than reading it. The cursor stays with its line (see apply_edits( )). Afterwards the
+ * file is the base version for merge( ).
+ *
+ * \param disk The file to read, positioned at its beginning.
+ * \return false if the file couldn't be read. In that case file_data is unchanged.
+ */
+bool DiskEditFile::merge_disk( std::FILE *disk )
+{
+    TextBlock *const block = read_block( disk );
+    if( block == NULL ) {
+        memory_message( "Can't read entire file" );
+        return false;
+    }
+    DiskVersion new_version( block );
+
+    // Everything that might fail is done before file_data is touched.
+    std::vector< EditBuffer * >  old_lines;
+    std::vector< std::uint64_t > old_hashes;
+    std::vector< LineEdit >      edits;
+    EditList replacements;
+    try {
+        collect_lines( file_data, old_lines, old_hashes );
+        new_version.scan( );
+        std::vector< CommonRun > runs = common_runs(
+            old_hashes, new_version.hashes( ),
+            [&]( long i, long j ) { return new_version.same( *old_lines[i], j ); } );
+        runs.push_back(
+            CommonRun{ static_cast< long >( old_lines.size( ) ), new_version.size( ), 0 } );
+
+        // Replace the lines before each common run with the new lines before it.
+        long old_next = 0;
+        long new_next = 0;
+        for( const CommonRun &run : runs ) {
+            if( run.old_start > old_next  ||  run.new_start > new_next ) {
+                edits.push_back(
+                    LineEdit{ old_next, run.old_start - old_next, run.new_start - new_next } );
+                for( long j = new_next; j < run.new_start; ++j ) {
+                    replacements.insert( new_version.take_line( j ) );
+                }
+            }
+            old_next = run.old_start + run.length;
+            new_next = run.new_start + run.length;
+        }
+    }
+    catch( std::bad_alloc & ) {
+        memory_message( "Can't read entire file" );
+        return false;
+    }
+    if( std::ferror( disk ) ) return false;
+
+    apply_edits( file_data, current_point, edits, replacements );
+    base.swap( new_version.hashes( ) );
+    base_known   = true;
+    base_pending = false;
+    return true;
+}
+
+
+//! Save lines to a file. Returns false if disk write fails, but no message is printed.
+/*!
+ * Writes lines first through last (inclusive) of the data to the previously opened file. Lines
+ * past the end of the data are ignored. Trailing spaces are not written. The text is gathered
+ * into large chunks so that only a few system calls are needed. The file's own buffer is
+ * flushed first and is bypassed.
+ */
+bool DiskEditFile::write_lines( std::FILE *disk, long first, const long last )
+{
+    EditBuffer *line;
+    LineWriter  writer( disk );
+    bool        result = true;
+
+    file_data.jump_to( first );
+    while( result  &&  first++ <= last  &&  ( line = file_data.next( ) ) != NULL ) {
+        result = writer.put_line( *line );
+    }
+    return( writer.flush( ) && result );
+}
+
+
 //! Save file_data to a file. Returns false if disk write fails, but no message is printed.
 /*!
  * Writes the data in the YEditFile to the previously opened file. The entire file is written.
@@ -154,52 +1558,199 @@ bool DiskEditFile::read_disk( std::FILE *disk )
  */
 bool DiskEditFile::write_disk( std::FILE *disk )
 {
-    EditBuffer *line;          // Refers to the currently active line.
-    int         result = 0;    // =EOF if error encountered during write.
-
     // Jump out if the file is empty.
     if( file_data.size( ) == 0L ) return true;
 
-    // For each line in the EditFile object...
-    file_data.jump_to(0);
-    while( result != EOF && ( line = file_data.next( ) ) != NULL ) {
-        result = write_line( line, disk );
-    }
-
-    return static_cast< bool >( result != EOF );
+    return write_lines( disk, 0, file_data.size( ) - 1 );
 }
 
 
 //! Save current block to a file. Returns false if disk write fails, but no message is printed.
 bool DiskEditFile::write_disk_block( std::FILE *disk )
 {
-    EditBuffer *line;
-    int         result = 0;
+    // Learn about block extent.
+    long top;
+    long bottom;
+    block_limits(top, bottom);
+
+    // If block is off the end of the file, return at once.
+    if( top > file_data.size( ) ) return true;
+
+    return write_lines( disk, top, bottom );
+}
+
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+DiskEditFile::DiskEditFile( ) :
+    following     ( false ),
+    follow_pinned ( false ),
+    follow_partial( false ),
+    follow_offset ( 0 ),
+    follow_size   ( 0 ),
+  #if eOPSYS == ePOSIX
+    follow_device ( 0 ),
+    follow_inode  ( 0 ),
+  #endif
+    base_known    ( false ),
+    base_pending  ( false )
+{
+  #if eOPSYS == ePOSIX
+    file_time = 0;
+  #else
+    file_date = 0;
+    file_time = 0;
+  #endif
+}
+
+
+//! The journal is deleted since the file's changes are no longer wanted.
+DiskEditFile::~DiskEditFile( )
+{
+    end_journal( );
+}
+
+
+/*!
+ * Starts following the named file, as "tail -f" does. The text is replaced by the file's
+ * current contents. Afterwards follow( ) adds whatever is written to the end of the file.
+ *
+ * \param the_name The name of the file to follow. It need not exist yet.
+ * \param pinned True if the cursor should be kept at the end of the file.
+ * \return false if the file can't be followed because its text was changed or it is shown
+ * read-only. Nothing is done in that case.
+ */
+bool DiskEditFile::start_following( const char *the_name, bool pinned )
+{
+    if( is_changed  ||  file_data.has_view( ) ) return false;
+
+    // Followed files are never merged or journaled.
+    base.clear( );
+    base_known     = false;
+    base_pending   = false;
+    restart_journal( );
+    file_data.clear( );
+    following      = true;
+    follow_pinned  = pinned;
+    follow_partial = false;
+    follow_offset  = 0;
+    follow_size    = 0;
+  #if eOPSYS == ePOSIX
+    follow_device  = 0;
+    follow_inode   = 0;
+  #endif
+    follow( the_name );
+    return true;
+}
+
+
+/*!
+ * Reads the text written to the end of a followed file since it was last read. Only the new
+ * text is read. A line that was incomplete when it was read is made again with the text added
+ * to it.
+ *
+ * If the file was truncated or replaced by another file (as when a log is rotated), it is read
+ * again from its beginning so that the text always matches the file. However, if the text has
+ * been changed here, following stops instead so that the changes aren't lost.
+ *
+ * \param the_name The name of the followed file.
+ * \return true if the text changed.
+ */
+bool DiskEditFile::follow( const char *the_name )
+{
+    if( !following ) return false;
+
+    // Find out if the file changed at all. It might not exist while it is being replaced.
+    long size;
+    bool replaced = false;
+  #if eOPSYS == ePOSIX
+    struct stat file_status;
+    if( stat( the_name, &file_status ) != 0 ) return false;
+    size     = static_cast< long >( file_status.st_size );
+    replaced = ( file_status.st_dev != follow_device  ||  file_status.st_ino != follow_inode );
+  #else
+    FileNameMatcher stamper;
+    stamper.set_name( the_name );
+    if( stamper.next( ) == NULL ) return false;
+    size = static_cast< long >( stamper.size( ) );
+  #endif
+    if( !replaced  &&  size == follow_size ) return false;
+
+    std::FILE *disk = std::fopen( the_name, "r" );
+    if( disk == NULL ) return false;
+
+    // Check the file actually opened; it might have been replaced again.
+  #if eOPSYS == ePOSIX
+    if( fstat( fileno( disk ), &file_status ) != 0 ) {
+        std::fclose( disk );
+        return false;
+    }
+    size     = static_cast< long >( file_status.st_size );
+    replaced = ( file_status.st_dev != follow_device  ||  file_status.st_ino != follow_inode );
+    follow_device = file_status.st_dev;
+    follow_inode  = file_status.st_ino;
+  #endif
+
+    // A file that was truncated might have grown past its old size again. If so, there is
+    // probably no longer a newline where the last complete line ended.
+    if( size < follow_size ) replaced = true;
+    if( !replaced  &&  follow_offset > 0 ) {
+        if( std::fseek( disk, follow_offset - 1, SEEK_SET ) != 0  ||  std::fgetc( disk ) != '\n' )
+            replaced = true;
+    }
 
-    // Learn about block extent.
-    long top;
-    long bottom;
-    block_limits(top, bottom);
+    if( replaced ) {
+        if( is_changed ) {
+            std::fclose( disk );
+            following = false;
+            warning_message( "%s was replaced. No longer following it", the_name );
+            return false;
+        }
+        file_data.clear( );
+        follow_partial = false;
+        follow_offset  = 0;
+    }
+    else if( follow_partial ) {
+        file_data.jump_to( file_data.size( ) - 1 );
+        delete file_data.release( );
+        follow_partial = false;
+    }
 
-    // If block is off the end of the file, return at once.
-    if( top > file_data.size( ) ) return true;
+    TextBlock *block = NULL;
+    if( std::fseek( disk, follow_offset, SEEK_SET ) == 0 ) block = read_block( disk );
+    std::fclose( disk );
+    if( block == NULL ) {
+        following = false;
+        memory_message( "Can't follow file" );
+        return true;
+    }
 
-    // For each line in the block...
-    file_data.jump_to( top );
-    while ( result != EOF    &&
-            top++ <= bottom  &&
-            ( line = file_data.next( ) ) != NULL ) {
-        result = write_line( line, disk );
+    // Make the complete lines and then the incomplete one, if any.
+    const char *const text     = block->data( );
+    std::size_t       complete = block->size( );
+    while( complete > 0  &&  text[complete - 1] != '\n' ) --complete;
+    try {
+        file_data.set_end( );
+        parse_text( block, 0, complete, file_data );
+        const long lines = file_data.size( );
+        parse_text( block, complete, block->size( ), file_data );
+        follow_partial = ( file_data.size( ) > lines );
     }
+    catch( std::bad_alloc & ) {
+        following = false;
+        memory_message( "Can't follow file" );
+    }
+    follow_size    = follow_offset + static_cast< long >( block->size( ) );
+    follow_offset += static_cast< long >( complete );
+    block->release( );
 
-    return static_cast< bool >( result != EOF );
+    set_timestamp( the_name );
+    return true;
 }
 
 
-/*====================================*/
-/*           Public Members           */
-/*====================================*/
-
 /*!
  * Sets the date and time stamp for a file to match that given by the file with the specified
  * name. If the file with the specified name does not exist, the date and time stamp of the
@@ -252,6 +1803,11 @@ void DiskEditFile::mark_as_unchanged( )
  * Tries to load the named file into the object. Since it uses read_file() from above, this load
  * will insert the named file into whatever is currently in the object. By making sure the
  * object is initially empty, this function can do complete loads as well as insertions.
+ *
+ * A large file loaded into an empty object is loaded lazily by a LazyLoader. In that case this
+ * function returns at once and the lines are made as they are needed. Problems reading the
+ * file are reported when the last line is made. A file too large to load (see view_size) is
+ * shown read-only by a MappedView instead.
  */
 bool DiskEditFile::load( const char *the_name )
 {
@@ -262,6 +1818,7 @@ bool DiskEditFile::load( const char *the_name )
     // to prevent the extend operation from, effectively, inserting an extra line in the file.
     //
     if( !extend_to_line( current_point.cursor_line( ) - 1 ) ) return false;
+    const long old_size = ( journal != NULL ) ? file_data.size( ) : 0;
     file_data.jump_to( current_point.cursor_line( ) );
 
     // Try to open the file.
@@ -271,6 +1828,24 @@ bool DiskEditFile::load( const char *the_name )
         return false;
     }
 
+    // A large file loaded into an empty object is loaded lazily or, if it is huge, shown.
+    if( file_data.size( ) == 0 ) {
+      #if eOPSYS == ePOSIX
+        MappedView *const view = MappedView::open( disk );
+        if( view != NULL ) {
+            std::fclose( disk );
+            file_data.set_view( view );
+            restart_journal( );
+            return true;
+        }
+      #endif
+        LazyLoader *const loader = LazyLoader::start( disk, the_name );
+        if( loader != NULL ) {
+            file_data.set_source( loader );
+            return true;
+        }
+    }
+
     // Inform the user that we're reading a file.
     std::string buffer( "Reading " );
     buffer.append( the_name );
@@ -288,10 +1863,376 @@ bool DiskEditFile::load( const char *the_name )
         warning_message( "Problems reading %s. File may be incomplete", the_name );
     }
 
+    journal_insert( current_point.cursor_line( ), file_data.size( ) - old_size );
+    return result;
+}
+
+
+/*!
+ * Replaces the text with the current contents of the named file, as when the file was changed
+ * by another program. Any changes made here are lost. If the text is all in memory, only the
+ * lines that differ are replaced (see merge_disk( )) and the cursor stays with its line.
+ * Otherwise the file is loaded again as load( ) would load it and the cursor is left where it
+ * was.
+ *
+ * \param the_name The name of the file to read.
+ * \return false if the file couldn't be read. The text might then be incomplete.
+ */
+bool DiskEditFile::reload( const char *the_name )
+{
+    bool result = false;
+    bool merged = false;
+
+    // The journal is started again afterwards.
+    delete journal;
+    journal = NULL;
+
+    // Files too large to load now are shown instead.
+    if( !file_data.has_source( )  &&  !file_data.has_view( ) ) {
+        std::FILE *const disk = std::fopen( the_name, "r" );
+        if( disk != NULL ) {
+          #if eOPSYS == ePOSIX
+            struct stat file_status;
+            const bool show = ( fstat( fileno( disk ), &file_status ) == 0  &&
+                                MappedView::must_show( file_status ) );
+          #else
+            const bool show = false;
+          #endif
+            if( !show ) {
+                result = merge_disk( disk );
+                merged = true;
+            }
+            std::fclose( disk );
+        }
+    }
+
+    if( !merged ) {
+        const FilePosition point = current_point;
+        file_data.clear( );
+        current_point.jump_to_line( 0 );
+        current_point.jump_to_column( 0 );
+        result = load( the_name );
+        current_point = point;
+    }
+    else if( !result ) {
+        warning_message( "Problems reading %s. File may be incomplete", the_name );
+    }
+
+    set_timestamp( the_name );
+    is_changed = false;
+    if( !merged ) remember_base( );
+    else restart_journal( );
     return result;
 }
 
 
+/*!
+ * Merges the changes made to the named file by another program with the changes made here.
+ * Both the file and the text are compared with the base version, the text last loaded or
+ * saved (see remember_base( )). Where only the file changed, its new lines replace the text's.
+ * Where only the text changed, it is kept. Where both changed differently, the text's lines
+ * are kept, followed by the file's, and the two are marked by lines like those of diff3:
+ *
+ *     <<<<<<< buffer
+ *     (the lines of the text)
+ *     =======
+ *     (the lines of the file)
+ *     >>>>>>> disk
+ *
+ * Only the lines that change are moved, and the cursor stays with its line. Afterwards the
+ * file is the base version.
+ *
+ * The base version is kept only as the hashes of its lines, so lines are taken to be the same
+ * as the base's if their hashes are equal. Trailing spaces are ignored since they are not
+ * saved.
+ *
+ * \param the_name The name of the file to read.
+ * \param conflicts Set to the number of places where both the file and the text changed.
+ * \return false if the changes couldn't be merged. This happens if the base version isn't
+ * known, if the text isn't all in memory, or if the file can't be read. Nothing is done in
+ * that case.
+ */
+bool DiskEditFile::merge( const char *the_name, long &conflicts )
+{
+    conflicts = 0;
+    if( !base_known  ||  file_data.has_source( )  ||  file_data.has_view( ) ) return false;
+
+    std::FILE *const disk = std::fopen( the_name, "r" );
+    if( disk == NULL ) return false;
+  #if eOPSYS == ePOSIX
+    struct stat file_status;
+    if( fstat( fileno( disk ), &file_status ) != 0  ||  MappedView::must_show( file_status ) ) {
+        std::fclose( disk );
+        return false;
+    }
+  #endif
+    TextBlock *const block = read_block( disk );
+    const bool read_error = ( std::ferror( disk ) != 0 );
+    std::fclose( disk );
+    if( block == NULL ) {
+        memory_message( "Can't read entire file" );
+        return false;
+    }
+    DiskVersion disk_version( block );
+    if( read_error ) return false;
+
+    // Everything that might fail is done before file_data is touched.
+    std::vector< EditBuffer * >  local_lines;
+    std::vector< std::uint64_t > local_hashes;
+    std::vector< LineEdit >      edits;
+    EditList replacements;
+    try {
+        collect_lines( file_data, local_lines, local_hashes );
+        disk_version.scan( );
+        const std::vector< std::uint64_t > &disk_hashes = disk_version.hashes( );
+
+        // Find the line of each version matching each line of the base, if any.
+        const long base_size = static_cast< long >( base.size( ) );
+        std::vector< long > local_match( base_size + 1, -1 );
+        std::vector< long > disk_match( base_size + 1, -1 );
+        const auto same = []( long, long ) { return true; };
+        for( const CommonRun &run : common_runs( base, local_hashes, same ) ) {
+            for( long i = 0; i < run.length; ++i ) {
+                local_match[run.old_start + i] = run.new_start + i;
+            }
+        }
+        for( const CommonRun &run : common_runs( base, disk_hashes, same ) ) {
+            for( long i = 0; i < run.length; ++i ) {
+                disk_match[run.old_start + i] = run.new_start + i;
+            }
+        }
+        local_match[base_size] = static_cast< long >( local_lines.size( ) );
+        disk_match[base_size]  = disk_version.size( );
+
+        // Lines of the base in both versions divide the versions into chunks.
+        long base_next  = 0;
+        long local_next = 0;
+        long disk_next  = 0;
+        for( long i = 0; i <= base_size; ++i ) {
+            if( local_match[i] < 0  ||  disk_match[i] < 0 ) continue;
+
+            const long local_end = local_match[i];
+            const long disk_end  = disk_match[i];
+            const bool local_same =
+                unchanged( local_match, base_next, i, local_next, local_end );
+            const bool disk_same =
+                unchanged( disk_match, base_next, i, disk_next, disk_end );
+            bool both_same = false;
+            if( !local_same  &&  !disk_same  &&  local_end - local_next == disk_end - disk_next ) {
+                both_same = std::equal( local_hashes.begin( ) + local_next,
+                                        local_hashes.begin( ) + local_end,
+                                        disk_hashes.begin( ) + disk_next );
+            }
+
+            if( local_same  &&  !disk_same ) {
+                edits.push_back(
+                    LineEdit{ local_next, local_end - local_next, disk_end - disk_next } );
+                for( long j = disk_next; j < disk_end; ++j ) {
+                    replacements.insert( disk_version.take_line( j ) );
+                }
+            }
+            else if( !local_same  &&  !disk_same  &&  !both_same ) {
+                edits.push_back( LineEdit{ local_next, 0, 1 } );
+                replacements.insert( new EditBuffer( "<<<<<<< buffer" ) );
+                edits.push_back( LineEdit{ local_end, 0, disk_end - disk_next + 2 } );
+                replacements.insert( new EditBuffer( "=======" ) );
+                for( long j = disk_next; j < disk_end; ++j ) {
+                    replacements.insert( disk_version.take_line( j ) );
+                }
+                replacements.insert( new EditBuffer( ">>>>>>> disk" ) );
+                ++conflicts;
+            }
+            base_next  = i + 1;
+            local_next = local_end + 1;
+            disk_next  = disk_end + 1;
+        }
+    }
+    catch( std::bad_alloc & ) {
+        memory_message( "Can't merge the changes made on disk" );
+        conflicts = 0;
+        return false;
+    }
+
+    delete journal;
+    journal = NULL;
+    apply_edits( file_data, current_point, edits, replacements );
+    base.swap( disk_version.hashes( ) );
+    set_timestamp( the_name );
+    is_changed = true;
+    restart_journal( );
+    return true;
+}
+
+
+/*!
+ * Makes the text the base version for merge( ). This is done when the text matches the file,
+ * after it is loaded. If the file is still being loaded the base version is taken when loading
+ * finishes (see continue_loading( )). Files shown read-only are never merged.
+ */
+void DiskEditFile::remember_base( )
+{
+    base.clear( );
+    base_known   = false;
+    base_pending = false;
+    if( file_data.has_view( )  ||  file_data.has_source( ) ) {
+        base_pending = file_data.has_source( );
+        restart_journal( );
+        return;
+    }
+
+    std::vector< EditBuffer * > lines;
+    try {
+        collect_lines( file_data, lines, base );
+        base_known = true;
+    }
+    catch( std::bad_alloc & ) {
+        base.clear( );
+    }
+    restart_journal( );
+}
+
+
+/*!
+ * Makes the text just saved the base version for merge( ). The text is the one in the
+ * snapshot, which is no longer the text being edited if it changed during the save. The file's
+ * time stamp becomes that of the text saved, not that of whatever is on the disk now.
+ *
+ * \param saved The snapshot that was saved.
+ */
+void DiskEditFile::remember_save( SaveSnapshot &saved )
+{
+    #if eOPSYS == ePOSIX
+    if( saved.written_time( ) != 0 ) file_time = saved.written_time( );
+    else set_timestamp( saved.name( ) );
+    #else
+    set_timestamp( saved.name( ) );
+    #endif
+    base_pending = false;
+    base_known = saved.take_hashes( base );
+    if( !base_known ) base.clear( );
+    restart_journal( );
+}
+
+
+/*!
+ * Makes up to count more lines of a file being loaded lazily, if they are ready. When loading
+ * finishes, the text becomes the base version for merge( ) unless it was changed meanwhile.
+ *
+ * \return true if the file is still being loaded.
+ */
+bool DiskEditFile::continue_loading( long count )
+{
+    if( file_data.fill_more( count ) ) return true;
+    if( base_pending ) {
+        if( is_changed ) base_pending = false;
+        else remember_base( );
+    }
+    return false;
+}
+
+
+/*!
+ * Looks for the journal of the named file left by an earlier session. Such a journal holds
+ * changes that were never saved; see recover( ).
+ */
+DiskEditFile::JournalStatus DiskEditFile::find_journal( const char *the_name )
+{
+    bool in_use;
+    if( !Journal::find( Journal::name_for( the_name ), in_use ) ) return NO_JOURNAL;
+    return in_use ? JOURNAL_IN_USE : OLD_JOURNAL;
+}
+
+
+/*!
+ * Recovers the changes in the journal of the named file left by an earlier session. The
+ * journal's changes are made to the text, which must be the file as it was loaded. Problems
+ * are reported to the user.
+ *
+ * \param the_name The name of the file.
+ * \return true if any changes were recovered.
+ */
+bool DiskEditFile::recover( const char *the_name )
+{
+    if( file_data.has_view( ) ) {
+        warning_message( "%s is read only. Its unsaved changes can't be recovered", the_name );
+        return false;
+    }
+
+    // The journal's base version is the whole file.
+    file_data.complete( );
+    if( !base_known ) remember_base( );
+    Journal::Status status = Journal::MISSING;
+    if( base_known ) {
+        try {
+            const std::string journal_name = Journal::name_for( the_name );
+            status = Journal::replay( journal_name, Journal::digest( base ), file_data );
+        }
+        catch( std::bad_alloc & ) {
+            status = Journal::DAMAGED;
+        }
+    }
+
+    switch( status ) {
+    case Journal::REPLAYED:
+        info_message( "Recovered the unsaved changes to %s", the_name );
+        break;
+    case Journal::DAMAGED:
+        warning_message( "Some of the unsaved changes to %s could not be recovered", the_name );
+        break;
+    case Journal::MISMATCHED:
+        warning_message( "%s changed after its journal was written. Nothing recovered", the_name );
+        return false;
+    case Journal::MISSING:
+        error_message( "Can't read the journal of %s", the_name );
+        return false;
+    }
+    is_changed = true;
+    return true;
+}
+
+
+/*!
+ * Starts recording the changes made to the text in a journal so that they can be recovered if
+ * Y dies before they are saved (see recover( )). The journal is kept up to date as the file is
+ * saved or reloaded, and is deleted while the text matches the file on disk.
+ *
+ * Any journal left by an earlier session is replaced, so it should be recovered first.
+ *
+ * \param the_name The name of the file.
+ */
+void DiskEditFile::start_journal( const char *the_name )
+{
+    journal_name = Journal::name_for( the_name );
+    restart_journal( );
+}
+
+
+//! Stops recording changes and deletes the journal. This is done when changes are discarded.
+void DiskEditFile::end_journal( )
+{
+    delete journal;
+    journal = NULL;
+    if( !journal_name.empty( ) ) std::remove( journal_name.c_str( ) );
+    journal_name.clear( );
+}
+
+
+/*!
+ * Writes the changes recorded in the journal. If the journal can't be written, the user is told
+ * and journaling stops.
+ *
+ * \return false if the journal couldn't be written.
+ */
+bool DiskEditFile::flush_journal( )
+{
+    if( journal == NULL  ||  journal->flush( file_data.size( ) ) ) return true;
+
+    warning_message( "Can't write %s. Changes can't be recovered", journal_name.c_str( ) );
+    end_journal( );
+    return false;
+}
+
+
 /*!
  * Saves the data to the named file. Depending on save_mode either the whole file is saved or
  * just the active block is saved. This function is complicated by the need to check the result
@@ -302,9 +2243,24 @@ bool DiskEditFile::load( const char *the_name )
  * Although this is kind of a pain, it leaves write_file() generic. For example, write_file()
  * could be used several times to write different chunks of data to the same file (although Y
  * currently does not do this).
+ *
+ * If save_method is ATOMIC the file is replaced with save_atomic() when that is possible. It is
+ * not possible if the file has more than one hard link (the links would be broken), if the
+ * file or its directory can't be written, or on systems other than POSIX. In those cases the
+ * file is saved in place as usual.
  */
-bool DiskEditFile::save( const char *the_name, Mode save_mode )
+bool DiskEditFile::save( const char *the_name, Mode save_mode, Method save_method )
 {
+    // The file might be the one being loaded. Finish loading it before it is overwritten.
+    file_data.complete( );
+
+    #if eOPSYS == ePOSIX
+    if( save_method == ATOMIC ) {
+        const std::string target = replacement_target( the_name );
+        if( can_replace( target ) ) return save_atomic( the_name, target, save_mode );
+    }
+    #endif
+
     // We don't attempt to deal with read-only files intelligently on POSIX.
     #if eOPSYS != ePOSIX
     bool read_only = false;
@@ -360,6 +2316,43 @@ bool DiskEditFile::save( const char *the_name, Mode save_mode )
         return false;
     }
 
+    bool result = write_file( disk, the_name, save_mode, false );
+
+    // Tell user if there are problems.
+    if( result == false ) {
+        warning_message( "Problems writing %s. File may have been incompletely saved", the_name );
+    }
+
+    #if eOPSYS != ePOSIX
+    // If we converted this file's attributes, set them back. We can assume this will work... we
+    // must have successfully changed the file's attributes above in order to be here! Note that
+    // by doing this conditionally, we reduce the number of OS system calls.
+    //
+    if (read_only) {
+        #if eOPSYS == eWIN32
+        SetFileAttributes( the_name, file_attributes );
+        #else
+        _dos_setfileattr( the_name, file_attributes );
+        #endif
+    }
+    #endif
+    return result;
+}
+
+
+//! Writes the data to an open file and closes the file.
+/*!
+ * A message is displayed while the file is written. If durable is true, the file's data is
+ * forced to the disk before the file is closed.
+ *
+ * \param disk The file to write. It is closed even if an error occurs.
+ * \param the_name The name of the file as it should be shown to the user.
+ * \param save_mode Whether the entire file or only the active block is written.
+ * \param durable True if the data must be on the disk when this function returns.
+ * \return false if any write (or the close) failed. No message is displayed in that case.
+ */
+bool DiskEditFile::write_file( std::FILE *disk, const char *the_name, Mode save_mode, bool durable )
+{
     // Tell user we're working on this file.
     std::string buffer( "Writing " );
     buffer.append( the_name );
@@ -372,31 +2365,186 @@ bool DiskEditFile::save( const char *the_name, Mode save_mode )
     if( save_mode == ALL ) result1 = write_disk( disk );
     else result1 = write_disk_block( disk );
 
-    bool result2 = static_cast< bool >( std::fclose( disk ) == 0 );
+    bool result2 = close_file( disk, durable  &&  result1 );
 
     // Close teaser window after std::fclose() since std::fclose() does writes too.
     teaser.close( );
 
-    // result == true only if both Write_Disk() and std::fclose() worked.
-    bool result = static_cast< bool >( result1 == true  &&  result2 == true );
+    // result == true only if both write_disk() and std::fclose() worked.
+    return static_cast< bool >( result1 == true  &&  result2 == true );
+}
 
-    // Tell user if there are problems.
-    if( result == false ) {
-        warning_message( "Problems writing %s. File may have been incompletely saved", the_name );
+
+//! Makes a snapshot of the entire file for saving under the given name.
+/*!
+ * \return A new snapshot owned by the caller.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+SaveSnapshot *DiskEditFile::snapshot( const char *the_name )
+{
+    std::vector< EditBuffer > lines;
+    copy_lines( lines );
+    return new SaveSnapshot( the_name, std::move( lines ) );
+}
+
+
+//! Copies every line of the file. The copies share the text of lines that borrow their text.
+/*!
+ * The copies can be read by other threads while the file is edited. Like all EditBuffers they
+ * must be destroyed by the main thread.
+ *
+ * \param lines Receives the copies, replacing whatever it held.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void DiskEditFile::copy_lines( std::vector< EditBuffer > &lines )
+{
+    lines.clear( );
+    lines.reserve( file_data.size( ) );
+
+    EditBuffer *line;
+    file_data.jump_to( 0 );
+    while( ( line = file_data.next( ) ) != NULL ) lines.push_back( *line );
+}
+
+
+#if eOPSYS == ePOSIX
+
+//! Saves the data by replacing the target file with a new file.
+/*!
+ * The data is written to a temporary file in the target's directory. The temporary file is
+ * given the target's permissions and (if possible) its owner and group, it is forced to the
+ * disk, and then it is renamed over the target. The rename is atomic so the target holds
+ * either its old contents or the complete new contents at all times, even if the system
+ * crashes or the disk fills. Finally the directory is forced to the disk so the rename itself
+ * survives a crash.
+ *
+ * \param the_name The name of the file as given by the user.
+ * \param target The file to replace. This is the_name with any symbolic link resolved.
+ * \param save_mode Whether the entire file or only the active block is written.
+ * \return false if the file could not be saved. The target is unchanged in that case.
+ */
+bool DiskEditFile::save_atomic( const char *the_name, const std::string &target, Mode save_mode )
+{
+    std::string temporary;
+    std::FILE *const disk = open_replacement( target, temporary );
+    if( disk == NULL ) {
+        error_message( "Can't create a temporary file for %s", the_name );
+        return false;
     }
 
-    #if eOPSYS != ePOSIX
-    // If we converted this file's attributes, set them back. We can assume this will work... we
-    // must have successfully changed the file's attributes above in order to be here! Note that
-    // by doing this conditionally, we reduce the number of OS system calls.
-    //
-    if (read_only) {
-        #if eOPSYS == eWIN32
-        SetFileAttributes( the_name, file_attributes );
-        #else
-        _dos_setfileattr( the_name, file_attributes );
-        #endif
+    bool result = write_file( disk, the_name, save_mode, true );
+    if( !result ) std::remove( temporary.c_str( ) );
+    else result = replace_with( temporary, target );
+    if( !result ) {
+        warning_message( "Problems writing %s. The file was not changed", the_name );
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+/*==================================*/
+/*           SaveSnapshot           */
+/*==================================*/
+
+SaveSnapshot::SaveSnapshot( const char *the_name, std::vector< EditBuffer > &&the_lines ) :
+    file_name ( the_name ),
+    lines     ( std::move( the_lines ) ),
+    error_code( 0 ),
+    hashed    ( false )
+  #if eOPSYS == ePOSIX
+    , written ( 0 )
+  #endif
+{ }
+
+
+//! Writes the snapshot to its file.
+/*!
+ * The file is replaced atomically when DiskEditFile::save would do so with the ATOMIC method.
+ * Otherwise it is written in place. Nothing is displayed and the user is never asked anything,
+ * so unlike DiskEditFile::save this function doesn't try to deal with read-only files.
+ *
+ * \return false if the file could not be saved. The reason is given by error( ).
+ */
+bool SaveSnapshot::save( )
+{
+    bool atomic = false;
+    std::string temporary;
+
+    #if eOPSYS == ePOSIX
+    const std::string target = replacement_target( file_name.c_str( ) );
+    atomic = can_replace( target );
+    #endif
+
+    std::FILE *disk = NULL;
+    #if eOPSYS == ePOSIX
+    if( atomic ) disk = open_replacement( target, temporary );
+    #endif
+    if( !atomic ) disk = std::fopen( file_name.c_str( ), "w" );
+    if( disk == NULL ) {
+        error_code = errno;
+        return false;
+    }
+
+    // Write the lines, then close the file. Remember the first problem.
+    LineWriter writer( disk );
+    bool result = true;
+    for( std::size_t i = 0; result  &&  i < lines.size( ); ++i ) {
+        result = writer.put_line( lines[i] );
+    }
+    if( !writer.flush( ) ) result = false;
+    error_code = result ? 0 : errno;
+
+    // The time stamp of the text written is taken now. Once the file is in place another program
+    // might change it before the main thread looks at it.
+    #if eOPSYS == ePOSIX
+    written = 0;
+    struct stat written_status;
+    if( result  &&  std::fflush( disk ) == 0  &&  fstat( fileno( disk ), &written_status ) == 0 ) {
+        written = modify_time( written_status );
     }
     #endif
+    if( !close_file( disk, atomic  &&  result )  &&  result ) {
+        error_code = errno;
+        result = false;
+    }
+
+    #if eOPSYS == ePOSIX
+    if( atomic ) {
+        if( !result ) std::remove( temporary.c_str( ) );
+        else if( !replace_with( temporary, target ) ) {
+            error_code = errno;
+            result = false;
+        }
+    }
+    #endif
+
+    // The text saved is the base version of the file for DiskEditFile::merge.
+    hashed = false;
+    if( result ) {
+        try {
+            hashes.clear( );
+            hashes.reserve( lines.size( ) );
+            for( const EditBuffer &line : lines ) hashes.push_back( line_hash( line ) );
+            hashed = true;
+        }
+        catch( std::bad_alloc & ) { }
+    }
     return result;
 }
+
+
+//! Gets the hashes of the lines saved by the last successful save( ).
+/*!
+ * The hashes are taken, so this should only be called once after a save.
+ *
+ * \return false if the hashes are not known.
+ */
+bool SaveSnapshot::take_hashes( std::vector< std::uint64_t > &the_hashes )
+{
+    if( !hashed ) return false;
+    the_hashes.swap( hashes );
+    hashed = false;
+    return true;
+}
@@ -6,12 +6,56 @@
 #ifndef DISKEDITFILE_HPP
 #define DISKEDITFILE_HPP
 
+#include <cstdint>
 #include <cstdio>
 #include <ctime>
+#include <string>
+#include <vector>
 
 #include "environ.hpp"
+#include "EditBuffer.hpp"
 #include "EditFile.hpp"
 
+#if eOPSYS == ePOSIX
+#include <sys/types.h>
+#endif
+
+//! A copy of the text of a file that can be saved while the file itself is being edited.
+/*!
+ * Making a snapshot is quick because lines that borrow their text share it with the file.
+ * Saving a snapshot displays nothing and uses nothing but the snapshot so it can be done by a
+ * background thread. However snapshots must be created and destroyed by the main thread since
+ * EditBuffers get their storage from pools that are not thread safe.
+ */
+class SaveSnapshot {
+public:
+    SaveSnapshot( const char *the_name, std::vector< EditBuffer > &&the_lines );
+
+    //! Returns the name of the file to which the snapshot is saved.
+    const char *name( ) const { return file_name.c_str( ); }
+
+    //! Returns the system error code of the last failed save (zero if the cause is unknown).
+    int error( ) const { return error_code; }
+
+  #if eOPSYS == ePOSIX
+    //! Returns the modification time of the text written by the last save (zero if unknown).
+    long long written_time( ) const { return written; }
+  #endif
+
+    bool save( );
+    bool take_hashes( std::vector< std::uint64_t > &hashes );
+
+private:
+    std::string                  file_name;   //!< The name of the file to write.
+    std::vector< EditBuffer >    lines;       //!< The text to write.
+    int                          error_code;  //!< Explains why the last save failed.
+    std::vector< std::uint64_t > hashes;      //!< The hash of each line saved.
+    bool                         hashed;      //!< True if hashes is complete.
+  #if eOPSYS == ePOSIX
+    long long                    written;     //!< Modification time of the text saved.
+  #endif
+};
+
 //! Adds disk I/O features to EditFile.
 /*!
  * DiskEditFile adds basic disk I/O operations to EditFile objects. Notice that this class does
@@ -22,20 +66,41 @@ class DiskEditFile : private virtual EditFile {
 
 private:
   #if eOPSYS == ePOSIX
-    time_t file_time;
+    long long file_time;          //!< Time stamp of file in nanoseconds.
   #else
     unsigned  file_date;          //!< Date stamp of file.
     unsigned  file_time;          //!< Time stamp of file.
   #endif
 
+    // Used while the file is followed. See follow( ).
+    bool  following;              //!< True if the file is being followed.
+    bool  follow_pinned;          //!< True if the cursor is kept at the end of the file.
+    bool  follow_partial;         //!< True if the last line was made from text after follow_offset.
+    long  follow_offset;          //!< Offset in the file just past the last complete line read.
+    long  follow_size;            //!< Number of bytes of the file that have been read.
+  #if eOPSYS == ePOSIX
+    dev_t follow_device;          //!< Device holding the file that was read.
+    ino_t follow_inode;           //!< I-node of the file that was read.
+  #endif
+
+    // The base version of the file for merge( ): the text last loaded or saved.
+    std::vector< std::uint64_t > base;  //!< The hash of each line of the base version.
+    bool  base_known;             //!< True if base is the base version.
+    bool  base_pending;           //!< True if the base is the text when loading finishes.
+
+    std::string journal_name;     //!< The journal file, or empty if the file isn't journaled.
+
 protected:
     bool read_disk( std::FILE * );
     bool write_disk( std::FILE * );
     bool write_disk_block( std::FILE * );
 
 public:
+    DiskEditFile( );
+   ~DiskEditFile( );
+
   #if eOPSYS == ePOSIX
-    time_t   time( )  { return file_time; }
+    long long time( )  { return file_time; }
   #else
     unsigned date( )  { return file_date;  }
     unsigned time( )  { return file_time;  }
@@ -47,8 +112,83 @@ public:
     void mark_as_unchanged( );
 
     enum Mode { ALL, BLOCK_ONLY };
+
+    //! How an existing file is replaced when it is saved.
+    /*!
+     * IN_PLACE truncates and rewrites the file. ATOMIC writes a temporary file in the same
+     * directory, forces it to disk, and renames it over the original so that the file always
+     * holds either the old text or the new text.
+     */
+    enum Method { IN_PLACE, ATOMIC };
+
+    //! Files at least this large (in bytes) are parsed into lines by several threads.
+    /*!
+     * The result is the same as parsing them with one thread. Zero means never use threads.
+     */
+    static long parallel_load_size;
+
+    //! Files at least this large (in bytes) are shown read-only instead of being loaded.
+    /*!
+     * Such files are mapped into memory and only the lines in use are made, so they can be
+     * larger than the memory available. Zero means a quarter of the memory installed. Only
+     * supported on POSIX systems.
+     */
+    static unsigned long long view_size;
+
+    //! Returns true if the file is shown read-only. See view_size.
+    bool read_only( )  { return file_data.has_view( ); }
+
+    //! Returns true if the file is still being loaded lazily. See load( ).
+    bool loading( )  { return file_data.has_source( ); }
+
+    bool continue_loading( long count );
+
+    //! Returns true if the file is being followed. See follow( ).
+    bool is_following( )  { return following; }
+
+    //! Returns true if the cursor should be kept at the end of a followed file.
+    bool is_pinned( )  { return follow_pinned; }
+
+    bool start_following( const char *the_name, bool pinned );
+
+    //! Stops following the file. Its text is left as it is.
+    void stop_following( )  { following = false; }
+
+    bool follow( const char *the_name );
     bool load( const char *the_name );
-    bool save( const char *the_name, Mode save_mode = ALL );
+    bool reload( const char *the_name );
+    bool merge( const char *the_name, long &conflicts );
+    void remember_base( );
+    void remember_save( SaveSnapshot &saved );
+    bool save( const char *the_name, Mode save_mode = ALL, Method save_method = IN_PLACE );
+    SaveSnapshot *snapshot( const char *the_name );
+    void copy_lines( std::vector< EditBuffer > &lines );
+
+    //! What is known about the journal left by an earlier session. See find_journal( ).
+    enum JournalStatus {
+        NO_JOURNAL,      //!< There is no journal.
+        JOURNAL_IN_USE,  //!< The journal is being written by another Y that is still running.
+        OLD_JOURNAL      //!< The journal was left by a Y that didn't finish.
+    };
+
+    JournalStatus find_journal( const char *the_name );
+    bool recover( const char *the_name );
+    void start_journal( const char *the_name );
+    void end_journal( );
+
+    //! Returns true if the journal has changes that haven't been written.
+    bool journal_pending( )  { return journal != NULL  &&  journal->pending( ); }
+
+    bool flush_journal( );
+
+private:
+    void restart_journal( );
+    bool merge_disk( std::FILE * );
+    bool write_lines( std::FILE *, long first, long last );
+    bool write_file( std::FILE *, const char *the_name, Mode save_mode, bool durable );
+  #if eOPSYS == ePOSIX
+    bool save_atomic( const char *the_name, const std::string &target, Mode save_mode );
+  #endif
 };
 
 #endif
@@ -6,44 +6,241 @@
 #include <algorithm>
 #include <cstring>
 #include "EditBuffer.hpp"
+#include "SearchPattern.hpp"
 
 using namespace std;
 
 const int initial_capacity = 8;
 
-//! Find a power of two greater than a given amount.
+// Owned text storage up to this size is allocated from pools in steps of pool_step bytes.
+const size_t largest_pooled = 256;
+const size_t pool_step      = 16;
+
+//! Find a power of two at least as large as a given amount.
 /*!
  * This function is used to find the necessary capacity to hold a string of the provided size in
- * the buffer. The capacity returned includes extra space for a null byte.
+ * the buffer.
  *
- * \param required The number of non-null charcters that need to be held.
- * \return A power of two (at least 8) that is strictly greater than the requested size.
+ * \param required The number of charcters that need to be held.
+ * \return A power of two (at least 8) that is greater than or equal to the requested size.
  */
 static size_t round_up( const size_t required )
 {
     size_t result = initial_capacity;
-    while( result <= required ) {
+    while( result < required ) {
         result <<= 1;
     }
     return( result );
 }
 
+//! The pools one thread uses for EditBuffer objects and owned text storage.
+/*!
+ * Each thread allocates from its own pools so that several threads can make EditBuffers at once
+ * (for example, when a file is parsed in parallel). The pools are detached when the thread
+ * finishes. The EditBuffers it made can then be used and destroyed by another thread.
+ */
+struct ThreadPools {
+    SlabPool *objects;                                      //!< For EditBuffer objects.
+    SlabPool *workspaces[largest_pooled / pool_step + 1];  //!< For owned text, by size.
+
+    ThreadPools( ) : objects( NULL ), workspaces( ) { }
+   ~ThreadPools( );
+};
+
+ThreadPools::~ThreadPools( )
+{
+    if( objects != NULL ) objects->detach( );
+    for( SlabPool *pool : workspaces ) {
+        if( pool != NULL ) pool->detach( );
+    }
+}
+
+static thread_local ThreadPools thread_pools;
+
+
+//! Returns the pool used for EditBuffer objects by the calling thread.
+static SlabPool &object_pool( )
+{
+    if( thread_pools.objects == NULL ) {
+        thread_pools.objects = SlabPool::make( sizeof( EditBuffer ) );
+    }
+    return( *thread_pools.objects );
+}
+
+
+//! Returns the pool used for owned text storage of a given size by the calling thread.
+/*!
+ * \param capacity The size of the storage. Must not exceed largest_pooled.
+ */
+static SlabPool &workspace_pool( const size_t capacity )
+{
+    SlabPool **const pools = thread_pools.workspaces;
+
+    const size_t index = ( capacity + pool_step - 1 ) / pool_step;
+    if( pools[index] == NULL ) pools[index] = SlabPool::make( index * pool_step );
+    return( *pools[index] );
+}
+
+
+//! Allocate storage for owned text.
+/*!
+ * \param capacity The size of the storage. Must be greater than inline_capacity.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+char *EditBuffer::allocate_workspace( const size_t capacity )
+{
+    if( capacity > largest_pooled ) return new char[capacity];
+    return static_cast< char * >( workspace_pool( capacity ).allocate( ) );
+}
+
+
+//! Release storage obtained from allocate_workspace.
+/*!
+ * \param old_workspace The storage to release.
+ * \param capacity The size given to allocate_workspace when the storage was obtained.
+ */
+void EditBuffer::free_workspace( char *const old_workspace, const size_t capacity )
+{
+    if( capacity > largest_pooled ) delete [] old_workspace;
+    else SlabPool::release( old_workspace );
+}
+
+
+//! Give an empty, inline EditBuffer storage for a given amount of text.
+/*!
+ * If the text will fit in the inline storage nothing is done. Otherwise a dynamically allocated
+ * array of exactly the requested size is used.
+ *
+ * \param length The number of characters the buffer must be able to hold.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void EditBuffer::allocate( const size_t length )
+{
+    if( length <= inline_capacity ) return;
+    workspace = allocate_workspace( length );
+    capacity  = length;
+    block     = NULL;
+}
+
+
+//! Take over the text of another EditBuffer.
+/*!
+ * This EditBuffer must not be holding any storage. The other EditBuffer is left empty.
+ *
+ * \param other The EditBuffer that gives up its text.
+ */
+void EditBuffer::steal( EditBuffer &other )
+{
+    size = other.size;
+    gap  = other.gap;
+    if( other.is_inline( ) ) {
+        workspace = local;
+        capacity  = inline_capacity;
+        memcpy( local, other.local, inline_capacity );
+    }
+    else {
+        workspace = other.workspace;
+        capacity  = other.capacity;
+        block     = other.block;
+    }
+    other.workspace = other.local;
+    other.capacity  = inline_capacity;
+    other.size      = 0;
+    other.gap       = 0;
+}
+
+
+//! Make sure the buffer owns storage of at least a given size.
+/*!
+ * If the text is borrowed from a TextBlock it is copied into private storage and the reference
+ * to the block is released. The existing text is preserved and the gap stays at the same
+ * offset. If an exception occurs there is no effect.
+ *
+ * \param required The number of characters the buffer must be able to hold.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void EditBuffer::reserve( const size_t required )
+{
+    if( !is_borrowed( ) && required <= capacity ) return;
+
+    // Borrowed text that is short enough is copied to the inline storage.
+    const bool   use_local    = ( required <= inline_capacity );
+    const size_t new_capacity = use_local ? inline_capacity : round_up( required );
+    const size_t tail_length  = size - gap;
+    char *const new_workspace = use_local ? local : allocate_workspace( new_capacity );
+
+    // Remember the old storage; copying into the inline storage overwrites the block member.
+    TextBlock *const old_block     = is_borrowed( ) ? block : NULL;
+    char      *const old_workspace = workspace;
+    const size_t     old_capacity  = capacity;
+
+    memcpy( new_workspace, old_workspace, gap );
+    memcpy( new_workspace + new_capacity - tail_length, old_workspace + old_capacity - tail_length,
+            tail_length );
+    if( old_block != NULL ) {
+        old_block->release( );
+    }
+    else if( old_workspace != local ) {
+        free_workspace( old_workspace, old_capacity );
+    }
+    capacity  = new_capacity;
+    workspace = new_workspace;
+    if( !use_local ) block = NULL;
+}
+
+
+//! Move the gap to a given offset in the text.
+/*!
+ * The text must be owned. The cost is proportional to the distance the gap moves.
+ *
+ * \param offset The offset in the text where the gap should be. Must be <= size.
+ */
+void EditBuffer::move_gap( const size_t offset )
+{
+    if( offset < gap ) {
+        memmove( workspace + offset + gap_length( ), workspace + offset, gap - offset );
+    }
+    else if( offset > gap ) {
+        memmove( workspace + gap, workspace + gap + gap_length( ), offset - gap );
+    }
+    gap = offset;
+}
+
+
+//! Copy a range of the text to a contiguous array.
+/*!
+ * \param destination The array receiving the text. It must not overlap the text being copied.
+ * \param offset The offset of the first character to copy.
+ * \param count The number of characters to copy. The range must be inside the text.
+ */
+void EditBuffer::copy_text( char *const destination, const size_t offset, const size_t count ) const
+{
+    const size_t end = offset + count;
+    size_t before = 0;
+    if( offset < gap ) {
+        before = min( end, gap ) - offset;
+        memcpy( destination, workspace + offset, before );
+    }
+    if( end > gap ) {
+        const size_t start = max( offset, gap );
+        memcpy( destination + before, workspace + start + gap_length( ), end - start );
+    }
+}
+
 //-------------------------------------------------
 //           Constructors and destructor
 //-------------------------------------------------
 
 //! Default constructor
 /*!
- * Creates an initially empty EditBuffer object.
- *
- * \throws std::bad_alloc if insufficient memory available.
+ * Creates an initially empty EditBuffer object. No memory is allocated.
  */
 EditBuffer::EditBuffer( ) :
-    workspace( new char[initial_capacity] ),
-    capacity ( initial_capacity ),
-    size     ( 0 )
+    workspace( local ),
+    capacity ( inline_capacity ),
+    size     ( 0 ),
+    gap      ( 0 )
 {
-    workspace[0] = '\0';
     return;
 }
 
@@ -51,48 +248,88 @@ EditBuffer::EditBuffer( ) :
 //! Builds an EditBuffer from a c-style string
 /*!
  * Copies the given string into the EditBuffer. If the input parameter is NULL, this constructor
- * behaves identically to the default constructor.
+ * behaves identically to the default constructor. No excess capacity is allocated.
  *
  * \param str Pointer to a null terminated array of characters.
  * \throws std::bad_alloc if insufficient memory available.
  */
 EditBuffer::EditBuffer( const char *const str ) :
-    workspace( NULL ),
-    capacity ( 0 ),
-    size     ( 0 )
-{
-    if( str == NULL ) {
-        capacity  = initial_capacity;
-        workspace = new char[capacity];
-        size      = 0;
-        workspace[0] = '\0';
-    }
-    else {
-        const size_t incoming_length = strlen( str );
-        capacity = round_up( incoming_length );
-        workspace = new char[capacity];
-        memcpy( workspace, str, incoming_length + 1 );
-        size = incoming_length;
-    }
+    workspace( local ),
+    capacity ( inline_capacity ),
+    size     ( 0 ),
+    gap      ( 0 )
+{
+    const size_t incoming_length = ( str == NULL ) ? 0 : strlen( str );
+    allocate( incoming_length );
+    if( str != NULL ) memcpy( workspace, str, incoming_length );
+    size = gap = incoming_length;
+}
+
+
+//! Builds an EditBuffer from an array of characters
+/*!
+ * Copies the given characters into the EditBuffer. The characters need not be null terminated.
+ * No excess capacity is allocated.
+ *
+ * \param text Pointer to the first character to copy.
+ * \param length The number of characters to copy.
+ * \throws std::bad_alloc if insufficient memory available.
+ */
+EditBuffer::EditBuffer( const char *const text, const size_t length ) :
+    workspace( local ),
+    capacity ( inline_capacity ),
+    size     ( length ),
+    gap      ( length )
+{
+    allocate( length );
+    memcpy( workspace, text, length );
+}
+
+
+//! Builds an EditBuffer that borrows its text from a TextBlock
+/*!
+ * No text is copied. The new EditBuffer holds a reference to the block until its text is first
+ * modified (or until it is destroyed).
+ *
+ * \param source The block containing the text.
+ * \param offset The offset into the block where the text starts.
+ * \param length The number of characters of text.
+ */
+EditBuffer::EditBuffer( TextBlock *const source, const size_t offset, const size_t length ) :
+    workspace( source->data( ) + offset ),
+    capacity ( length ),
+    size     ( length ),
+    gap      ( length ),
+    block    ( source )
+{
+    block->acquire( );
 }
 
 //! Copy constructor
 /*!
- * The target object is given a capacity related to the length of the string and not necessarily
- * the same capacity as the source object.
+ * The target object is given a capacity that exactly fits the string and not necessarily the
+ * same capacity as the source object. If the source object borrows its text from a TextBlock,
+ * the new object borrows the same text and nothing is copied.
  *
  * \param existing The EditBuffer to copy.
  * \throws std::bad_alloc if there is insufficient memory.
  */
 EditBuffer::EditBuffer( const EditBuffer &existing ) :
-    workspace( NULL ),
-    capacity ( 0 ),
-    size     ( 0 )
-{
-    capacity = round_up( existing.size );
-    workspace = new char[capacity];
-    memcpy( workspace, existing.workspace, existing.size + 1 );
-    size = existing.size;
+    workspace( local ),
+    capacity ( inline_capacity ),
+    size     ( existing.size ),
+    gap      ( existing.size )
+{
+    if( existing.is_borrowed( ) ) {
+        workspace = existing.workspace;
+        capacity  = existing.capacity;
+        block     = existing.block;
+        block->acquire( );
+    }
+    else {
+        allocate( existing.size );
+        existing.copy_text( workspace, 0, existing.size );
+    }
     return;
 }
 
@@ -108,46 +345,175 @@ EditBuffer::EditBuffer( const EditBuffer &existing ) :
 EditBuffer &EditBuffer::operator=( const EditBuffer &existing )
 {
     if( this != &existing ) {
-        const size_t new_capacity = round_up( existing.size );
-        char  *const new_workspace = new char[new_capacity];
-        delete [] workspace;
-        capacity = new_capacity;
-        workspace = new_workspace;
-        memcpy( workspace, existing.workspace, existing.size + 1 );
-        size = existing.size;
+        EditBuffer temp( existing );
+        release_storage( );
+        steal( temp );
     }
     return( *this );
 }
 
-#ifdef NEVER
 //! Move constructor
-EditBuffer::EditBuffer( EditBuffer &&existing) :
-    workspace( existing.workspace ),
-    capacity ( existing.capacity  ),
-    size     ( existing.size      )
+/*!
+ * The new object takes over the text of the existing object without copying it (short text
+ * stored inline is copied). The existing object is left empty.
+ *
+ * \param existing The EditBuffer to move from.
+ */
+EditBuffer::EditBuffer( EditBuffer &&existing ) noexcept :
+    workspace( local ),
+    capacity ( inline_capacity ),
+    size     ( 0 ),
+    gap      ( 0 )
 {
-    existing.workspace = nullptr;
-    existing.capacity  = 0;
-    existing.size      = 0;
+    steal( existing );
 }
 
 
 //! Move assignment operator
-EditBuffer &EditBuffer::operator=( EditBuffer &&existing )
+/*!
+ * The target object releases its own text and takes over the text of the existing object
+ * without copying it. The existing object is left empty.
+ *
+ * \param existing The EditBuffer to move from.
+ */
+EditBuffer &EditBuffer::operator=( EditBuffer &&existing ) noexcept
 {
     if( this != &existing ) {
-        delete [] workspace;
-        workspace = existing.workspace;
-        capacity  = existing.capacity;
-        size      = existing.size;
-
-        existing.workspace = nullptr;
-        existing.capacity  = 0;
-        existing.size      = 0;
+        release_storage( );
+        steal( existing );
     }
     return( *this );
 }
-#endif
+
+
+//! Allocates memory for an EditBuffer object from the calling thread's pool.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void *EditBuffer::operator new( size_t )
+{
+    return object_pool( ).allocate( );
+}
+
+
+//! Returns the memory of an EditBuffer object to the pool it came from.
+void EditBuffer::operator delete( void *const object )
+{
+    SlabPool::release( object );
+}
+
+
+//-----------------------------
+//           Access
+//-----------------------------
+
+//! Copies text out of the EditBuffer.
+/*!
+ * This method is similar to std::string::copy. The copied text is not null terminated.
+ *
+ * \param destination The array receiving the text.
+ * \param count The maximum number of characters to copy.
+ * \param offset The offset of the first character to copy.
+ * \return The number of characters copied. This is less than count if the end of the text is
+ * reached first.
+ */
+size_t EditBuffer::copy( char *const destination, const size_t count, const size_t offset ) const
+{
+    if( offset >= size ) return 0;
+    const size_t actual = min( count, size - offset );
+    copy_text( destination, offset, actual );
+    return( actual );
+}
+
+
+//! Finds the first occurrence of a search pattern in the text.
+/*!
+ * \param pattern The pattern to find.
+ * \param offset The offset where the search starts.
+ * \return The offset of the first occurrence at or after offset, or SearchPattern::npos if
+ * there is none.
+ */
+size_t EditBuffer::find( const SearchPattern &pattern, const size_t offset ) const
+{
+    size_t match_length;
+    return( find( pattern, offset, match_length ) );
+}
+
+
+/*!
+ * Finds a pattern in the text and the length of the match. The text is searched where it is
+ * stored; the parts before and after the gap are handed to the pattern as separate pieces.
+ *
+ * \param pattern The pattern to look for.
+ * \param offset The offset where the search starts.
+ * \param match_length Set to the length of the match, if there is one.
+ * \return The offset of the first match at or after offset, or SearchPattern::npos if there
+ * is none.
+ */
+size_t EditBuffer::find(
+    const SearchPattern &pattern, const size_t offset, size_t &match_length ) const
+{
+    return( pattern.find(
+        workspace, gap, workspace + gap + gap_length( ), size - gap, offset, match_length ) );
+}
+
+
+/*!
+ * Finds the last match of a pattern that starts before a given offset. The text is searched
+ * backwards where it is stored.
+ *
+ * \param pattern The pattern to look for.
+ * \param end Only matches that start before this offset are found.
+ * \param match_length Set to the length of the match, if there is one.
+ * \return The offset of the match, or SearchPattern::npos if there is none.
+ */
+size_t EditBuffer::rfind(
+    const SearchPattern &pattern, const size_t end, size_t &match_length ) const
+{
+    return( pattern.rfind(
+        workspace, gap, workspace + gap + gap_length( ), size - gap, end, match_length ) );
+}
+
+
+//! Computes the hash an EditBuffer holding the given text would have.
+/*!
+ * The text is consumed eight bytes at a time. The hash depends on the machine's byte order so
+ * it must not be stored.
+ */
+std::uint64_t EditBuffer::hash( const char *text, size_t length )
+{
+    const std::uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+    std::uint64_t result = length * multiplier;
+    std::uint64_t word;
+
+    while( length >= sizeof( word ) ) {
+        std::memcpy( &word, text, sizeof( word ) );
+        result  = ( result ^ word ) * multiplier;
+        result ^= result >> 32;
+        text   += sizeof( word );
+        length -= sizeof( word );
+    }
+    word = 0;
+    std::memcpy( &word, text, length );
+    result  = ( result ^ word ) * multiplier;
+    result ^= result >> 29;
+    return( result );
+}
+
+
+//! Computes a hash of the text.
+/*!
+ * EditBuffers holding the same text have the same hash wherever their gaps happen to be. Text
+ * with a gap in the middle (a line being edited) is copied first, so hashing is fastest for
+ * lines that haven't been edited.
+ */
+std::uint64_t EditBuffer::hash( ) const
+{
+    if( gap == size ) return hash( workspace, size );
+    if( gap == 0 ) return hash( workspace + gap_length( ), size );
+    const std::string text( to_string( ) );
+    return hash( text.data( ), size );
+}
 
 
 //-----------------------------------
@@ -157,7 +523,8 @@ EditBuffer &EditBuffer::operator=( EditBuffer &&existing )
 //! Inserts a character into the EditBuffer.
 /*!
  * If an attempt is made to insert a character off the end of the buffer, the buffer is extended
- * with spaces. If an exception occurs during the insert operation there is no effect.
+ * with spaces. If an exception occurs during the insert operation there is no effect. Inserting
+ * near the previous edit is done in constant time (amortized).
  *
  * \param letter The character to insert.
  * \param offset The position in the buffer where the insertion is to take place. The character
@@ -168,51 +535,19 @@ void EditBuffer::insert( const char letter, const std::size_t offset )
 {
     // Are we inserting into the existing data?
     if( offset <= size ) {
-
-        // Is there sufficient capacity?
-        if( size + 1 < capacity ) {
-            memmove( &workspace[offset + 1], &workspace[offset], ( size + 1 ) - offset );
-            workspace[offset] = letter;
-            ++size;
-        }
-        // We need to create a new buffer.
-        else {
-            const size_t new_capacity = round_up( size + 1 );
-            char *const new_workspace = new char[new_capacity];
-            memcpy( new_workspace, workspace, offset );
-            new_workspace[offset] = letter;
-            memcpy( &new_workspace[offset + 1], &workspace[offset], ( size + 1 ) - offset );
-            delete [] workspace;
-            capacity = new_capacity;
-            workspace = new_workspace;
-            ++size;
-        }
+        reserve( size + 1 );
+        move_gap( offset );
+        workspace[gap++] = letter;
+        ++size;
     }
 
     // We are inserting off the end of the buffer.
     else {
-
-        // Is there sufficient capacity? (We need extra space for the null character).
-        if( offset + 2 < capacity ) {
-            memset( &workspace[size], ' ', offset - size );
-            workspace[offset] = letter;
-            workspace[offset+1] = '\0';
-            size = offset + 1;
-        }
-
-        // We need to create a new buffer.
-        else {
-            const size_t new_capacity = round_up( offset + 1 );
-            char *const new_workspace = new char[new_capacity];
-            memcpy( new_workspace, workspace, size );
-            memset( &new_workspace[size], ' ', offset - size );
-            new_workspace[offset] = letter;
-            new_workspace[offset+1] = '\0';
-            delete [] workspace;
-            capacity = new_capacity;
-            workspace = new_workspace;
-            size = offset + 1;
-        }
+        reserve( offset + 1 );
+        move_gap( size );
+        memset( &workspace[size], ' ', offset - size );
+        workspace[offset] = letter;
+        size = gap = offset + 1;
     }
 }
 
@@ -231,7 +566,9 @@ void EditBuffer::replace( const char letter, const std::size_t offset )
 {
     if( offset >= size ) insert( letter, offset );
     else {
-        workspace[offset] = letter;
+        reserve( size );
+        if( offset < gap ) workspace[offset] = letter;
+        else workspace[offset + gap_length( )] = letter;
     }
 }
 
@@ -240,7 +577,8 @@ void EditBuffer::replace( const char letter, const std::size_t offset )
 /*!
  * It is not an error to attempt to erase a character off the end of the data. In that case
  * there is no effect. This method collapses the data but does not reduce the capacity of the
- * buffer.
+ * buffer. Erasing the first or last character of borrowed text does not copy the text. Erasing
+ * near the previous edit is done in constant time.
  *
  * \param offset The location of the character to erase.
  * \return The character that was erased or the null character if there was no actual data
@@ -251,9 +589,23 @@ char EditBuffer::erase( const size_t offset )
     char return_value;
     if( offset >= size ) return_value = '\0';
     else {
-        return_value = workspace[offset];
-        memmove( &workspace[offset], &workspace[offset + 1], size - offset );
-        --size;
+        return_value = ( *this )[offset];
+
+        // Borrowed text can be narrowed at either end without copying it.
+        if( is_borrowed( ) && ( offset == 0 || offset + 1 == size ) ) {
+            if( offset == 0 ) ++workspace;
+            --capacity;
+            --size;
+            gap = size;
+        }
+
+        // Otherwise the character is absorbed into the gap.
+        else {
+            reserve( size );
+            if( offset + 1 == gap ) --gap;
+            else move_gap( offset );
+            --size;
+        }
     }
 
     return return_value;
@@ -262,20 +614,16 @@ char EditBuffer::erase( const size_t offset )
 
 //! Erases the entire buffer.
 /*!
- * Removes the data in the buffer and reinitializes the buffer. This method will thus reduce the
- * capacity of a large buffer. If an exception is thrown during the execution of this method,
- * there is no effect on the original buffer.
- *
- * \throws std::bad_alloc if there is insufficient memory to reinitialize.
+ * Removes the data in the buffer and reinitializes the buffer. This method will thus release
+ * the storage of a large buffer.
  */
 void EditBuffer::erase( )
 {
-    char *const new_workspace = new char[initial_capacity];
-    delete [] workspace;
-    workspace = new_workspace;
-    capacity  = initial_capacity;
+    release_storage( );
+    workspace = local;
+    capacity  = inline_capacity;
     size      = 0;
-    workspace[0] = '\0';
+    gap       = 0;
 }
 
 
@@ -289,17 +637,10 @@ void EditBuffer::erase( )
  */
 void EditBuffer::append( const char letter )
 {
-    if( size + 1 >= capacity ) {
-        const size_t new_capacity = round_up( size + 1 );
-        char *const new_workspace = new char[new_capacity];
-        memcpy( new_workspace, workspace, size );
-        delete [] workspace;
-        capacity = new_capacity;
-        workspace = new_workspace;
-    }
+    reserve( size + 1 );
+    move_gap( size );
     workspace[size] = letter;
-    workspace[size + 1] = '\0';
-    ++size;
+    gap = ++size;
 }
 
 
@@ -316,16 +657,11 @@ void EditBuffer::append( const char *const additional )
     if( additional == NULL ) return;
     const size_t additional_size = strlen( additional );
 
-    if( size + additional_size >= capacity ) {
-        const size_t new_capacity = round_up( size + additional_size );
-        char *const new_workspace = new char[new_capacity];
-        memcpy( new_workspace, workspace, size );
-        delete [] workspace;
-        capacity = new_capacity;
-        workspace = new_workspace;
-    }
-    memcpy( &workspace[size], additional, additional_size + 1 );
+    reserve( size + additional_size );
+    move_gap( size );
+    memcpy( &workspace[size], additional, additional_size );
     size += additional_size;
+    gap = size;
 }
 
 
@@ -339,16 +675,12 @@ void EditBuffer::append( const char *const additional )
  */
 void EditBuffer::append( const EditBuffer &other )
 {
-    if( size + other.size >= capacity ) {
-        const size_t new_capacity = round_up( size + other.size );
-        char *const new_workspace = new char[new_capacity];
-        memcpy( new_workspace, workspace, size );
-        delete [] workspace;
-        capacity = new_capacity;
-        workspace = new_workspace;
-    }
-    memcpy( &workspace[size], other.workspace, other.size + 1 );
-    size += other.size;
+    const size_t other_size = other.size;
+    reserve( size + other_size );
+    move_gap( size );
+    other.copy_text( &workspace[size], 0, other_size );
+    size += other_size;
+    gap = size;
 }
 
 
@@ -356,7 +688,8 @@ void EditBuffer::append( const EditBuffer &other )
 /*!
  * It is not an error for the start_offset and end_offset to be outside the data of this
  * EditBuffer. In that case an EditBuffer containing a suitable number of trailing spaces is
- * returned. If end_offset <= start_offset then an empty EditBuffer is returned.
+ * returned. If end_offset <= start_offset then an empty EditBuffer is returned. If the designated
+ * text is borrowed from a TextBlock the result borrows it as well.
  *
  * \param start_offset The offset of the first character to be part of the subbuffer.
  * \param end_offset The offset just past the last character that is part of the subbuffer.
@@ -366,28 +699,28 @@ void EditBuffer::append( const EditBuffer &other )
  */
 EditBuffer EditBuffer::subbuffer( const size_t start_offset, const size_t end_offset ) const
 {
+    // Borrowed text can be shared without copying it.
+    if( is_borrowed( ) && end_offset > start_offset && end_offset <= size ) {
+        return EditBuffer( block,
+                           static_cast< size_t >( workspace - block->data( ) ) + start_offset,
+                           end_offset - start_offset );
+    }
+
     EditBuffer result;
 
     // Only do work if there is work to do.
     if( end_offset > start_offset ) {
 
-        // Copy the designated text to a new workspace. Deal with adding trailing spaces.
+        // Copy the designated text to the result. Deal with adding trailing spaces.
         const size_t result_size = end_offset - start_offset;
-        const size_t result_capacity = round_up( result_size );
-        char *const result_workspace = new char[result_capacity];
+        result.allocate( result_size );
 
         const size_t letters =
             (start_offset < size) ? min(size - start_offset, result_size) : 0;
         const size_t spaces  = result_size - letters;
-        memcpy( result_workspace, workspace + start_offset, letters );
-        memset( result_workspace + letters, ' ', spaces );
-        result_workspace[result_size] = '\0';
-
-        // Replace the guts of the result object.
-        delete [] result.workspace;
-        result.workspace = result_workspace;
-        result.capacity  = result_capacity;
-        result.size      = result_size;
+        if( letters != 0 ) copy_text( result.workspace, start_offset, letters );
+        memset( result.workspace + letters, ' ', spaces );
+        result.size = result.gap = result_size;
     }
     return result;
 }
@@ -397,7 +730,8 @@ EditBuffer EditBuffer::subbuffer( const size_t start_offset, const size_t end_of
 /*!
  * It is not an error to trim an offset that is off the end of the data. In that case, there is
  * no effect. In particular, any excess capacity that might exist is not released (this could be
- * considered a bug).
+ * considered a bug). Trimming borrowed or inline text does not copy it. Otherwise the preserved
+ * text is copied to storage that fits it exactly.
  *
  * \param offset The offset where the release begins. Space at this offset and beyond is
  * returned to the memory pool.
@@ -407,15 +741,31 @@ EditBuffer EditBuffer::subbuffer( const size_t start_offset, const size_t end_of
 void EditBuffer::trim( const std::size_t offset )
 {
     if( offset >= size ) return;
+    if( is_borrowed( ) ) {
+        capacity = size = gap = offset;
+        return;
+    }
+    if( is_inline( ) ) {
+        move_gap( offset );
+        size = offset;
+        return;
+    }
 
-    const size_t new_capacity = round_up( offset );
-    char *const new_workspace = new char[new_capacity];
-    memcpy( new_workspace, workspace, offset );
-    delete [] workspace;
-    capacity = new_capacity;
-    workspace = new_workspace;
-    workspace[offset] = '\0';
-    size = offset;
+    char *const  old_workspace = workspace;
+    const size_t old_capacity  = capacity;
+    if( offset <= inline_capacity ) {
+        copy_text( local, 0, offset );
+        workspace = local;
+        capacity  = inline_capacity;
+    }
+    else {
+        char *const new_workspace = allocate_workspace( offset );
+        copy_text( new_workspace, 0, offset );
+        workspace = new_workspace;
+        capacity  = offset;
+    }
+    free_workspace( old_workspace, old_capacity );
+    size = gap = offset;
 }
 
 
@@ -427,8 +777,14 @@ void EditBuffer::trim( const std::size_t offset )
 bool operator==( const EditBuffer &left, const EditBuffer &right )
 {
     if( left.length( ) != right.length( ) ) return false;
-    for( size_t offset = 0; offset < left.length( ); ++offset ) {
-        if( left[offset] != right[offset] ) return false;
+
+    // Compare the text a chunk at a time. Copying it out skips over the gaps.
+    char left_text[128];
+    char right_text[128];
+    for( size_t offset = 0; offset < left.length( ); offset += sizeof( left_text ) ) {
+        const size_t count = left.copy( left_text, sizeof( left_text ), offset );
+        right.copy( right_text, count, offset );
+        if( std::memcmp( left_text, right_text, count ) != 0 ) return false;
     }
     return true;
 }
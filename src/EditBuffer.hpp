@@ -7,8 +7,14 @@
 #define EDITBUFFER_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
+#include "SlabPool.hpp"
+#include "TextBlock.hpp"
+
+class SearchPattern;
+
 //! String-like class offering basic editing features.
 /*!
  * EditBuffer objects allow the client to perform simple editing operations on strings of text
@@ -25,22 +31,60 @@
  * references or pointers to the internal state can be obtained via this interface. This design
  * is intentional to allow future flexibility; do not make changes that remove this flexibility
  * without appropriate consideration.
+ *
+ * An EditBuffer may borrow its text from a shared TextBlock (for example, the block holding a
+ * file as it was read from disk). Borrowed text is never modified. The first operation that
+ * needs to change the text copies it into storage owned by the EditBuffer. Copying an
+ * EditBuffer with borrowed text shares the block rather than copying the text.
+ *
+ * Short text is stored inside the EditBuffer object itself so most lines need no dynamically
+ * allocated storage at all. Longer text is stored in a dynamically allocated array that is
+ * initially sized to fit the text exactly and is only enlarged when the text is edited.
+ *
+ * Owned text is kept in a gap buffer. The unused capacity of the buffer forms a gap that is
+ * moved to the location of each insertion or erasure. Thus a series of edits near the same
+ * location costs constant time per edit no matter how long the text is.
+ *
+ * EditBuffer objects, and the storage for text that is only a little too long to fit inline,
+ * are allocated from SlabPools shared by all EditBuffers made by the same thread. This avoids a
+ * call to the system allocator for almost every line when large files are loaded or discarded.
+ * Different threads can make EditBuffers at the same time but an EditBuffer must only be used
+ * by one thread at a time, and it must not be destroyed by a thread other than the one that
+ * made it until that thread has finished.
  */
 class EditBuffer {
 public:
     // Constructors and destructor.
     EditBuffer( );
     EditBuffer( const char * );
+    EditBuffer( const char *, std::size_t );
+    EditBuffer( TextBlock *source, std::size_t offset, std::size_t length );
     EditBuffer( const EditBuffer & );
     EditBuffer &operator=( const EditBuffer & );
-    //EditBuffer( EditBuffer && );
-    //EditBuffer &operator=( EditBuffer && );
+    EditBuffer( EditBuffer && ) noexcept;
+    EditBuffer &operator=( EditBuffer && ) noexcept;
    ~EditBuffer( );
 
+    // EditBuffer objects are allocated from a pool.
+    static void *operator new( std::size_t );
+    static void  operator delete( void *object );
+
     // Access.
     char operator[]( std::size_t offset ) const;
     std::size_t length( ) const;
     std::string to_string( ) const;
+    std::size_t copy( char *destination, std::size_t count, std::size_t offset = 0 ) const;
+    std::size_t find( const SearchPattern &pattern, std::size_t offset = 0 ) const;
+    std::size_t find(
+        const SearchPattern &pattern, std::size_t offset, std::size_t &match_length ) const;
+    std::size_t rfind(
+        const SearchPattern &pattern, std::size_t end, std::size_t &match_length ) const;
+    std::uint64_t hash( ) const;
+    static std::uint64_t hash( const char *text, std::size_t length );
+
+    //! Returns true if the text is borrowed from a TextBlock.
+    bool is_borrowed( ) const
+        { return( workspace != local && block != NULL ); }
 
     // Manipulation.
     void insert( char letter, std::size_t offset );
@@ -54,29 +98,41 @@ public:
     void trim( std::size_t offset );
 
 private:
-    char       *workspace; //!< Pointer to buffer data.
-    std::size_t capacity;  //!< Size of the raw buffer.
-    std::size_t size;      //!< Number of bytes in buffer, not including null.
-
-    // Invariant: If workspace == NULL, capacity and size are zero; otherwise capacity > size.
-    // The buffer's contents are null terminated. The capacity must always contain space for
-    // the null byte.
-
-    // TODO: Remove the null termination requirement in the invariant.
-
-    // The requirement to keep the buffer contents null terminated is a throw back to when
-    // EditBuffer allowed clients to obtain a pointer to the contained text. This requirement
-    // meant that such a pointer could be safely passed to functions expecting a C style string.
-    // However the current design of EditBuffer no longer provides a way to get such a pointer.
-    // Thus the requirement to keep the text internally null terminated is now pointless.
+    //! Number of characters that can be stored in the EditBuffer object itself.
+    static const std::size_t inline_capacity = 32;
 
-    // TODO: Remove the workspace == NULL condition in the invariant.
-
-    // When Y was first written operator new returned NULL on failure. This lead to the
-    // possibility of an EditBuffer with a NULL workspace. However, modern C++ throws an
-    // exception if operator new fails. Thus I believe it is no longer possible for a fully
-    // constructed EditBuffer to have workspace == NULL. The invariant should be reworded
-    // accordingly and the implementation adjusted to take advantage of the modern rules.
+    char       *workspace; //!< Pointer to buffer data (inline, owned, or borrowed from block).
+    std::size_t capacity;  //!< Size of the raw buffer.
+    std::size_t size;      //!< Number of bytes of text in buffer.
+    std::size_t gap;       //!< Offset of the gap in the raw buffer.
+    union {
+        TextBlock *block;                   //!< Block holding borrowed text, or NULL.
+        char       local[inline_capacity];  //!< Storage for short text.
+    };
+
+    // Invariant: workspace is never NULL and capacity >= size. If workspace == local the text
+    // is stored inline, capacity == inline_capacity, and the block member is not in use.
+    // Otherwise, if block != NULL, workspace points at size bytes of text inside that block,
+    // capacity == size, gap == size, and this object holds one reference to the block.
+    // Otherwise workspace points at a dynamically allocated array of capacity bytes. Inline and
+    // dynamically allocated text occupies [0, gap) and [gap + capacity - size, capacity) of the
+    // raw buffer; the bytes between are the gap. The text is not null terminated.
+
+    std::size_t gap_length( ) const
+        { return( capacity - size ); }
+
+    bool is_inline( ) const
+        { return( workspace == local ); }
+
+    static char *allocate_workspace( std::size_t capacity );
+    static void  free_workspace( char *old_workspace, std::size_t capacity );
+
+    void release_storage( );
+    void allocate( std::size_t length );
+    void steal( EditBuffer &other );
+    void reserve( std::size_t required );
+    void move_gap( std::size_t offset );
+    void copy_text( char *destination, std::size_t offset, std::size_t count ) const;
 };
 
 // ==============
@@ -84,23 +140,36 @@ private:
 // ==============
 
 
+/*!
+ * Releases the storage used by the text. The object is left in an inconsistent state.
+ */
+inline
+void EditBuffer::release_storage( )
+{
+    if( is_inline( ) ) return;
+    if( block != NULL ) block->release( );
+    else free_workspace( workspace, capacity );
+}
+
+
 inline
 EditBuffer::~EditBuffer( )
 {
-    delete [] workspace;
+    release_storage( );
     return;
 }
 
 
 /*!
- * If an out of bounds offset is used, the effect is undefined.
- *
  * \param offset The index of the desired character.
+ * \return The character at the given offset or the null character if the offset is beyond the
+ * end of the text.
  */
 inline
 char EditBuffer::operator[]( const std::size_t offset ) const
 {
-    return( workspace[offset] );
+    if( offset >= size ) return( '\0' );
+    return( offset < gap ? workspace[offset] : workspace[offset + gap_length( )] );
 }
 
 
@@ -125,7 +194,9 @@ std::size_t EditBuffer::length( ) const
 inline
 std::string EditBuffer::to_string( ) const
 {
-    return( std::string( workspace ) );
+    std::string result( workspace, gap );
+    result.append( workspace + gap + gap_length( ), size - gap );
+    return( result );
 }
 
 
@@ -20,6 +20,7 @@ EditFile::EditFile( )
     block          = false;
     anchor         = 0L;
     is_changed     = false;
+    journal        = NULL;
     constructed_ok = true;
 }
 
@@ -35,10 +36,47 @@ EditFile::~EditFile( )
 void EditFile::erase( )
 {
     if( file_data.size( ) > 0L ) is_changed = true;
+    journal_delete( 0, file_data.size( ) );
     file_data.clear( );
 }
 
 
+//! Notes that lines were inserted into file_data.
+/*!
+ * This must be called after the lines are inserted. The position of file_data is unchanged.
+ *
+ * \param index The index of the first line inserted.
+ * \param count The number of lines inserted.
+ */
+void EditFile::journal_insert( long index, long count )
+{
+    if( journal == NULL  ||  count <= 0 ) return;
+
+    const long here = file_data.current_index( );
+    file_data.jump_to( index );
+    journal->inserted( index, count, file_data );
+    file_data.jump_to( here );
+}
+
+
+//! Notes that lines are about to be deleted from file_data.
+/*!
+ * This must be called before the lines are deleted. Lines that don't exist are ignored.
+ *
+ * \param index The index of the first line to be deleted.
+ * \param count The number of lines to be deleted.
+ */
+void EditFile::journal_delete( long index, long count )
+{
+    if( journal == NULL ) return;
+
+    const long size = file_data.size( );
+    if( index >= size ) return;
+    if( count > size - index ) count = size - index;
+    if( count > 0 ) journal->deleted( index, count );
+}
+
+
 //! Extends, if necessary, the file's data to include a particular line.
 /*!
  * This function ensures that the EditFile contains at least line line_number. If the desired
@@ -61,20 +99,24 @@ bool EditFile::extend_to_line( long line_number )
 {
     bool return_value = true;
 
-    // If the file is already big enough, just return.
+    // If the file is already big enough, just return. A view can't be extended; its lines past
+    // the end are simply missing.
+    if( file_data.has_view( ) ) return true;
     if( file_data.size( ) > line_number ) return true;
 
     // Position the list to the end.
     file_data.set_end( );
 
     // Compute number of new lines required.
-    long line_count = line_number - file_data.size( ) + 1;
+    const long old_size = file_data.size( );
+    long line_count = line_number - old_size + 1;
 
     // Insert the new lines.
     while( return_value == true  &&  line_count-- ) {
         EditBuffer *blank = new EditBuffer( "" );
         file_data.insert( blank );
     }
+    journal_insert( old_size, line_number - old_size + 1 );
 
     return return_value;
 }
@@ -8,6 +8,7 @@
 
 #include "EditList.hpp"
 #include "FilePosition.hpp"
+#include "Journal.hpp"
 
 /*===================================================*/
 /*           Definition of class EditFile           */
@@ -44,11 +45,21 @@ protected:
     bool         block;          //!< True when block mode is ON.
     long         anchor;         //!< Line number of one side of the block.
     bool         is_changed;     //!< True if data "changed."
+    Journal     *journal;        //!< Records changes for crash recovery, or NULL.
 
     void erase( );
     bool extend_to_line( long );
     bool built_ok( );
 
+    // Every change to file_data must be noted in the journal (see DiskEditFile::start_journal).
+
+    //! Notes that the text of a line changed.
+    void journal_change( long index, const EditBuffer *line )
+        { if( journal != NULL ) journal->changed( index, line ); }
+
+    void journal_insert( long index, long count );
+    void journal_delete( long index, long count );
+
 public:
     // NOTE **** The following functions should really be virtual ****
 
@@ -56,6 +67,14 @@ public:
     void set_block_state( bool );
     bool get_block_state( );
     bool top_of_block( );
+
+    //! Returns the number of lines in the file.
+    long line_count( )
+        { return( file_data.size( ) ); }
+
+    //! Returns the counters of the pool holding this file's list nodes.
+    const SlabPool::Statistics &node_statistics( )
+        { return( file_data.node_statistics( ) ); }
   };
 
 #endif
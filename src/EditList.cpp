@@ -5,6 +5,7 @@
 
 #include "EditBuffer.hpp"
 #include "EditList.hpp"
+#include "TextBlock.hpp"
 
 //! Removes all the EditBuffers in the list.
 /*!
@@ -15,9 +16,205 @@ void EditList::clear( )
 {
     EditBuffer *p;
 
+    // The lines in the source are never taken.
+    delete source;
+    source = NULL;
+
+    // A view's lines are only those kept.
+    if( view != NULL ) {
+        for( ViewLine &slot : view_lines ) delete slot.line;
+        std::vector< ViewLine >( ).swap( view_lines );
+        delete view;
+        view       = NULL;
+        view_index = 0;
+    }
+
     jump_to( 0 );
     while ( (p = next( ) ) != NULL ) {
         delete p;
     }
     List< EditBuffer * >::clear( );
 }
+
+
+//! Adds all the remaining lines to a list.
+/*!
+ * The default implementation calls next_line( ) until it runs out of lines. Sources that can
+ * produce many lines at once more efficiently should override this.
+ *
+ * \param lines The list to receive the lines. They are added before its current point.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void LineSource::take_all( EditList &lines )
+{
+    EditBuffer *line;
+    while( ( line = next_line( ) ) != NULL ) lines.insert( line );
+}
+
+
+//! Gives the list a source for the lines that follow the lines it holds.
+/*!
+ * The list takes ownership of the source and deletes it when all its lines have been taken or
+ * when the list is cleared. If the list already has a source, all of its lines are taken
+ * first.
+ *
+ * \param new_source The new source. It must be dynamically allocated.
+ */
+void EditList::set_source( LineSource *const new_source )
+{
+    complete( );
+    source = new_source;
+}
+
+
+//! Makes the list show a view.
+/*!
+ * The list must be empty. The list takes ownership of the view and deletes it when the list is
+ * cleared. The current point is moved to the first line.
+ *
+ * \param new_view The view to show. It must be dynamically allocated.
+ * \throws std::bad_alloc if there is insufficient memory. The view is deleted in that case.
+ */
+void EditList::set_view( LineView *const new_view )
+{
+    try {
+        view_lines.assign( view_cache_size, ViewLine{ -1, NULL } );
+    }
+    catch( ... ) {
+        delete new_view;
+        throw;
+    }
+    view       = new_view;
+    view_index = 0;
+}
+
+
+//! Returns a line of the view, making it if it isn't one of those kept.
+/*!
+ * \return The line or NULL if the view has no line with the given index.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+EditBuffer *EditList::view_line( const long index )
+{
+    if( !view->has_line( index ) ) return NULL;
+
+    ViewLine &slot = view_lines[index % view_cache_size];
+    if( slot.index != index ) {
+        delete slot.line;
+        slot.index = -1;
+        slot.line  = view->make_line( index );
+        slot.index = index;
+    }
+    return( slot.line );
+}
+
+
+//! Takes some of the remaining lines from the list's source.
+/*!
+ * This can be used to take the lines from the source gradually, for example while the user
+ * isn't doing anything, so that they don't have to be taken all at once later. Only the lines
+ * the source has ready are taken. The current point is not changed.
+ *
+ * \param count The maximum number of lines to take.
+ * \return true if lines remain in the source.
+ */
+bool EditList::fill_more( const long count )
+{
+    if( source != NULL ) {
+        const long end = List< EditBuffer * >::size( );
+        fill( ( count > LONG_MAX - end ) ? -1 : end + count, false );
+    }
+    return( source != NULL );
+}
+
+
+//! Takes lines from the source until the list holds a certain number of them.
+/*!
+ * The lines are added to the end of the list. The current point is not changed; if it was
+ * just past the end of the list it ends up at the first new line. The source is deleted when
+ * it runs out of lines.
+ *
+ * \param count The number of lines the list should hold, or a negative number to take all of
+ * the lines in the source.
+ * \param wait If false, stop early rather than wait for the source to get lines ready.
+ */
+void EditList::fill( const long count, const bool wait )
+{
+    const long original_index = current_index( );
+    bool       exhausted      = false;
+
+    List< EditBuffer * >::jump_to( List< EditBuffer * >::size( ) );
+    if( count < 0  &&  wait ) {
+        source->take_all( *this );
+        exhausted = true;
+    }
+    while( !exhausted  &&  ( count < 0  ||  List< EditBuffer * >::size( ) < count )  &&
+           ( wait  ||  source->ready( ) ) ) {
+        EditBuffer *const line = source->next_line( );
+        if( line == NULL ) exhausted = true;
+        else List< EditBuffer * >::insert( line );
+    }
+    if( exhausted ) {
+        delete source;
+        source = NULL;
+    }
+    List< EditBuffer * >::jump_to( original_index );
+}
+
+
+//! Moves all the EditBuffers in another list into this list.
+/*!
+ * The EditBuffers are inserted before the list's current point in the same order as they
+ * appear in the other list. No EditBuffers are copied; this list takes ownership of them and
+ * the other list is left empty. The time required does not depend on the number of
+ * EditBuffers moved.
+ *
+ * \param other The list giving up its EditBuffers.
+ */
+void EditList::take( EditList &other )
+{
+    if( &other == this ) return;
+
+    other.jump_to( 0 );
+    splice( other, other.size( ) );
+}
+
+
+//! Gathers the text of the EditBuffers in the list into a single shared TextBlock.
+/*!
+ * The text of each EditBuffer that owns its text is moved into one newly allocated TextBlock
+ * and the EditBuffer is changed to borrow its text from there. EditBuffers that already borrow
+ * their text are left alone. Afterwards copying the EditBuffers in the list (for example when
+ * the clipboard is pasted) copies no text. The current point is not changed.
+ *
+ * If there is insufficient memory the list is left as it was; this operation is only an
+ * optimization.
+ */
+void EditList::share_text( )
+{
+    Mark        original_point( *this );
+    EditBuffer *p;
+
+    // Find out how much text must be moved.
+    std::size_t total = 0;
+    jump_to( 0 );
+    while( ( p = next( ) ) != NULL ) {
+        if( !p->is_borrowed( ) ) total += p->length( );
+    }
+    if( total == 0 ) return;
+
+    TextBlock *const block = TextBlock::make( total );
+    if( block == NULL ) return;
+
+    // Move the text.
+    std::size_t offset = 0;
+    jump_to( 0 );
+    while( ( p = next( ) ) != NULL ) {
+        const std::size_t length = p->length( );
+        if( p->is_borrowed( ) || length == 0 ) continue;
+        p->copy( block->data( ) + offset, length );
+        *p = EditBuffer( block, offset, length );
+        offset += length;
+    }
+    block->release( );
+}
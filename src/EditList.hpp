@@ -6,9 +6,44 @@
 #ifndef EDITLIST_HPP
 #define EDITLIST_HPP
 
+#include <climits>
+#include <vector>
 #include "mylist.hpp"
 
 class EditBuffer;
+class EditList;
+
+//! Supplies lines that an EditList adds to its end as they are needed.
+class LineSource {
+public:
+    virtual ~LineSource( ) { }
+
+    //! Returns the next line in a new EditBuffer or NULL if there are no more lines.
+    virtual EditBuffer *next_line( ) = 0;
+
+    //! Returns true if next_line( ) can return without waiting for something.
+    virtual bool ready( ) { return true; }
+
+    virtual void take_all( EditList &lines );
+};
+
+//! Supplies the lines of a list that is too large to hold in memory. See EditList::set_view.
+class LineView {
+public:
+    virtual ~LineView( ) { }
+
+    //! Returns true if there is a line with the given index, waiting to find out if necessary.
+    virtual bool has_line( long index ) = 0;
+
+    //! Returns the number of lines, waiting to find out if necessary.
+    virtual long size( ) = 0;
+
+    //! Returns a line in a new EditBuffer. The line must exist.
+    /*!
+     * \throws std::bad_alloc if there is insufficient memory.
+     */
+    virtual EditBuffer *make_line( long index ) = 0;
+};
 
 //! List of pointers to EditBuffer objects.
 /*!
@@ -21,10 +56,29 @@ class EditBuffer;
  *  EditList do not allow this, trading in generality for an easier interface. In effect,
  *  EditList removes a level of indirection allowing its clients to deal with pointers to
  *  EditBuffers rather than pointers to pointers to EditBuffers.
+ *
+ *  An EditList can be given a LineSource that supplies the lines following the ones already in
+ *  the list. Lines are taken from the source only when something refers to them, for example
+ *  when the current point reaches them. Operations that depend on the whole list, such as
+ *  size( ), take all the remaining lines first. Thus the source is invisible to clients except
+ *  for the time it takes to produce lines. Lines are only ever taken from the source into the
+ *  end of the list so inserting and erasing lines elsewhere doesn't disturb it.
+ *
+ *  Alternatively an EditList can show a LineView. Such a list is read-only and holds only the
+ *  lines near those recently used; the others are made again by the view when they are needed.
+ *  A pointer to a line remains valid while only lines within view_cache_size of it are used.
+ *  Attempts to change the list are ignored.
  */
 class EditList : private List<EditBuffer *> {
 public:
 
+    //! Constructs an empty list without a source.
+    EditList( ) : source( NULL ), view( NULL ), view_index( 0 ) { }
+
+    // A list's source can't be shared.
+    EditList( const EditList & ) = delete;
+    EditList &operator=( const EditList & ) = delete;
+
     //lint -e{1509} The base class is private so virtualness of its destructor is not important.
     //! Destructor
     /*!
@@ -34,12 +88,34 @@ public:
    virtual ~EditList( )
         { clear( ); }
 
+    //! Returns true if lines remain to be taken from the list's source.
+    bool has_source( ) const
+        { return( source != NULL ); }
+
+    //! Returns true if the list shows a view.
+    bool has_view( ) const
+        { return( view != NULL ); }
+
+    void set_source( LineSource *new_source );
+    void set_view( LineView *new_view );
+    bool fill_more( long count );
+
+    //! Takes all the remaining lines from the list's source.
+    void complete( )
+        { if( source != NULL ) fill( -1 ); }
+
     //! Returns the next EditBuffer* in the list.
     /*!
      * \return NULL if there are no other elements.
      */
     EditBuffer *next( )
     {
+        if( view != NULL ) {
+            EditBuffer *const line = view_line( view_index );
+            if( line != NULL ) ++view_index;
+            return( line );
+        }
+        if( source != NULL ) fill_current( );
         EditBuffer * const * const result = List<EditBuffer *>::next( );
         return( result == NULL ? NULL : *result );
     }
@@ -50,6 +126,7 @@ public:
      */
     EditBuffer *previous( )
     {
+        if( view != NULL ) return( view_index == 0 ? NULL : view_line( --view_index ) );
         EditBuffer * const * const result = List<EditBuffer *>::previous( );
         return( result == NULL ? NULL : *result );
     }
@@ -58,11 +135,13 @@ public:
     /*!
      * \param item A pointer to a dynamically allocated EditBuffer to be added to the list
      * before the list's current point.
-     * \return The same pointer it is given.
+     * \return The same pointer it is given, or NULL if the list shows a view. In that case the
+     * list doesn't take the EditBuffer.
      * \throws std::bad_alloc if insufficient memory.
      */
     EditBuffer *insert( EditBuffer *const item )
     {
+        if( view != NULL ) return NULL;
         EditBuffer *const *const result = List<EditBuffer *>::insert( item );
         return( *result );
     }
@@ -70,21 +149,120 @@ public:
     //! Returns the EditBuffer* at the list's current point.
     EditBuffer *get( )
     {
+        if( view != NULL ) return view_line( view_index );
+        if( source != NULL ) fill_current( );
         EditBuffer *const *const result = List<EditBuffer *>::get( );
         return( result == NULL ? NULL : *result );
     }
 
+    //! Removes the EditBuffer* at the list's current point without deleting it.
+    /*!
+     * Ownership of the EditBuffer passes to the caller. The current point is advanced to the
+     * next item on the list.
+     *
+     * \return NULL if the current point is off the end of the list or the list shows a view.
+     */
+    EditBuffer *release( )
+    {
+        if( view != NULL ) return NULL;
+        EditBuffer *const result = get( );
+        if( result != NULL ) List<EditBuffer *>::erase( );
+        return( result );
+    }
+
+    //! Removes the element at the list's current point without deleting the EditBuffer.
+    void erase( )
+    {
+        if( view != NULL ) return;
+        if( source != NULL ) fill_current( );
+        List<EditBuffer *>::erase( );
+    }
+
+    //! Moves the list's current point to the given index. See List::jump_to for details.
+    void jump_to( const long new_index )
+    {
+        if( view != NULL ) {
+            const bool shown = new_index >= 0  &&  view->has_line( new_index );
+            view_index = shown ? new_index : view->size( );
+            return;
+        }
+        if( source != NULL ) {
+            fill( ( new_index < 0  ||  new_index == LONG_MAX ) ? -1 : new_index + 1 );
+        }
+        List<EditBuffer *>::jump_to( new_index );
+    }
+
+    //! Returns the number of EditBuffers in the list, taking any that remain in the source.
+    long size( )
+    {
+        if( view != NULL ) return view->size( );
+        complete( );
+        return( List<EditBuffer *>::size( ) );
+    }
+
     void clear( );
+    void take( EditList &other );
+
+    //! Moves EditBuffers from another list into this list.
+    /*!
+     * The count EditBuffers starting at the other list's current point are moved before this
+     * list's current point without copying them. See List::splice for details.
+     *
+     * \param other The list giving up its EditBuffers. Must not be this list and must not show
+     * a view. Nothing is moved if this list shows a view.
+     * \param count The number of EditBuffers to move.
+     */
+    void splice( EditList &other, const long count )
+    {
+        if( view != NULL ) return;
+        if( other.source != NULL ) {
+            const long start = other.current_index( );
+            other.fill( ( count > LONG_MAX - start ) ? -1 : start + count );
+        }
+        List< EditBuffer * >::splice( other, count );
+    }
+
+    void share_text( );
 
     //! Moves the list's current point to just past the end.
     void set_end( )
-        { List<EditBuffer *>::jump_to( size( ) ); }
+        { jump_to( size( ) ); }
+
+    //! Returns the index of the current point.
+    long current_index( ) const
+        { return( view != NULL ? view_index : List<EditBuffer *>::current_index( ) ); }
 
     // Make these names from the private base class public.
-    using List<EditBuffer *>::current_index;
-    using List<EditBuffer *>::erase;
-    using List<EditBuffer *>::size;
-    using List<EditBuffer *>::jump_to;
+    using List<EditBuffer *>::node_statistics;
+
+    //! Number of lines made by a view that are kept.
+    static const long view_cache_size = 1024L;
+
+private:
+    //! A line made by a view.
+    struct ViewLine {
+        long        index;  //!< The index of the line (-1 if the slot is unused).
+        EditBuffer *line;   //!< The line or NULL.
+    };
+
+    LineSource *source;  //!< Supplies the lines after those in the list (NULL if none).
+    LineView   *view;    //!< Supplies all the lines of a read-only list (NULL if none).
+    long        view_index;  //!< The list's current point when it shows a view.
+    std::vector< ViewLine > view_lines;  //!< Lines recently made by the view.
+
+    EditBuffer *view_line( long index );
+
+    //! Number of lines taken from the source when the current point reaches the end.
+    static const long fill_increment = 1024L;
+
+    void fill( long count, bool wait = true );
+
+    //! Takes lines from the source if the current point is just past the end of the list.
+    void fill_current( )
+    {
+        const long end = List<EditBuffer *>::size( );
+        if( current_index( ) == end ) fill( end + fill_increment );
+    }
 };
 
 #endif
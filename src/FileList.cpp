@@ -3,14 +3,25 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include "EditBuffer.hpp"
 #include "FileList.hpp"
 #include "FileNameMatcher.hpp"
+#include "FileSearch.hpp"
+#include "FileWatcher.hpp"
+#include "MessageWindow.hpp"
 #include "mylist.hpp"
+#include "scr.hpp"
 #include "special.hpp"
 #include "support.hpp"
 #include "YEditFile.hpp"
@@ -57,6 +68,30 @@ static YFileList    the_list;   //!< This is the file list itself.
 // "scratch.yfy" exists, it will be loaded! However unless the user explicitly saves
 // scratch.yfy, it will never be saved.
 
+//! A file being saved by a background thread.
+struct PendingSave {
+    YEditFile          *file;      //!< The file being saved.
+    SaveSnapshot       *snapshot;  //!< The text being saved.
+    std::thread         worker;    //!< The thread doing the save.
+    std::atomic< bool > done;      //!< Set by the worker when it is finished.
+    bool                result;    //!< True if the save worked. Valid once done is set.
+    bool                touched;   //!< True if the file changed on disk during the save.
+};
+
+static std::vector< PendingSave * > pending_saves;  //!< Saves not yet reported, oldest first.
+
+//! The name of the file showing the results of search_all( ).
+static const char *const results_name = "SEARCH$.TMP";
+
+//! The name of the file showing the results of search_tree( ).
+static const char *const tree_results_name = "GREP$.TMP";
+
+static std::unique_ptr< TreeSearch > tree_search;   //!< The search running, or NULL.
+static RESULTS_YEditFile *tree_results = NULL;      //!< Where its results are shown.
+
+static FileWatcher watcher;                                //!< Notices changes made by others.
+static std::map< YEditFile *, std::string > watched_names; //!< Full names of the files watched.
+
 enum FileType { ADA, ASM, C, DOC, PCD, SCALA, OTHER };
 
 struct InitialAttributes {
@@ -101,6 +136,198 @@ static InitialAttributes default_attributes[] = {
     { ""    , OTHER }
 };
 
+/*=======================================*/
+/*           Background Saving           */
+/*=======================================*/
+
+//! Saves a snapshot. This is the body of the background threads.
+static void run_save( PendingSave *save )
+{
+    save->result = save->snapshot->save( );
+    save->done.store( true, std::memory_order_release );
+}
+
+
+//! Waits for a background save to finish and updates the file that was saved.
+/*!
+ * The file's changed flag was reset when the save started. Any edits made since then set it
+ * again. If the save worked, the file's time stamp becomes that of the text written (see
+ * DiskEditFile::remember_save). Otherwise an error is displayed
+ * and the file is marked as changed since its text is not on the disk.
+ *
+ * \param save The save to finish. It is deleted.
+ * \return true if the save worked.
+ */
+static bool complete_save( PendingSave *save )
+{
+    if( save->worker.joinable( ) ) save->worker.join( );
+
+    const bool result = save->result;
+    if( result ) {
+        save->file->remember_save( *save->snapshot );
+    }
+    else {
+        const int error_code = save->snapshot->error( );
+        save->file->mark_as_changed( );
+        error_message( "Can't save %s: %s",
+                       save->snapshot->name( ),
+                       ( error_code != 0 ) ? std::strerror( error_code ) : "write failed" );
+    }
+
+    // Snapshots hold EditBuffers so they must be destroyed on this thread.
+    delete save->snapshot;
+    delete save;
+    return result;
+}
+
+
+//! Waits for the background saves of a file to finish.
+/*!
+ * \param file The file of interest or NULL to wait for the saves of all files.
+ * \return false if any of the saves failed.
+ */
+static bool wait_for_saves( const YEditFile *file )
+{
+    bool result = true;
+
+    std::vector< PendingSave * >::iterator p = pending_saves.begin( );
+    while( p != pending_saves.end( ) ) {
+        if( file == NULL  ||  ( *p )->file == file ) {
+            if( !complete_save( *p ) ) result = false;
+            p = pending_saves.erase( p );
+        }
+        else ++p;
+    }
+    return result;
+}
+
+//! Returns the background save of a file, or NULL if the file is not being saved.
+static PendingSave *save_of( const YEditFile *file )
+{
+    for( PendingSave *save : pending_saves ) {
+        if( save->file == file ) return save;
+    }
+    return NULL;
+}
+
+
+//! Merges the changes made to a file on disk with the changes made here, if possible.
+/*!
+ * \param file The file to merge. It must be changed.
+ * \return true if the changes were merged. The user is told about any conflicts.
+ */
+static bool merge_file( YEditFile *file )
+{
+    long conflicts;
+    if( !file->merge( file->name( ), conflicts ) ) return false;
+
+    if( conflicts == 0 ) info_message( "Merged the changes made to %s on disk", file->name( ) );
+    else {
+        warning_message( "Merged the changes made to %s on disk. %ld conflict%s marked",
+                         file->name( ), conflicts, ( conflicts == 1 ) ? " is" : "s are" );
+    }
+    return true;
+}
+
+
+//! Starts journaling a file that was just loaded.
+/*!
+ * If the file has a journal left by an earlier session, the user is asked whether to recover
+ * its changes first. A journal being written by another Y is left alone and the file isn't
+ * journaled.
+ */
+static void start_journal( YEditFile *file )
+{
+    switch( file->find_journal( file->name( ) ) ) {
+    case DiskEditFile::JOURNAL_IN_USE:
+        warning_message( "%s is being edited by another Y. Changes won't be journaled",
+                         file->name( ) );
+        return;
+
+    case DiskEditFile::OLD_JOURNAL: {
+        std::string prompt( file->name( ) );
+        prompt.append( " has unsaved changes from an earlier session. Recover them? [y]/n " );
+        if( confirm_message( prompt.c_str( ), 'n', false ) ) file->recover( file->name( ) );
+        break;
+    }
+
+    case DiskEditFile::NO_JOURNAL:
+        break;
+    }
+    file->start_journal( file->name( ) );
+}
+
+
+//! Brings a file up to date after it was changed by another program.
+/*!
+ * Followed files have the new text read. Other files are reloaded if the disk version is not
+ * the one last read or written. If the file was also changed here, the changes on disk are
+ * merged with the changes here (see DiskEditFile::merge). If that isn't possible the user is
+ * asked whether to reload the file.
+ *
+ * \param file The file that might have changed.
+ * \return true if the file's text changed.
+ */
+static bool update_file( YEditFile *file )
+{
+    if( file->is_following( ) ) {
+        if( !file->follow( file->name( ) ) ) return false;
+        if( file->is_pinned( ) ) file->bottom_of_file( );
+        return true;
+    }
+
+    FileNameMatcher stamper;
+    stamper.set_name( file->name( ) );
+    if( stamper.next( ) == NULL  ||  stamper.modify_time( ) == file->time( ) ) return false;
+
+    if( file->changed( ) ) {
+        if( merge_file( file ) ) return true;
+
+        std::string prompt( file->name( ) );
+        prompt.append( " changed on disk. Reload it? y/[n] " );
+        if( confirm_message( prompt.c_str( ), 'y', true ) ) {
+            // Keep the changes. Don't ask again until the file changes again.
+            file->set_timestamp( file->name( ) );
+            return false;
+        }
+    }
+    file->reload( file->name( ) );
+    return true;
+}
+
+
+//! Shows lines in a results file and makes it the active file.
+/*!
+ * An earlier results file with the same name is reused. Otherwise a new one is put in the list
+ * after the active file.
+ *
+ * \param name The name of the results file.
+ * \param results The lines to show.
+ * \return The results file, or NULL if it could not be made.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+static RESULTS_YEditFile *show_results(
+    const char *name, const std::vector< std::string > &results )
+{
+    RESULTS_YEditFile *results_file = NULL;
+    if( FileList::lookup( name ) ) {
+        results_file = dynamic_cast< RESULTS_YEditFile * >( *the_list.get( ) );
+    }
+
+    if( results_file == NULL ) {
+        results_file = new RESULTS_YEditFile( name );
+        the_list.next( );
+        if( the_list.insert( results_file ) == NULL ) {
+            delete results_file;
+            the_list.previous( );
+            return NULL;
+        }
+        the_list.previous( );
+    }
+    results_file->set_results( results );
+    return results_file;
+}
+
 /*======================================*/
 /*           Public Functions           */
 /*======================================*/
@@ -161,11 +388,18 @@ namespace FileList {
                 // It did work. Make the new file the currently active one.
                 return_value = true;
                 the_list.previous( );
+                watched_names[new_thing] = watcher.watch( name );
 
                 // See if this file has been in the editor before and if so set up its
                 // attributes to agree with the descriptor.
                 //
                 active_file( ).set_attributes( );
+
+                // Files too large to load are shown read-only. Tell the user why.
+                if( active_file( ).read_only( ) ) {
+                    info_message( "%s is too large to edit. It is read only", name );
+                }
+                start_journal( new_thing );
             }
         }
         return return_value;
@@ -291,6 +525,7 @@ namespace FileList {
 
             // Get a pointer to the currently active file. That's the one we are killing.
             YEditFile **file = the_list.get( );
+            wait_for_saves( *file );
 
             // Save the state information for this file in case it gets reloaded.
             FileDescriptor *new_descriptor = new FileDescriptor( ( *file )->name( ) );
@@ -300,7 +535,19 @@ namespace FileList {
             descriptor_list.insert( *new_descriptor );
             delete new_descriptor;
 
+            // A search showing its results in this file is stopped.
+            if( *file == tree_results ) {
+                tree_search.reset( );
+                tree_results = NULL;
+            }
+
             // Trash the file object and the list node.
+            const std::map< YEditFile *, std::string >::iterator watched =
+                watched_names.find( *file );
+            if( watched != watched_names.end( ) ) {
+                watcher.forget( watched->second );
+                watched_names.erase( watched );
+            }
             delete *file;
             the_list.erase( );
 
@@ -318,24 +565,223 @@ namespace FileList {
 
     bool save_changes( )
     {
-        bool return_value = true;
         YEditFile **file;
         YFileList::Iterator stepper( the_list );
 
-        // Look for files which have changed and save those files.
+        // Start saving every file which has changed. The files are written concurrently.
         while( ( file = stepper( ) ) != NULL ) {
+            if( ( *file )->changed( ) ) save_in_background( **file );
+        }
 
-            if( ( *file )->changed( ) ) {
-                // Try saving the file. Update records if save worked.
-                bool save_worked = ( *file )->save( ( *file )->name( ) );
-                if( !save_worked ) return_value = false;
-                else {
-                    ( *file )->set_timestamp( ( *file )->name( ) );
-                    ( *file )->mark_as_unchanged( );
-                }
+        return finish_saves( );
+    }
+
+
+    /*!
+     * A snapshot of the file is taken and then written by a background thread while editing
+     * continues. The file is replaced atomically if possible (see DiskEditFile::save). The
+     * results are reported when check_saves( ) or finish_saves( ) notices that the save has
+     * finished. If the file is already being saved, that save is finished first so the older
+     * text can't be written last.
+     *
+     * \throws std::bad_alloc if there is insufficient memory. The file is still marked as
+     * changed in that case.
+     */
+    void save_in_background( YEditFile &file )
+    {
+        wait_for_saves( &file );
+
+        // Everything that can fail is done before the file is marked as unchanged and the
+        // thread is started. Destroying a thread that is still running would end the program.
+        std::unique_ptr< SaveSnapshot > snapshot( file.snapshot( file.name( ) ) );
+        std::unique_ptr< PendingSave > save( new PendingSave );
+        pending_saves.reserve( pending_saves.size( ) + 1 );
+
+        save->file     = &file;
+        save->snapshot = snapshot.release( );
+        save->done     = false;
+        save->result   = false;
+        save->touched  = false;
+        file.mark_as_unchanged( );
+
+        try {
+            save->worker = std::thread( run_save, save.get( ) );
+        }
+        catch( std::system_error & ) {
+            // No thread is available. Do the save now instead.
+            run_save( save.get( ) );
+        }
+        pending_saves.push_back( save.release( ) );
+    }
+
+
+    bool saves_pending( )
+    {
+        return !pending_saves.empty( );
+    }
+
+
+    bool check_saves( )
+    {
+        std::vector< PendingSave * >::iterator p = pending_saves.begin( );
+        int         saved = 0;
+        int         failed = 0;
+        std::string last_name;
+
+        while( p != pending_saves.end( ) ) {
+            if( !( *p )->done.load( std::memory_order_acquire ) ) ++p;
+            else {
+                YEditFile *const file = ( *p )->file;
+                const bool touched = ( *p )->touched;
+                last_name = ( *p )->snapshot->name( );
+                if( complete_save( *p ) ) ++saved; else ++failed;
+                p = pending_saves.erase( p );
+
+                // Another program may have changed the file during the save or just after it.
+                if( touched ) update_file( file );
             }
         }
 
+        if( saved == 1 && failed == 0 ) info_message( "Saved %s", last_name.c_str( ) );
+        else if( saved > 0 ) info_message( "Saved %d files", saved );
+        return( saved + failed > 0 );
+    }
+
+
+    bool finish_saves( )
+    {
+        if( pending_saves.empty( ) ) return true;
+
+        // Let the user know why the editor is waiting.
+        scr::MessageWindow teaser( "Saving...", scr::MESSAGE_WINDOW_MESSAGE );
+        scr::refresh( );
+        for( PendingSave *save : pending_saves ) {
+            if( save->worker.joinable( ) ) save->worker.join( );
+        }
+        teaser.close( );
+
+        return wait_for_saves( NULL );
+    }
+
+
+    bool loads_pending( )
+    {
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL )
+            if( ( *file )->loading( ) ) return true;
+
+        return false;
+    }
+
+
+    /*!
+     * Only lines that are ready are made so this function doesn't wait for any files to be
+     * read. It makes a limited number of lines so it returns quickly.
+     */
+    bool continue_loads( )
+    {
+        bool return_value = false;
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL ) {
+            if( ( *file )->loading( )  &&  ( *file )->continue_loading( 16384 ) )
+                return_value = true;
+        }
+        return return_value;
+    }
+
+
+    bool journals_pending( )
+    {
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL )
+            if( ( *file )->journal_pending( ) ) return true;
+
+        return false;
+    }
+
+
+    void flush_journals( )
+    {
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL ) ( *file )->flush_journal( );
+    }
+
+
+    void discard_journals( )
+    {
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL ) ( *file )->end_journal( );
+    }
+
+
+    bool follows_pending( )
+    {
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL )
+            if( ( *file )->is_following( ) ) return true;
+
+        return false;
+    }
+
+
+    int changes_descriptor( )
+    {
+        return watcher.descriptor( );
+    }
+
+
+    /*!
+     * Files being written are only checked when they are finished so that half written files
+     * aren't read, except that followed files are read as they grow. Files being saved here are
+     * checked when their saves are finished (see check_saves) since their time stamps aren't
+     * known until then. If files can't be watched, only followed files are checked and every
+     * one of them is checked each time.
+     */
+    bool check_changes( )
+    {
+        bool return_value = false;
+        std::map< std::string, FileWatcher::Event > events;
+        const bool watching = ( watcher.descriptor( ) >= 0 );
+        const bool complete = watcher.read_events( events );
+        const YEditFile *const active = &active_file( );
+        YEditFile **file;
+        YFileList::Iterator stepper( the_list );
+
+        while( ( file = stepper( ) ) != NULL ) {
+            bool touched = !complete;
+            if( !touched ) {
+                // Files that aren't watched (such as results files) have no events.
+                const std::map< YEditFile *, std::string >::iterator watched =
+                    watched_names.find( *file );
+                std::map< std::string, FileWatcher::Event >::iterator event = events.end( );
+                if( watched != watched_names.end( ) ) event = events.find( watched->second );
+                if( event != events.end( ) ) touched =
+                    ( event->second == FileWatcher::CHANGED  ||  ( *file )->is_following( ) );
+                else if( !watching ) touched = ( *file )->is_following( );
+            }
+            if( !touched ) continue;
+
+            // The save's time stamp isn't known yet. The file is checked when the save is done.
+            PendingSave *const save = save_of( *file );
+            if( save != NULL ) {
+                save->touched = true;
+                continue;
+            }
+
+            if( update_file( *file )  &&  *file == active ) return_value = true;
+        }
         return return_value;
     }
 
@@ -345,8 +791,18 @@ namespace FileList {
         YEditFile **file;
         YFileList::Iterator stepper( the_list );
 
+        // Files being saved will appear to be more recent.
+        finish_saves( );
+
         while( ( file = stepper( ) ) != NULL ) {
 
+            // Followed files only need their new text.
+            if( ( *file )->is_following( ) ) {
+                if( ( *file )->follow( ( *file )->name( ) )  &&  ( *file )->is_pinned( ) )
+                    ( *file )->bottom_of_file( );
+                continue;
+            }
+
             // Read date and time stamp for disk versions of files.
             FileNameMatcher  stamper;
             char            *name_string;
@@ -354,25 +810,11 @@ namespace FileList {
             stamper.set_name( ( *file )->name( ) );
             if( ( name_string = stamper.next( ) ) != NULL ) {
 
-                // Check to see if disk version is more recent. If so, reload.
-                if( stamper.modify_time( ) > ( *file )->time( ) ) {
-
-                    // Remember current point in file.
-                    FilePosition point = ( *file )->CP( );
-
-                    // Erase the file's data.
-                    ( *file )->top_of_file( );
-                    ( *file )->set_block_state( true );
-                    ( *file )->bottom_of_file( );
-                    ( *file )->delete_block( );
-                    ( *file )->set_block_state( false );
-                    ( *file )->top_of_file( );
-
-                    // Get the new stuff.
-                    ( *file )->load( name_string );
-                    ( *file )->set_timestamp( name_string );
-                    ( *file )->CP( ) = point;
-                    ( *file )->mark_as_unchanged( );
+                // Check to see if disk version is different. If so, reload. Changes made here
+                // are kept if they can be merged.
+                if( stamper.modify_time( ) != ( *file )->time( ) ) {
+                    if( !( *file )->changed( )  ||  !merge_file( *file ) )
+                        ( *file )->reload( name_string );
                 }
             }
         }
@@ -386,12 +828,99 @@ namespace FileList {
         YEditFile **file;
         YFileList::Iterator stepper( the_list );
 
+        // A file with a failed save is still changed.
+        finish_saves( );
+
         while( ( file = stepper( ) ) != NULL )
             if( ( *file )->changed( ) ) return false;
 
         return true;
     }
 
+    /*!
+     * Every file except results files and files shown read-only is searched, using several
+     * threads (see search_targets). The threads search copies of the files' lines. If there
+     * are any matches they are shown in a results file, which becomes the active file.
+     */
+    long search_all( const SearchPattern &pattern )
+    {
+        std::vector< SearchTarget > targets;
+
+        // The stepper restores the list's current point when it is destroyed.
+        {
+            YEditFile **file;
+            YFileList::Iterator stepper( the_list );
+
+            while( ( file = stepper( ) ) != NULL ) {
+                if( ( *file )->read_only( ) ) continue;
+                if( dynamic_cast< RESULTS_YEditFile * >( *file ) != NULL ) continue;
+
+                targets.push_back( SearchTarget( ) );
+                targets.back( ).name = ( *file )->name( );
+                ( *file )->copy_lines( targets.back( ).lines );
+            }
+        }
+
+        const std::vector< std::string > matches = search_targets( pattern, targets );
+        if( matches.empty( )  ||  show_results( results_name, matches ) == NULL ) return 0;
+        return static_cast< long >( matches.size( ) );
+    }
+
+    /*!
+     * The results file is shown at once, empty, and the results are added to it as they are
+     * found (see check_searches). A search already running is stopped first.
+     */
+    bool search_tree( const SearchPattern &pattern, const char *directory, const char *wild_name )
+    {
+        tree_search.reset( new TreeSearch( pattern, directory, wild_name ) );
+        if( !tree_search->started( ) ) {
+            tree_search.reset( );
+            error_message( "Can't start a thread to search %s", directory );
+            return false;
+        }
+
+        tree_results = show_results( tree_results_name, std::vector< std::string >( ) );
+        if( tree_results == NULL ) {
+            tree_search.reset( );
+            return false;
+        }
+        return true;
+    }
+
+
+    bool searches_pending( )
+    {
+        return( tree_search != nullptr );
+    }
+
+
+    bool check_searches( )
+    {
+        if( tree_search == nullptr ) return false;
+
+        std::vector< std::string > results;
+        const bool finished = tree_search->take_results( results );
+        if( !results.empty( ) ) tree_results->add_results( results );
+
+        if( finished ) {
+            const long files = tree_search->files_searched( );
+            const long lines = tree_results->line_count( );
+            const char *const files_suffix = ( files == 1 ) ? "" : "s";
+            const char *const lines_suffix = ( lines == 1 ) ? "" : "s";
+            if( tree_search->failed( ) ) {
+                error_message( "Out of memory. Search stopped after %ld file%s. %ld line%s found",
+                               files, files_suffix, lines, lines_suffix );
+            }
+            else {
+                info_message( "Searched %ld file%s. %ld line%s found",
+                              files, files_suffix, lines, lines_suffix );
+            }
+            tree_search.reset( );
+            tree_results = NULL;
+        }
+        return( finished  ||  !results.empty( ) );
+    }
+
     /*================================================*/
     /*           Pertaining to the bookmark           */
     /*================================================*/
@@ -6,6 +6,7 @@
 #ifndef FILELIST_HPP
 #define FILELIST_HPP
 
+class SearchPattern;
 class YEditFile;
 
 //! Encloses functions that manipulate the file list abstract object.
@@ -28,15 +29,70 @@ class YEditFile;
  * in YEditFile might get moved here eventually. In particular, YEditFile::display( ) knows
  * nothing about the other files. In a multi-windowed version of Y that maintained images of
  * several different files on the screen at once, display( ) might have to be in FileList.
+ *
+ * Files can be saved in the background while editing continues. A file being saved must not be
+ * removed from the list or reloaded until its save is finished; the functions here that do
+ * such things finish any pending saves first.
+ *
+ * The files in the list are watched so that changes made to them by other programs can be
+ * noticed. The main loop waits on changes_descriptor( ) and calls check_changes( ) when it is
+ * readable.
+ *
+ * The changes made to each file are recorded in a journal (see DiskEditFile::start_journal) so
+ * that they can be recovered if Y dies before they are saved. When a file with a journal left
+ * by an earlier session is loaded, the user is offered its changes. The main loop calls
+ * flush_journals( ) when the user pauses.
+ *
+ * A directory tree can be searched in the background (see search_tree). The results appear in
+ * a results file as they are found.
  */
 namespace FileList {
 
     //! Returns a reference to the active YEditFile.
     YEditFile &active_file( );
 
+    //! Returns a descriptor that is readable when watched files change, or -1.
+    int changes_descriptor( );
+
+    //! Reports on background saves that have finished. Returns true if anything was reported.
+    /*!
+     * Files that changed on disk while they were being saved are brought up to date.
+     */
+    bool check_saves( );
+
+    //! Reloads files changed by other programs. Returns true if the active file changed.
+    /*!
+     * Followed files have the text added to them read instead. A file that was also changed
+     * here has the two sets of changes merged. If that isn't possible, it is only reloaded if
+     * the user agrees.
+     */
+    bool check_changes( );
+
+    //! Shows the results found by the search of a directory tree since the last call.
+    /*!
+     * Returns true if the results file changed or the search finished. The end of the search
+     * is reported, including whether it was cut short because memory ran out.
+     */
+    bool check_searches( );
+
     //! Returns the number of files currently in the list.
     unsigned count( );
 
+    //! Deletes the journals of all files. Used when the user discards their changes.
+    void discard_journals( );
+
+    //! Waits for all background saves to finish. Returns false if any of them failed.
+    bool finish_saves( );
+
+    //! Makes more lines of files being loaded lazily. Returns true if any are still loading.
+    bool continue_loads( );
+
+    //! Writes the changes recorded in the journals of all files.
+    void flush_journals( );
+
+    //! Returns true if any files are being followed.
+    bool follows_pending( );
+
     //! Inserts active file into specified file.
     /*!
      * This is a somewhat strange function. Is there a better (more general) way to handle the
@@ -44,6 +100,12 @@ namespace FileList {
      */
     bool insert_active( const char *name );
 
+    //! Returns true if any journals have changes that haven't been written.
+    bool journals_pending( );
+
+    //! Returns true if any files are still being loaded lazily.
+    bool loads_pending( );
+
     //! Removes active file from list and marks next file as active.
     void kill( );
 
@@ -68,6 +130,29 @@ namespace FileList {
     //! Save all files that have changed and resets their changed flag.
     bool save_changes( );
 
+    //! Starts saving a file in the background and resets its changed flag.
+    void save_in_background( YEditFile &file );
+
+    //! Returns true if any files are being saved in the background.
+    bool saves_pending( );
+
+    //! Searches all files for a pattern. Returns the number of lines that match.
+    /*!
+     * The lines that match are shown in a results file, which becomes the active file. Each
+     * line of the results file names a file, a line, and a column (see format_match).
+     */
+    long search_all( const SearchPattern &pattern );
+
+    //! Starts searching the files in a directory tree in the background. See TreeSearch.
+    /*!
+     * The lines that match are added to a results file, which becomes the active file, as they
+     * are found. The main loop calls check_searches( ) while searches_pending( ) is true.
+     */
+    bool search_tree( const SearchPattern &pattern, const char *directory, const char *wild_name );
+
+    //! Returns true if a directory tree is being searched.
+    bool searches_pending( );
+
     //! Remembers current file and position.
     void set_bookmark( );
 
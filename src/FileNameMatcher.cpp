@@ -95,7 +95,7 @@ char *FileNameMatcher::next()
             }
 
             // If the file's not a regular file, it's "not there."
-            if( !S_ISREG( file_info.st_dev ) ) {
+            if( !S_ISREG( file_info.st_mode ) ) {
                 done = true;
                 return 0;
             }
@@ -116,21 +116,18 @@ char *FileNameMatcher::next()
 
         // Directories will have a trailing slash. Forget about them.
         char *end = strchr( buffer, '\0' ); end--;
-        if( *end != '/' ) break;
+        if( *end != '/' ) return return_value;
     }
 
-    // If we ran out of globbed data, then we are done.
-    if( match_index >= static_cast< int >( glob_data.gl_pathc ) ) {
-        done         = true;
-        return_value = 0;
-        globfree( &glob_data );
-    }
-
-    return return_value;
+    // We ran out of globbed data so we are done.
+    done = true;
+    globfree( &glob_data );
+    return 0;
 }
 
 
-time_t FileNameMatcher::modify_time()
+//! Returns the time the file was last modified, in nanoseconds since the epoch.
+long long FileNameMatcher::modify_time()
 {
     // Assume that buffer contains a file name.
 
@@ -144,7 +141,13 @@ time_t FileNameMatcher::modify_time()
         return 0;
     }
 
-    return file_info.st_mtime;
+    // macOS gives the field a different name.
+    #if defined( __APPLE__ )
+    const struct timespec &modified = file_info.st_mtimespec;
+    #else
+    const struct timespec &modified = file_info.st_mtim;
+    #endif
+    return static_cast< long long >( modified.tv_sec ) * 1000000000LL + modified.tv_nsec;
 }
 
 
@@ -58,7 +58,7 @@ public:
 
     // Return information on file after successful call to next().
     int           actual_attribute( )  { return (int)NORMAL; }
-    time_t        modify_time( );
+    long long     modify_time( );
     unsigned long size( );
     char         *plain_name( );
 };
@@ -0,0 +1,524 @@
+/*! \file    FileSearch.cpp
+ *  \brief   Implementation of functions that search many files at once.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#include "environ.hpp"
+
+#if eOPSYS == ePOSIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FileNameMatcher.hpp"
+#include "FileSearch.hpp"
+#include "scan.hpp"
+#include "TextBlock.hpp"
+
+/*=======================================*/
+/*           Private Functions           */
+/*=======================================*/
+
+namespace {
+
+    //! Part of a file searched by one thread at a time.
+    struct Piece {
+        std::size_t target;  //!< The index of the file.
+        std::size_t first;   //!< The index of the first line.
+        std::size_t last;    //!< The index just past the last line.
+    };
+
+    //! Reads a number starting at text[index]. Returns false if there are no digits there.
+    bool read_number( const std::string &text, std::size_t &index, long &value )
+    {
+        const std::size_t start = index;
+        long result = 0;
+        while( index < text.size( )  &&
+               std::isdigit( static_cast< unsigned char >( text[index] ) ) ) {
+            if( result < 100000000L ) result = 10 * result + ( text[index] - '0' );
+            ++index;
+        }
+        if( index == start ) return false;
+        value = result;
+        return true;
+    }
+
+    //! Reads a file into a new block.
+    /*!
+     * Only ordinary files are read. The file is opened without blocking so that opening a named
+     * pipe doesn't wait for a writer. The file is copied rather than mapped because other
+     * programs might change it while it is searched; a mapped file that shrinks would crash Y.
+     * If the file shrinks while it is read, the part that was read is returned.
+     *
+     * \return The block, which belongs to the caller, or NULL if the file can't be read or is
+     * empty.
+     */
+    TextBlock *read_file( const std::string &name )
+    {
+      #if eOPSYS == ePOSIX
+        const int descriptor = open( name.c_str( ), O_RDONLY | O_NONBLOCK );
+        if( descriptor < 0 ) return NULL;
+
+        struct stat file_info;
+        TextBlock *block = NULL;
+        if( fstat( descriptor, &file_info ) == 0  &&  S_ISREG( file_info.st_mode )  &&
+            file_info.st_size > 0 ) {
+            block = TextBlock::make( static_cast< std::size_t >( file_info.st_size ) );
+        }
+        if( block != NULL ) {
+            std::size_t total = 0;
+            while( total < block->size( ) ) {
+                const ssize_t count = pread(
+                    descriptor, block->data( ) + total, block->size( ) - total,
+                    static_cast< off_t >( total ) );
+                if( count < 0  &&  errno == EINTR ) continue;
+                if( count <= 0 ) break;
+                total += static_cast< std::size_t >( count );
+            }
+            if( total == 0  ||  !block->resize( total ) ) {
+                block->release( );
+                block = NULL;
+            }
+        }
+        close( descriptor );
+        return( block );
+      #else
+        std::FILE *const file = std::fopen( name.c_str( ), "rb" );
+        if( file == NULL ) return NULL;
+
+        TextBlock *block = NULL;
+        long size = 0;
+        if( std::fseek( file, 0, SEEK_END ) == 0  &&  ( size = std::ftell( file ) ) > 0  &&
+            std::fseek( file, 0, SEEK_SET ) == 0 ) {
+            block = TextBlock::make( static_cast< std::size_t >( size ) );
+            if( block != NULL  &&
+                std::fread( block->data( ), 1, block->size( ), file ) != block->size( ) ) {
+                block->release( );
+                block = NULL;
+            }
+        }
+        std::fclose( file );
+        return( block );
+      #endif
+    }
+
+}
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+std::string format_match(
+    const std::string &name, const long line, const std::size_t column, const std::string &text )
+{
+    char numbers[64];
+    std::snprintf( numbers, sizeof( numbers ), ":%ld:%zu: ", line + 1, column + 1 );
+
+    std::string result( name );
+    result.append( numbers );
+    result.append( text );
+    return( result );
+}
+
+
+/*!
+ * The name ends at the first colon followed by a line number and another colon. A column
+ * number and a colon may follow. Thus names that contain colons (such as C:\FILE.TXT) are
+ * handled.
+ */
+bool parse_match( const std::string &text, std::string &name, long &line, long &column )
+{
+    std::size_t colon = 0;
+    while( ( colon = text.find( ':', colon + 1 ) ) != std::string::npos ) {
+        std::size_t index = colon + 1;
+        long line_number;
+        if( !read_number( text, index, line_number ) ) continue;
+        if( index >= text.size( )  ||  text[index] != ':'  ||  line_number == 0 ) continue;
+
+        // The column is optional.
+        long column_number = 1;
+        ++index;
+        if( !read_number( text, index, column_number )  ||  index >= text.size( )  ||
+            text[index] != ':'  ||  column_number == 0 ) column_number = 1;
+
+        name.assign( text, 0, colon );
+        line   = line_number - 1;
+        column = column_number - 1;
+        return true;
+    }
+    return false;
+}
+
+
+std::vector< std::string > search_targets(
+    const SearchPattern &pattern, const std::vector< SearchTarget > &targets, unsigned threads )
+{
+    // There is no point dividing the files into very small pieces.
+    const std::size_t piece_size = 4096;
+
+    if( threads == 0 ) threads = std::max( 1U, std::thread::hardware_concurrency( ) );
+
+    std::vector< Piece > pieces;
+    for( std::size_t target = 0; target < targets.size( ); ++target ) {
+        const std::size_t size = targets[target].lines.size( );
+        for( std::size_t first = 0; first < size; first += piece_size ) {
+            pieces.push_back( { target, first, std::min( size, first + piece_size ) } );
+        }
+    }
+
+    // Search the pieces. Each thread takes the next piece not searched until none are left.
+    const std::size_t count = pieces.size( );
+    std::vector< std::vector< std::string > > results( count );
+    std::atomic< std::size_t > next_piece( 0 );
+    std::atomic< bool >        failed( false );
+
+    auto search_pieces = [&]( ) {
+        try {
+            const SearchPattern local_pattern( pattern );
+            std::size_t piece;
+            while( ( piece = next_piece.fetch_add( 1 ) ) < count ) {
+                const SearchTarget &target = targets[pieces[piece].target];
+                for( std::size_t i = pieces[piece].first; i < pieces[piece].last; ++i ) {
+                    std::size_t match_length;
+                    const EditBuffer &line = target.lines[i];
+                    const std::size_t offset = line.find( local_pattern, 0, match_length );
+                    if( offset == SearchPattern::npos ) continue;
+                    results[piece].push_back( format_match(
+                        target.name, static_cast< long >( i ), offset, line.to_string( ) ) );
+                }
+            }
+        }
+        catch( std::bad_alloc & ) {
+            failed = true;
+        }
+    };
+
+    // This thread helps, so one less thread is started. Starting fewer threads than expected
+    // just makes the search slower.
+    std::vector< std::thread > helpers;
+    for( unsigned i = 1; i < threads  &&  i < count; ++i ) {
+        try {
+            helpers.push_back( std::thread( search_pieces ) );
+        }
+        catch( std::system_error & ) {
+            break;
+        }
+    }
+    search_pieces( );
+    for( std::thread &helper : helpers ) helper.join( );
+
+    if( failed ) throw std::bad_alloc( );
+    std::vector< std::string > matches;
+    for( std::vector< std::string > &result : results ) {
+        for( std::string &match : result ) matches.push_back( std::move( match ) );
+    }
+    return( matches );
+}
+
+/*================================*/
+/*           TreeSearch           */
+/*================================*/
+
+//! Starts searching a directory tree.
+/*!
+ * The search is done only if at least one thread can be started (see started( )).
+ *
+ * \param the_pattern The pattern to search for. It must be valid.
+ * \param directory The directory at the top of the tree. An empty name means the current
+ * directory.
+ * \param the_wild_name The names of the files to search, for example *.cpp.
+ * \param threads The number of threads to use. Zero means one for each processor.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+TreeSearch::TreeSearch( const SearchPattern &the_pattern, const std::string &directory,
+                        const std::string &the_wild_name, unsigned threads ) :
+    pattern     ( the_pattern ),
+    wild_name   ( the_wild_name ),
+    thread_count( threads == 0 ? std::max( 1U, std::thread::hardware_concurrency( ) ) : threads ),
+    queues      ( new Queue[thread_count] ),
+    outstanding ( 0 ),
+    queued      ( 0 ),
+    idle        ( 0 ),
+    running     ( 0 ),
+    stopping    ( false ),
+    ran_out     ( false ),
+    searched    ( 0 )
+{
+    push( 0, Task{ directory, true } );
+    workers.reserve( thread_count );
+
+    // Starting fewer threads than expected just makes the search slower. If none can be started
+    // the search is not done at all. Doing it on this thread would stop everything else until
+    // the whole tree was searched.
+    for( unsigned i = 0; i < thread_count; ++i ) {
+        running.fetch_add( 1, std::memory_order_relaxed );
+        try {
+            workers.push_back( std::thread( &TreeSearch::work, this, i ) );
+        }
+        catch( std::system_error & ) {
+            running.fetch_sub( 1, std::memory_order_relaxed );
+            break;
+        }
+    }
+}
+
+
+//! Stops the search, waiting for the threads to finish the work they have started.
+TreeSearch::~TreeSearch( )
+{
+    stopping = true;
+    wake( true );
+    for( std::thread &worker : workers ) worker.join( );
+}
+
+
+//! Takes the results found since the last call.
+/*!
+ * \param results The results (see format_match) are added to the end of this vector. The
+ * results of each file are together and in order but the files are in no particular order.
+ * \return true if the search is finished. All results have been taken in that case.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+bool TreeSearch::take_results( std::vector< std::string > &results )
+{
+    // Results found before the threads finished are taken below.
+    const bool finished = ( running.load( std::memory_order_acquire ) == 0 );
+
+    std::lock_guard< std::mutex > guard( results_lock );
+    for( std::string &result : found ) results.push_back( std::move( result ) );
+    found.clear( );
+    return finished;
+}
+
+
+//! Adds a task to the back of a queue.
+void TreeSearch::push( const unsigned queue, Task &&task )
+{
+    outstanding.fetch_add( 1, std::memory_order_relaxed );
+    {
+        std::lock_guard< std::mutex > guard( queues[queue].lock );
+        queues[queue].tasks.push_back( std::move( task ) );
+    }
+    queued.fetch_add( 1 );
+    wake( false );
+}
+
+
+//! Takes the newest task from a thread's own queue. Returns false if there is none.
+bool TreeSearch::pop( const unsigned queue, Task &task )
+{
+    std::lock_guard< std::mutex > guard( queues[queue].lock );
+    if( queues[queue].tasks.empty( ) ) return false;
+    task = std::move( queues[queue].tasks.back( ) );
+    queues[queue].tasks.pop_back( );
+    queued.fetch_sub( 1 );
+    return true;
+}
+
+
+//! Takes the oldest task from another thread's queue. Returns false if there is none.
+bool TreeSearch::steal( const unsigned queue, Task &task )
+{
+    for( unsigned i = 1; i < thread_count; ++i ) {
+        Queue &victim = queues[( queue + i ) % thread_count];
+        std::lock_guard< std::mutex > guard( victim.lock );
+        if( victim.tasks.empty( ) ) continue;
+        task = std::move( victim.tasks.front( ) );
+        victim.tasks.pop_front( );
+        queued.fetch_sub( 1 );
+        return true;
+    }
+    return false;
+}
+
+
+//! Waits until a task is queued, all tasks are finished, or the search is stopped.
+void TreeSearch::wait_for_work( )
+{
+    std::unique_lock< std::mutex > guard( idle_lock );
+    idle.fetch_add( 1 );
+    wakeup.wait( guard, [this]( ) {
+        return( queued.load( ) > 0  ||  outstanding.load( ) == 0  ||  stopping.load( ) ); } );
+    idle.fetch_sub( 1 );
+}
+
+
+//! Wakes threads waiting for work.
+/*!
+ * The condition a thread waits for is changed before this is called. Threads that are about to
+ * wait either see the change or are counted as idle here, so none of them can miss it.
+ *
+ * \param everyone True to wake every thread waiting, false to wake one.
+ */
+void TreeSearch::wake( const bool everyone )
+{
+    if( idle.load( ) == 0 ) return;
+
+    // Once the lock is free, a thread that checked the condition before it changed is waiting.
+    { std::lock_guard< std::mutex > guard( idle_lock ); }
+    if( everyone ) wakeup.notify_all( );
+    else wakeup.notify_one( );
+}
+
+
+//! Does tasks until there are none left. This is the body of the threads.
+/*!
+ * \param queue The index of the thread's own queue.
+ */
+void TreeSearch::work( const unsigned queue )
+{
+    try {
+        // Searching for an expression changes the pattern so each thread needs its own.
+        const SearchPattern local_pattern( pattern );
+        std::string workspace;
+        Task task;
+
+        while( !stopping.load( std::memory_order_relaxed ) ) {
+            if( !pop( queue, task )  &&  !steal( queue, task ) ) {
+                // Other threads might still find more work.
+                if( outstanding.load( std::memory_order_acquire ) == 0 ) break;
+                wait_for_work( );
+                continue;
+            }
+            if( task.directory ) read_directory( queue, task.name );
+            else search_file( local_pattern, task.name, workspace );
+            if( outstanding.fetch_sub( 1, std::memory_order_release ) == 1 ) wake( true );
+        }
+    }
+    catch( std::bad_alloc & ) {
+        // The tasks of this thread can't be finished so the others must stop too.
+        ran_out  = true;
+        stopping = true;
+        wake( true );
+    }
+    running.fetch_sub( 1, std::memory_order_release );
+}
+
+
+//! Adds the directories in a directory, and the files in it that are wanted, to a queue.
+void TreeSearch::read_directory( const unsigned queue, const std::string &name )
+{
+  #if eOPSYS == ePOSIX
+    const char separator = '/';
+  #else
+    const char separator = '\\';
+  #endif
+    std::string prefix( name );
+    if( !prefix.empty( )  &&  prefix.back( ) != separator ) prefix.push_back( separator );
+
+  #if eOPSYS == ePOSIX
+    DIR *const directory = opendir( name.empty( ) ? "." : name.c_str( ) );
+    if( directory != NULL ) {
+        struct dirent *entry;
+        while( ( entry = readdir( directory ) ) != NULL ) {
+            if( entry->d_name[0] == '.' ) continue;
+
+            // Symbolic links aren't followed so the walk can't go around in circles.
+            const std::string full_name( prefix + entry->d_name );
+            bool is_directory = ( entry->d_type == DT_DIR );
+            if( entry->d_type == DT_UNKNOWN ) {
+                struct stat file_info;
+                is_directory = ( lstat( full_name.c_str( ), &file_info ) == 0  &&
+                                 S_ISDIR( file_info.st_mode ) );
+            }
+            if( is_directory ) push( queue, Task{ full_name, true } );
+        }
+        closedir( directory );
+    }
+  #endif
+
+    // The matcher is always run to the end so that it cleans up after itself.
+    FileNameMatcher matcher;
+    const std::string wanted( prefix + wild_name );
+    char *file_name;
+    matcher.set_name( wanted.c_str( ) );
+    while( ( file_name = matcher.next( ) ) != NULL ) {
+        if( !stopping.load( std::memory_order_relaxed ) ) push( queue, Task{ file_name, false } );
+    }
+}
+
+
+//! Searches one file and adds the lines that match to the results.
+/*!
+ * For text (not expressions) the rest of the file is searched first and lines before the next
+ * match are only searched if they would change when loaded. Otherwise each line is searched.
+ *
+ * \param local_pattern The thread's own copy of the pattern.
+ * \param name The name of the file.
+ * \param workspace Scratch space for lines that must be cooked.
+ */
+void TreeSearch::search_file(
+    const SearchPattern &local_pattern, const std::string &name, std::string &workspace )
+{
+    // The size of the start of a file that is checked for null characters.
+    const std::size_t binary_check = 4096;
+
+    TextBlock *const block = read_file( name );
+    if( block == NULL ) return;
+
+    const char *const text   = block->data( );
+    const char *const finish = text + block->size( );
+    const bool  literal      = !local_pattern.is_regular_expression( );
+    std::vector< std::string > matches;
+
+    if( std::memchr( text, '\0', std::min( block->size( ), binary_check ) ) == NULL ) {
+        const char *start = text;
+        const char *next_match = NULL;  // Where the text next appears in the raw text.
+        long line = 0;
+
+        while( start < finish ) {
+            const char *end = find_line_special( start, finish );
+            const bool raw = ( end != finish  &&  *end != '\n' );
+            if( raw ) {
+                end = static_cast< const char * >( std::memchr( end, '\n', finish - end ) );
+                if( end == NULL ) end = finish;
+            }
+
+            if( literal  &&  ( next_match == NULL  ||  next_match < start ) ) {
+                const std::size_t found =
+                    local_pattern.find( start, static_cast< std::size_t >( finish - start ) );
+                next_match = ( found == SearchPattern::npos ) ? finish : start + found;
+            }
+
+            // Lines that are loaded as they are can't match before the next match.
+            if( !literal  ||  raw  ||  next_match < end ) {
+                const char *line_text = start;
+                std::size_t length = static_cast< std::size_t >( end - start );
+                if( raw ) {
+                    cook_text( start, length, workspace );
+                    line_text = workspace.data( );
+                    length = workspace.size( );
+                }
+
+                std::size_t match_length;
+                const std::size_t offset =
+                    local_pattern.find( line_text, length, NULL, 0, 0, match_length );
+                if( offset != SearchPattern::npos ) {
+                    matches.push_back(
+                        format_match( name, line, offset, std::string( line_text, length ) ) );
+                }
+            }
+            ++line;
+            start = end + 1;
+        }
+    }
+    block->release( );
+    searched.fetch_add( 1, std::memory_order_relaxed );
+
+    if( !matches.empty( ) ) {
+        std::lock_guard< std::mutex > guard( results_lock );
+        for( std::string &match : matches ) found.push_back( std::move( match ) );
+    }
+}
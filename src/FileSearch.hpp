@@ -0,0 +1,155 @@
+/*! \file    FileSearch.hpp
+ *  \brief   Interface to functions that search many files at once.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FILESEARCH_HPP
+#define FILESEARCH_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EditBuffer.hpp"
+#include "SearchPattern.hpp"
+
+//! The text of a file copied so that it can be searched by other threads.
+/*!
+ * The lines are copies of the file's lines (see DiskEditFile::copy_lines) so they don't change
+ * while the search runs. As with all EditBuffers they must be made and destroyed by the main
+ * thread. The searching threads only read them.
+ */
+struct SearchTarget {
+    std::string               name;   //!< The name of the file.
+    std::vector< EditBuffer > lines;  //!< The text of the file.
+};
+
+//! Describes a match as a line of text: "name:line:column: text".
+/*!
+ * Line and column numbers count from one, as the user sees them. The text is the line that
+ * holds the match. Compilers describe errors the same way.
+ */
+std::string format_match(
+    const std::string &name, long line, std::size_t column, const std::string &text );
+
+//! Finds the description of a match in a line made by format_match (or by a compiler).
+/*!
+ * \param text The line to examine.
+ * \param name Receives the name of the file.
+ * \param line Receives the line of the match, counting from zero.
+ * \param column Receives the column of the match, counting from zero.
+ * \return false if the line doesn't describe a match. The outputs are unchanged in that case.
+ */
+bool parse_match( const std::string &text, std::string &name, long &line, long &column );
+
+//! Finds the lines of several files that match a pattern, using several threads.
+/*!
+ * The lines are divided into pieces and each thread takes the next piece not yet searched
+ * until none are left. Each thread searches with its own copy of the pattern since searching
+ * for a regular expression changes it. The result is exactly what searching the files one line
+ * after another would produce.
+ *
+ * \param pattern The pattern to search for. It must be valid.
+ * \param targets The files to search.
+ * \param threads The number of threads to use. Zero means one for each processor.
+ * \return A description of the first match on each line that matches (see format_match), in
+ * the order of the files and then of their lines.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+std::vector< std::string > search_targets(
+    const SearchPattern &pattern, const std::vector< SearchTarget > &targets,
+    unsigned threads = 0 );
+
+//! Searches the files in a directory tree in the background.
+/*!
+ * The files whose names match a wildcard pattern (see FileNameMatcher) in a directory and in
+ * all the directories below it are searched by a group of threads. The results can be taken
+ * while the search runs so they can be shown as they are found. Directories whose names start
+ * with a dot and symbolic links to directories are skipped, as are files that appear to be
+ * binary (having a null character near the start). On systems other than POSIX only the top
+ * directory is searched.
+ *
+ * Each thread has a queue of work: directories to read and files to search. A thread takes
+ * work from the back of its own queue, and the work it finds while reading a directory goes
+ * there too, so each thread works through its part of the tree depth first. A thread with
+ * nothing to do steals work from the front of another thread's queue, which holds the oldest
+ * work, typically the largest parts of the tree. A thread that finds no work at all sleeps until
+ * more is queued or the search ends.
+ *
+ * Only ordinary files are searched; named pipes and other special files are skipped. Each file
+ * is read into memory and searched there. Each line is searched as it would be if the file were
+ * loaded (tabs expanded and so on; see cook_text) so the results describe the lines as Y shows
+ * them.
+ */
+class TreeSearch {
+public:
+    TreeSearch( const SearchPattern &the_pattern, const std::string &directory,
+                const std::string &the_wild_name, unsigned threads = 0 );
+   ~TreeSearch( );
+
+    bool take_results( std::vector< std::string > &results );
+
+    //! Returns false if no thread could be started. The search is not done in that case.
+    bool started( ) const
+        { return( !workers.empty( ) ); }
+
+    //! Returns the number of files searched so far.
+    long files_searched( ) const
+        { return( searched.load( std::memory_order_relaxed ) ); }
+
+    //! Returns true if the search was stopped early because memory ran out.
+    bool failed( ) const
+        { return( ran_out.load( std::memory_order_relaxed ) ); }
+
+private:
+    //! A directory to read or a file to search.
+    struct Task {
+        std::string name;       //!< The name of the directory or file.
+        bool        directory;  //!< True if the name is of a directory.
+    };
+
+    //! The work waiting to be done by one thread.
+    struct Queue {
+        std::mutex         lock;   //!< Protects tasks.
+        std::deque< Task > tasks;  //!< The work, oldest first.
+    };
+
+    SearchPattern              pattern;      //!< What to search for.
+    std::string                wild_name;    //!< The names of the files to search.
+    unsigned                   thread_count; //!< The number of queues (and threads).
+    std::unique_ptr< Queue[] > queues;       //!< The work of each thread.
+    std::vector< std::thread > workers;      //!< The threads.
+    std::atomic< long >        outstanding;  //!< Tasks not yet finished.
+    std::atomic< long >        queued;       //!< Tasks in the queues, not yet taken.
+    std::atomic< unsigned >    idle;         //!< Threads waiting for work.
+    std::mutex                 idle_lock;    //!< Used with wakeup.
+    std::condition_variable    wakeup;       //!< Signalled when idle threads might have work.
+    std::atomic< unsigned >    running;      //!< Threads that are still working.
+    std::atomic< bool >        stopping;     //!< Set to make the threads stop early.
+    std::atomic< bool >        ran_out;      //!< Set if a thread ran out of memory.
+    std::atomic< long >        searched;     //!< The number of files searched.
+    std::mutex                 results_lock; //!< Protects found.
+    std::vector< std::string > found;        //!< Results not yet taken.
+
+    void push( unsigned queue, Task &&task );
+    bool pop( unsigned queue, Task &task );
+    bool steal( unsigned queue, Task &task );
+    void wait_for_work( );
+    void wake( bool everyone );
+    void work( unsigned queue );
+    void read_directory( unsigned queue, const std::string &name );
+    void search_file( const SearchPattern &local_pattern, const std::string &name,
+                      std::string &workspace );
+
+    // Searches can't be copied (the threads refer to the search).
+    TreeSearch( const TreeSearch & ) = delete;
+    TreeSearch &operator=( const TreeSearch & ) = delete;
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*! \file    FileWatcher.cpp
+ *  \brief   Implementation of class FileWatcher
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "FileWatcher.hpp"
+
+#if eOPSYS == ePOSIX
+#include <unistd.h>
+#if defined( __linux__ )
+#include <sys/inotify.h>
+#define USE_INOTIFY
+#endif
+#endif
+
+#if defined( USE_INOTIFY )
+//! The events watched for in each directory.
+static const std::uint32_t watch_mask =
+    IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+#endif
+
+
+FileWatcher::FileWatcher( ) :
+    inotify_descriptor( -1 )
+{
+  #if defined( USE_INOTIFY )
+    inotify_descriptor = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+  #endif
+}
+
+
+FileWatcher::~FileWatcher( )
+{
+  #if defined( USE_INOTIFY )
+    if( inotify_descriptor >= 0 ) close( inotify_descriptor );
+  #endif
+}
+
+
+//! Starts watching a file.
+/*!
+ * Each file that is watched should be forgotten once. Watching a file more than once is
+ * harmless but it must then be forgotten as many times.
+ *
+ * \param name The name of the file. The file need not exist yet but its directory must.
+ * \return The full name of the file as it appears in the events that concern it.
+ */
+std::string FileWatcher::watch( const char *name )
+{
+    // Find the full name of the file's directory.
+    std::string directory;
+    const char *slash = std::strrchr( name, '/' );
+    if( slash == NULL ) directory = ".";
+    else directory.assign( name, slash == name ? 1 : slash - name );
+    const char *const base = ( slash == NULL ) ? name : slash + 1;
+
+  #if eOPSYS == ePOSIX
+    char *const resolved = realpath( directory.c_str( ), NULL );
+    if( resolved != NULL ) {
+        directory = resolved;
+        std::free( resolved );
+    }
+  #endif
+    const std::string prefix = ( directory == "/" ) ? directory : directory + "/";
+    const std::string full_name = prefix + base;
+
+  #if defined( USE_INOTIFY )
+    if( inotify_descriptor >= 0 ) {
+        std::map< std::string, Directory >::iterator p = directories.find( directory );
+        if( p != directories.end( ) ) ++p->second.users;
+        else {
+            const int watch =
+                inotify_add_watch( inotify_descriptor, directory.c_str( ), watch_mask );
+            if( watch >= 0 ) {
+                directories[directory] = Directory{ watch, 1 };
+                prefixes[watch] = prefix;
+            }
+        }
+    }
+  #endif
+    return( full_name );
+}
+
+
+//! Stops watching a file.
+/*!
+ * \param full_name The name returned by watch( ) when the file was watched.
+ */
+void FileWatcher::forget( const std::string &full_name )
+{
+  #if defined( USE_INOTIFY )
+    const std::string::size_type slash = full_name.rfind( '/' );
+    if( slash == std::string::npos ) return;
+    const std::string directory = full_name.substr( 0, slash == 0 ? 1 : slash );
+
+    std::map< std::string, Directory >::iterator p = directories.find( directory );
+    if( p != directories.end( )  &&  --p->second.users == 0 ) {
+        inotify_rm_watch( inotify_descriptor, p->second.watch );
+        prefixes.erase( p->second.watch );
+        directories.erase( p );
+    }
+  #else
+    (void)full_name;
+  #endif
+}
+
+
+//! Reads the events that have happened since the last call.
+/*!
+ * This function doesn't wait for events.
+ *
+ * \param events Receives the full names of the files changed and what happened to them. Files
+ * that were both written and closed are reported as CHANGED.
+ * \return false if some events were lost. In that case any file might have changed.
+ */
+bool FileWatcher::read_events( std::map< std::string, Event > &events )
+{
+    bool complete = true;
+  #if defined( USE_INOTIFY )
+    if( inotify_descriptor < 0 ) return true;
+
+    alignas( inotify_event ) char buffer[16 * 1024];
+    ssize_t count;
+    while( ( count = read( inotify_descriptor, buffer, sizeof( buffer ) ) ) > 0 ) {
+        const char *p = buffer;
+        while( p < buffer + count ) {
+            const inotify_event *const event = reinterpret_cast< const inotify_event * >( p );
+            p += sizeof( inotify_event ) + event->len;
+
+            if( event->mask & IN_Q_OVERFLOW ) {
+                complete = false;
+                continue;
+            }
+
+            // A directory that is deleted is no longer watched.
+            std::map< int, std::string >::iterator prefix = prefixes.find( event->wd );
+            if( prefix == prefixes.end( ) ) continue;
+            if( event->mask & IN_IGNORED ) {
+                directories.erase( prefix->second.size( ) > 1 ?
+                    prefix->second.substr( 0, prefix->second.size( ) - 1 ) : prefix->second );
+                prefixes.erase( prefix );
+                continue;
+            }
+            if( event->len == 0 ) continue;
+
+            // Any event but a write means the file is finished or replaced.
+            const std::string name = prefix->second + event->name;
+            Event &what = events.insert( std::make_pair( name, WRITING ) ).first->second;
+            if( !( event->mask & IN_MODIFY ) ) what = CHANGED;
+        }
+    }
+  #else
+    (void)events;
+  #endif
+    return( complete );
+}
@@ -0,0 +1,60 @@
+/*! \file    FileWatcher.hpp
+ *  \brief   Interface to class FileWatcher
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <map>
+#include <string>
+
+#include "environ.hpp"
+
+//! Notices when files are changed by other programs.
+/*!
+ * The directories holding the watched files are watched rather than the files themselves, so
+ * a file that is replaced (for example, by a program that saves by renaming a new file over the
+ * old one) is noticed as well as one that is written. Nothing is done while no files change.
+ * Instead descriptor( ) becomes readable when there are events to read; the main loop waits on
+ * it along with the keyboard.
+ *
+ * Watching requires inotify (Linux). Elsewhere descriptor( ) returns -1 and no events are ever
+ * reported.
+ */
+class FileWatcher {
+public:
+    //! What happened to a file.
+    enum Event {
+        WRITING,  //!< The file is being written. More changes are probably coming.
+        CHANGED   //!< The file was written and closed, or replaced.
+    };
+
+    FileWatcher( );
+   ~FileWatcher( );
+
+    //! Returns a descriptor that is readable when there are events, or -1 if there never are.
+    int descriptor( ) const
+        { return( inotify_descriptor ); }
+
+    std::string watch( const char *name );
+    void forget( const std::string &full_name );
+    bool read_events( std::map< std::string, Event > &events );
+
+private:
+    //! A watched directory.
+    struct Directory {
+        int watch;  //!< The inotify watch descriptor.
+        int users;  //!< The number of watched files in the directory.
+    };
+
+    int inotify_descriptor;                        //!< The inotify instance, or -1.
+    std::map< std::string, Directory > directories; //!< Watched directories by name.
+    std::map< int, std::string > prefixes;          //!< Directory names (with '/') by watch.
+
+    // Watchers can't be copied.
+    FileWatcher( const FileWatcher & ) = delete;
+    FileWatcher &operator=( const FileWatcher & ) = delete;
+};
+
+#endif
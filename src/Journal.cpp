@@ -0,0 +1,453 @@
+/*! \file    Journal.cpp
+ *  \brief   Implementation of class Journal
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include "environ.hpp"
+
+#if eOPSYS == ePOSIX
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "Journal.hpp"
+
+/*
+ * The journal file starts with a header: the four bytes of magic, the eight byte digest of the
+ * base version (least significant byte first), and the process ID of the Y that writes it.
+ * Records follow, each a letter followed by its fields. Numbers are written seven bits to a
+ * byte, least significant first, with the high bit set in all but the last byte. Text is its
+ * length followed by its characters.
+ *
+ *     S index text                 The line at index has the given text.
+ *     I index count text...        count lines with the given texts are inserted before index.
+ *     D index count                count lines starting at index are deleted.
+ *     C count                      The text has count lines. Written by each flush( ).
+ */
+
+namespace {
+
+    const char magic[] = { 'Y', 'J', 'Y', '1' };
+
+    //! The types of records.
+    enum Record : char {
+        SET        = 'S',
+        INSERT     = 'I',
+        DELETE     = 'D',
+        CHECKPOINT = 'C'
+    };
+
+    //! Reads the fields of a journal held in memory.
+    class Reader {
+    public:
+        Reader( const std::string &the_data ) : data( the_data ), offset( 0 ) { }
+
+        //! Returns true if all of the data has been read.
+        bool at_end( ) const
+            { return( offset == data.size( ) ); }
+
+        bool get_byte( char &byte );
+        bool get_number( std::uint64_t &number );
+        bool get_index( long &index );
+        bool get_text( const char *&text, std::size_t &length );
+
+    private:
+        const std::string &data;    //!< The contents of the journal.
+        std::size_t        offset;  //!< The offset of the next field.
+    };
+
+
+    bool Reader::get_byte( char &byte )
+    {
+        if( offset == data.size( ) ) return false;
+        byte = data[offset++];
+        return true;
+    }
+
+
+    bool Reader::get_number( std::uint64_t &number )
+    {
+        number = 0;
+        for( int shift = 0; shift < 64; shift += 7 ) {
+            char byte;
+            if( !get_byte( byte ) ) return false;
+            number |= static_cast< std::uint64_t >( byte & 0x7F ) << shift;
+            if( ( byte & 0x80 ) == 0 ) return true;
+        }
+        return false;
+    }
+
+
+    //! Reads a number that must be a line index or count.
+    bool Reader::get_index( long &index )
+    {
+        std::uint64_t number;
+        if( !get_number( number )  ||  number > static_cast< std::uint64_t >( LONG_MAX ) )
+            return false;
+        index = static_cast< long >( number );
+        return true;
+    }
+
+
+    bool Reader::get_text( const char *&text, std::size_t &length )
+    {
+        std::uint64_t number;
+        if( !get_number( number )  ||  number > data.size( ) - offset ) return false;
+        text   = data.data( ) + offset;
+        length = static_cast< std::size_t >( number );
+        offset += length;
+        return true;
+    }
+
+
+    //! Reads an entire file into a string.
+    bool read_file( const std::string &name, std::string &data )
+    {
+        std::FILE *const file = std::fopen( name.c_str( ), "rb" );
+        if( file == NULL ) return false;
+
+        char buffer[4096];
+        std::size_t count;
+        bool result = true;
+        try {
+            while( ( count = std::fread( buffer, 1, sizeof( buffer ), file ) ) > 0 ) {
+                data.append( buffer, count );
+            }
+        }
+        catch( std::bad_alloc & ) {
+            result = false;
+        }
+        if( std::ferror( file ) ) result = false;
+        std::fclose( file );
+        return result;
+    }
+
+
+    //! Reads the header of a journal.
+    bool get_header( Reader &reader, std::uint64_t &base_digest, long &owner )
+    {
+        for( char expected : magic ) {
+            char byte;
+            if( !reader.get_byte( byte )  ||  byte != expected ) return false;
+        }
+        base_digest = 0;
+        for( int i = 0; i < 8; ++i ) {
+            char byte;
+            if( !reader.get_byte( byte ) ) return false;
+            const std::uint64_t value = static_cast< unsigned char >( byte );
+            base_digest |= value << 8 * i;
+        }
+        return reader.get_index( owner );
+    }
+
+
+    //! Returns the ID of this process.
+    long this_process( )
+    {
+      #if eOPSYS == ePOSIX
+        return static_cast< long >( getpid( ) );
+      #else
+        return 0;
+      #endif
+    }
+
+}
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Records the text of the pending line and notes a new one.
+void Journal::note_line( long index, const EditBuffer *line )
+{
+    settle( );
+    pending_index = index;
+    pending_line  = line;
+}
+
+
+//! Records the text of the pending line, if there is one.
+void Journal::settle( )
+{
+    if( pending_line == NULL ) return;
+    output.push_back( SET );
+    put_number( pending_index );
+    put_text( *pending_line );
+    pending_line = NULL;
+}
+
+
+void Journal::put_number( std::uint64_t number )
+{
+    while( number >= 0x80 ) {
+        output.push_back( static_cast< char >( ( number & 0x7F ) | 0x80 ) );
+        number >>= 7;
+    }
+    output.push_back( static_cast< char >( number ) );
+}
+
+
+void Journal::put_text( const EditBuffer &line )
+{
+    const std::size_t length = line.length( );
+    put_number( length );
+    const std::size_t offset = output.size( );
+    output.resize( offset + length );
+    line.copy( &output[offset], length );
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+/*!
+ * Nothing is written until there is something to record.
+ *
+ * \param the_name The name of the journal file. See name_for( ).
+ * \param base_digest The digest of the base version. See digest( ).
+ */
+Journal::Journal( const std::string &the_name, std::uint64_t base_digest ) :
+    file_name    ( the_name ),
+    digest_value ( base_digest ),
+    file         ( NULL ),
+    pending_index( 0 ),
+    pending_line ( NULL )
+{ }
+
+
+//! Closes the journal file. The file is left in place; see remove( ).
+Journal::~Journal( )
+{
+    if( file != NULL ) std::fclose( file );
+}
+
+
+/*!
+ * Records that lines were inserted.
+ *
+ * \param index The index of the first line inserted.
+ * \param count The number of lines inserted.
+ * \param lines A list positioned at the first line inserted. It is advanced past the lines.
+ */
+void Journal::inserted( long index, long count, EditList &lines )
+{
+    settle( );
+    output.push_back( INSERT );
+    put_number( index );
+    put_number( count );
+    while( count-- > 0 ) put_text( *lines.next( ) );
+}
+
+
+/*!
+ * Records that lines were deleted. This must be done before the lines are deleted since one of
+ * them might be the pending line.
+ *
+ * \param index The index of the first line deleted.
+ * \param count The number of lines deleted.
+ */
+void Journal::deleted( long index, long count )
+{
+    settle( );
+    output.push_back( DELETE );
+    put_number( index );
+    put_number( count );
+}
+
+
+/*!
+ * Writes the operations recorded so far. The journal file is created by the first flush.
+ *
+ * \param line_count The number of lines in the text. It is recorded so that replay( ) can
+ * check that the journal is consistent.
+ * \return false if the journal couldn't be written. The operations are discarded in that case.
+ */
+bool Journal::flush( long line_count )
+{
+    if( !pending( ) ) return true;
+    settle( );
+    output.push_back( CHECKPOINT );
+    put_number( line_count );
+
+    // A new journal file starts with the header.
+    bool result = true;
+    if( file == NULL ) {
+        if( ( file = std::fopen( file_name.c_str( ), "wb" ) ) == NULL ) result = false;
+        else {
+            std::string records;
+            records.swap( output );
+            output.assign( magic, sizeof( magic ) );
+            for( int i = 0; i < 8; ++i ) {
+                output.push_back( static_cast< char >( digest_value >> 8 * i ) );
+            }
+            put_number( this_process( ) );
+            output.append( records );
+        }
+    }
+    if( result ) {
+        const std::size_t count = std::fwrite( output.data( ), 1, output.size( ), file );
+        if( count != output.size( )  ||  std::fflush( file ) != 0 ) result = false;
+    }
+    output.clear( );
+    return result;
+}
+
+
+//! Deletes the journal file. Operations recorded afterwards start a new one.
+void Journal::remove( )
+{
+    if( file != NULL ) {
+        std::fclose( file );
+        file = NULL;
+    }
+    std::remove( file_name.c_str( ) );
+    output.clear( );
+    pending_line = NULL;
+}
+
+
+/*!
+ * Returns the name of the journal of a file. The journal is in the same directory as the file.
+ * On POSIX systems it is hidden.
+ */
+std::string Journal::name_for( const char *file_name )
+{
+    std::string result( file_name );
+  #if eOPSYS == ePOSIX
+    const std::string::size_type slash = result.rfind( '/' );
+    result.insert( ( slash == std::string::npos ) ? 0 : slash + 1, 1, '.' );
+  #endif
+    result.append( ".yjy" );
+    return result;
+}
+
+
+//! Combines the hashes of the lines of a version of a file into a single value.
+std::uint64_t Journal::digest( const std::vector< std::uint64_t > &hashes )
+{
+    std::uint64_t result = hashes.size( );
+    for( std::uint64_t hash : hashes ) {
+        result = ( result ^ hash ) * 0x9e3779b97f4a7c15ULL;
+        result ^= result >> 29;
+    }
+    return result;
+}
+
+
+/*!
+ * Looks for a journal left by an earlier session.
+ *
+ * \param name The name of the journal file.
+ * \param in_use Set to true if the Y that wrote the journal is still running. That can only be
+ * known on POSIX systems.
+ * \return true if the journal exists.
+ */
+bool Journal::find( const std::string &name, bool &in_use )
+{
+    std::FILE *const file = std::fopen( name.c_str( ), "rb" );
+    if( file == NULL ) return false;
+
+    std::string header( sizeof( magic ) + 8 + 10, '\0' );
+    header.resize( std::fread( &header[0], 1, header.size( ), file ) );
+    std::fclose( file );
+
+    Reader reader( header );
+    std::uint64_t base_digest;
+    long owner = 0;
+    in_use = false;
+    if( get_header( reader, base_digest, owner ) ) {
+      #if eOPSYS == ePOSIX
+        in_use = ( owner != this_process( )  &&
+                   ( kill( static_cast< pid_t >( owner ), 0 ) == 0  ||  errno == EPERM ) );
+      #endif
+    }
+    return true;
+}
+
+
+/*!
+ * Makes the operations in a journal. An operation that was only partly written (because Y died
+ * while writing it) is ignored.
+ *
+ * \param name The name of the journal file.
+ * \param base_digest The digest of the text. It must match the digest in the journal.
+ * \param lines The text. It must be the base version of the journal.
+ * \return What was done.
+ * \throws std::bad_alloc if there is insufficient memory. Some operations might have been made.
+ */
+Journal::Status Journal::replay(
+    const std::string &name, std::uint64_t base_digest, EditList &lines )
+{
+    std::string data;
+    if( !read_file( name, data ) ) return MISSING;
+
+    Reader reader( data );
+    std::uint64_t journal_digest;
+    long owner;
+    if( !get_header( reader, journal_digest, owner ) ) return MISSING;
+    if( journal_digest != base_digest ) return MISMATCHED;
+
+    long size = lines.size( );
+    while( !reader.at_end( ) ) {
+        char type;
+        long index;
+        long count;
+        const char *text;
+        std::size_t length;
+
+        reader.get_byte( type );
+        switch( type ) {
+        case SET:
+            if( !reader.get_index( index )  ||  !reader.get_text( text, length ) ) return REPLAYED;
+            if( index >= size ) return DAMAGED;
+            lines.jump_to( index );
+            *lines.get( ) = EditBuffer( text, length );
+            break;
+
+        case INSERT: {
+            if( !reader.get_index( index )  ||  !reader.get_index( count ) ) return REPLAYED;
+            if( index > size ) return DAMAGED;
+
+            // Make the lines first in case the record is incomplete.
+            EditList inserted;
+            for( long i = 0; i < count; ++i ) {
+                if( !reader.get_text( text, length ) ) return REPLAYED;
+                inserted.insert( new EditBuffer( text, length ) );
+            }
+            lines.jump_to( index );
+            inserted.jump_to( 0 );
+            lines.splice( inserted, count );
+            size += count;
+            break;
+        }
+
+        case DELETE:
+            if( !reader.get_index( index )  ||  !reader.get_index( count ) ) return REPLAYED;
+            if( index > size  ||  count > size - index ) return DAMAGED;
+            lines.jump_to( index );
+            for( ; count > 0; --count ) {
+                delete lines.get( );
+                lines.erase( );
+                --size;
+            }
+            break;
+
+        case CHECKPOINT:
+            if( !reader.get_index( count ) ) return REPLAYED;
+            if( count != size ) return DAMAGED;
+            break;
+
+        default:
+            return DAMAGED;
+        }
+    }
+    return REPLAYED;
+}
@@ -0,0 +1,80 @@
+/*! \file    Journal.hpp
+ *  \brief   Interface to class Journal
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class EditBuffer;
+class EditList;
+
+//! Records the changes made to a file so they can be recovered if Y dies before saving them.
+/*!
+ * The journal is an append-only file (see name_for( )) holding the line operations that turn
+ * the file on disk, the base version, into the text being edited: lines given new text, lines
+ * inserted, and lines deleted. Line numbers are zero based and refer to the text as it was when
+ * each operation was made, so replaying the operations in order over the base version recreates
+ * the text. The journal's header holds a digest of the base version's lines so that a journal
+ * is never replayed over some other version of the file.
+ *
+ * Operations are added to a buffer in memory and written only by flush( ), which Y calls when
+ * the user pauses. Changes to a line are combined: the line is only noted until some other
+ * line is changed, and its text is taken then. Thus typing costs almost nothing.
+ */
+class Journal {
+public:
+    //! The result of replaying a journal.
+    enum Status {
+        REPLAYED,    //!< All of the operations were made.
+        DAMAGED,     //!< An invalid operation was found. The operations before it were made.
+        MISMATCHED,  //!< The journal is for some other version of the file. Nothing was done.
+        MISSING      //!< The journal couldn't be read. Nothing was done.
+    };
+
+    Journal( const std::string &the_name, std::uint64_t base_digest );
+   ~Journal( );
+
+    //! Notes that the text of a line changed. The line must exist until the journal is flushed.
+    void changed( long index, const EditBuffer *line )
+        { if( line != pending_line ) note_line( index, line ); }
+
+    void inserted( long index, long count, EditList &lines );
+    void deleted( long index, long count );
+
+    //! Returns true if there are operations that haven't been written.
+    bool pending( ) const
+        { return( pending_line != NULL  ||  !output.empty( ) ); }
+
+    bool flush( long line_count );
+    void remove( );
+
+    static std::string name_for( const char *file_name );
+    static std::uint64_t digest( const std::vector< std::uint64_t > &hashes );
+    static bool find( const std::string &name, bool &in_use );
+    static Status replay( const std::string &name, std::uint64_t base_digest, EditList &lines );
+
+private:
+    std::string       file_name;      //!< The name of the journal file.
+    std::uint64_t     digest_value;   //!< The digest of the base version.
+    std::FILE        *file;           //!< The journal file, or NULL if it hasn't been created.
+    std::string       output;         //!< Operations that haven't been written.
+    long              pending_index;  //!< The index of pending_line.
+    const EditBuffer *pending_line;   //!< A changed line whose text hasn't been recorded.
+
+    void note_line( long index, const EditBuffer *line );
+    void settle( );
+    void put_number( std::uint64_t number );
+    void put_text( const EditBuffer &line );
+
+    // Journals can't be copied.
+    Journal( const Journal & ) = delete;
+    Journal &operator=( const Journal & ) = delete;
+};
+
+#endif
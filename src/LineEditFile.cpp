@@ -50,6 +50,7 @@ bool LineEditFile::insert_line( const EditBuffer *new_line )
         memory_message( "Can't insert line into file" );
         return false;
     }
+    journal_insert( current_point.cursor_line( ), 1 );
     return true;
 }
 
@@ -66,6 +67,7 @@ bool LineEditFile::replace_line( const EditBuffer *new_line )
 
     // Make changes.
     is_changed = true;
+    journal_delete( current_point.cursor_line( ), 1 );
     delete file_data.get( );
     file_data.erase( );
 
@@ -74,6 +76,7 @@ bool LineEditFile::replace_line( const EditBuffer *new_line )
         memory_message( "Can't insert line into file" );
         return false;
     }
+    journal_insert( current_point.cursor_line( ), 1 );
     return true;
 }
 
@@ -89,6 +92,7 @@ void LineEditFile::delete_line( )
 
     // Make changes.
     is_changed = true;
+    journal_delete( current_point.cursor_line( ), 1 );
     delete file_data.get( );
     file_data.erase( );
 }
@@ -115,6 +119,7 @@ void LineEditFile::delete_to_EOL( )
         while( file_data.get( )->length( ) > current_point.cursor_column( ) ) {
             is_changed = true;
             file_data.get( )->erase( current_point.cursor_column( ) );
+            journal_change( file_data.current_index( ), file_data.get( ) );
         }
 
         file_data.next( );
@@ -0,0 +1,720 @@
+/*! \file    RegularExpression.cpp
+ *  \brief   Implementation of class RegularExpression
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+
+#include "RegularExpression.hpp"
+
+namespace {
+
+    const std::size_t npos = static_cast< std::size_t >( -1 );
+
+    //! The largest count allowed in r{m,n}.
+    const long largest_count = 1000;
+
+    //! The largest number of nondeterministic states allowed.
+    const std::size_t largest_automaton = 50000;
+
+    //! The most deterministic states kept. When there are more they are discarded and made again.
+    const std::size_t largest_cache = 4096;
+
+}
+
+/*=======================================*/
+/*           class Parser                */
+/*=======================================*/
+
+//! Parses an expression and makes its nondeterministic automaton.
+/*!
+ * The expression is first parsed into a tree. The automaton is made from the tree once for
+ * each direction. Repetitions such as r{2,3} refer to the tree for r several times; each
+ * reference makes its own states.
+ */
+class RegularExpression::Parser {
+public:
+    Parser( RegularExpression &the_expression, const std::string &the_pattern ) :
+        expression( the_expression ), pattern( the_pattern ), position( 0 ), error( NULL ) { }
+
+    const char *parse( );
+
+private:
+    //! A node of the tree.
+    struct Node {
+        enum Kind { EMPTY, BYTES, CONCATENATE, ALTERNATE, STAR, PLUS, OPTIONAL };
+        Kind kind;
+        int  set;    //!< For BYTES, the index in sets of the characters matched.
+        int  left;   //!< The first (or only) subexpression.
+        int  right;  //!< The second subexpression.
+    };
+
+    RegularExpression &expression;  //!< The expression being made.
+    const std::string &pattern;     //!< The text of the expression.
+    std::size_t        position;    //!< The offset of the next character of the pattern.
+    const char        *error;       //!< What is wrong with the pattern, or NULL.
+    std::vector< Node > nodes;      //!< The tree.
+
+    bool at_end( ) const
+        { return( position == pattern.size( ) ); }
+
+    int  node( Node::Kind kind, int left = -1, int right = -1 );
+    int  bytes( const std::bitset< 256 > &set );
+    int  alternation( );
+    int  concatenation( );
+    int  repetition( );
+    int  atom( );
+    bool count( long &minimum, long &maximum );
+    bool escape( char letter, std::bitset< 256 > &set );
+    int  bracket( );
+    bool nullable( int index ) const;
+    int  build( int index, int next, bool reversed );
+    int  state( State::Kind kind, int set, int out, int other );
+};
+
+
+int RegularExpression::Parser::node( Node::Kind kind, int left, int right )
+{
+    nodes.push_back( Node{ kind, -1, left, right } );
+    return( static_cast< int >( nodes.size( ) ) - 1 );
+}
+
+
+int RegularExpression::Parser::bytes( const std::bitset< 256 > &set )
+{
+    expression.sets.push_back( set );
+    const int result = node( Node::BYTES );
+    nodes[result].set = static_cast< int >( expression.sets.size( ) ) - 1;
+    return( result );
+}
+
+
+//! Parses r|s|... Returns -1 if there is an error.
+int RegularExpression::Parser::alternation( )
+{
+    int result = concatenation( );
+    while( result >= 0  &&  !at_end( )  &&  pattern[position] == '|' ) {
+        ++position;
+        const int right = concatenation( );
+        if( right < 0 ) return( -1 );
+        result = node( Node::ALTERNATE, result, right );
+    }
+    return( result );
+}
+
+
+//! Parses rs... up to the end of the enclosing group. Returns -1 if there is an error.
+int RegularExpression::Parser::concatenation( )
+{
+    int result = -1;
+    while( !at_end( )  &&  pattern[position] != '|'  &&  pattern[position] != ')' ) {
+        const int item = repetition( );
+        if( item < 0 ) return( -1 );
+        result = ( result < 0 ) ? item : node( Node::CONCATENATE, result, item );
+    }
+    return( result < 0 ? node( Node::EMPTY ) : result );
+}
+
+
+//! Parses an atom followed by any number of repetition operators.
+int RegularExpression::Parser::repetition( )
+{
+    int result = atom( );
+    while( result >= 0  &&  !at_end( ) ) {
+        const char letter = pattern[position];
+        long minimum;
+        long maximum;
+
+        if     ( letter == '*' ) { ++position; result = node( Node::STAR, result ); }
+        else if( letter == '+' ) { ++position; result = node( Node::PLUS, result ); }
+        else if( letter == '?' ) { ++position; result = node( Node::OPTIONAL, result ); }
+        else if( letter == '{'  &&  count( minimum, maximum ) ) {
+            if( error != NULL ) return( -1 );
+
+            // Make the required copies followed by the optional ones.
+            const int item = result;
+            result = node( Node::EMPTY );
+            for( long i = 0; i < minimum; ++i ) {
+                result = node( Node::CONCATENATE, result, item );
+            }
+            if( maximum < 0 ) {
+                result = node( Node::CONCATENATE, result, node( Node::STAR, item ) );
+            }
+            for( long i = minimum; i < maximum; ++i ) {
+                result = node( Node::CONCATENATE, result, node( Node::OPTIONAL, item ) );
+            }
+        }
+        else break;
+    }
+    return( result );
+}
+
+
+/*!
+ * Parses {m}, {m,} or {m,n}. If the text at the current position isn't one of those, nothing
+ * is done and false is returned; the brace is then an ordinary character.
+ *
+ * \param minimum Set to m.
+ * \param maximum Set to n, or -1 if there is no limit.
+ */
+bool RegularExpression::Parser::count( long &minimum, long &maximum )
+{
+    std::size_t next = position + 1;
+    auto digit = [&]( ) {
+        return( next < pattern.size( )  &&
+                std::isdigit( static_cast< unsigned char >( pattern[next] ) ) );
+    };
+    auto number = [&]( long &value ) {
+        if( !digit( ) ) return false;
+        value = 0;
+        while( digit( ) ) {
+            if( value <= largest_count ) value = 10 * value + ( pattern[next] - '0' );
+            ++next;
+        }
+        return true;
+    };
+
+    if( !number( minimum ) ) return false;
+    maximum = minimum;
+    if( next < pattern.size( )  &&  pattern[next] == ',' ) {
+        ++next;
+        if( !number( maximum ) ) maximum = -1;
+    }
+    if( next == pattern.size( )  ||  pattern[next] != '}' ) return false;
+    position = next + 1;
+
+    if( minimum > largest_count  ||  maximum > largest_count ) error = "Count is too large";
+    else if( maximum >= 0  &&  maximum < minimum ) error = "Invalid count";
+    return true;
+}
+
+
+//! Parses a single character, a group, or a set of characters.
+int RegularExpression::Parser::atom( )
+{
+    std::bitset< 256 > set;
+    const char letter = pattern[position++];
+    switch( letter ) {
+    case '(': {
+        const int result = alternation( );
+        if( result < 0 ) return( -1 );
+        if( at_end( ) ) {
+            error = "Missing )";
+            return( -1 );
+        }
+        ++position;
+        return( result );
+    }
+
+    case '*':
+    case '+':
+    case '?':
+        error = "Nothing to repeat";
+        return( -1 );
+
+    case '[':
+        return( bracket( ) );
+
+    case '.':
+        set.set( );
+        return( bytes( set ) );
+
+    case '\\':
+        if( at_end( ) ) {
+            error = "Missing character after \\";
+            return( -1 );
+        }
+        if( !escape( pattern[position], set ) ) {
+            set.set( static_cast< unsigned char >( pattern[position] ) );
+        }
+        ++position;
+        return( bytes( set ) );
+
+    default:
+        set.set( static_cast< unsigned char >( letter ) );
+        return( bytes( set ) );
+    }
+}
+
+
+/*!
+ * Adds the characters matched by an escape such as \d to a set.
+ *
+ * \return false if the escape isn't a special one. It then means the letter itself.
+ */
+bool RegularExpression::Parser::escape( const char letter, std::bitset< 256 > &set )
+{
+    std::bitset< 256 > members;
+    switch( std::tolower( static_cast< unsigned char >( letter ) ) ) {
+    case 'd':
+        for( int ch = '0'; ch <= '9'; ++ch ) members.set( ch );
+        break;
+    case 'w':
+        for( int ch = 0; ch < 256; ++ch ) {
+            if( ch < 128  &&  ( std::isalnum( ch )  ||  ch == '_' ) ) members.set( ch );
+        }
+        break;
+    case 's':
+        members.set( ' ' );
+        members.set( '\t' );
+        break;
+    case 't':
+        if( letter == 'T' ) return false;
+        set.set( '\t' );
+        return true;
+    default:
+        return false;
+    }
+    if( std::isupper( static_cast< unsigned char >( letter ) ) ) members.flip( );
+    set |= members;
+    return true;
+}
+
+
+//! Parses a set of characters such as [a-z_]. The opening bracket has been consumed.
+int RegularExpression::Parser::bracket( )
+{
+    std::bitset< 256 > set;
+    bool negated = false;
+    if( !at_end( )  &&  pattern[position] == '^' ) {
+        negated = true;
+        ++position;
+    }
+
+    bool first = true;
+    while( !at_end( )  &&  ( first  ||  pattern[position] != ']' ) ) {
+        first = false;
+        unsigned char low = static_cast< unsigned char >( pattern[position++] );
+        if( low == '\\'  &&  !at_end( ) ) {
+            if( escape( pattern[position++], set ) ) continue;
+            low = static_cast< unsigned char >( pattern[position - 1] );
+        }
+
+        // A range, unless the dash is the last character of the set.
+        unsigned char high = low;
+        if( position + 1 < pattern.size( )  &&
+            pattern[position] == '-'  &&  pattern[position + 1] != ']' ) {
+            high = static_cast< unsigned char >( pattern[position + 1] );
+            position += 2;
+            if( high == '\\'  &&  !at_end( ) ) {
+                high = static_cast< unsigned char >( pattern[position++] );
+            }
+            if( high < low ) {
+                error = "Invalid range";
+                return( -1 );
+            }
+        }
+        for( int ch = low; ch <= high; ++ch ) set.set( ch );
+    }
+    if( at_end( ) ) {
+        error = "Missing ]";
+        return( -1 );
+    }
+    ++position;
+    if( negated ) set.flip( );
+    return( bytes( set ) );
+}
+
+
+//! Returns true if a subexpression matches empty text.
+bool RegularExpression::Parser::nullable( const int index ) const
+{
+    const Node &item = nodes[index];
+    switch( item.kind ) {
+    case Node::EMPTY:       return true;
+    case Node::BYTES:       return false;
+    case Node::CONCATENATE: return( nullable( item.left )  &&  nullable( item.right ) );
+    case Node::ALTERNATE:   return( nullable( item.left )  ||  nullable( item.right ) );
+    case Node::STAR:        return true;
+    case Node::PLUS:        return( nullable( item.left ) );
+    case Node::OPTIONAL:    return true;
+    }
+    return false;
+}
+
+
+int RegularExpression::Parser::state( State::Kind kind, int set, int out, int other )
+{
+    expression.states.push_back( State{ kind, set, out, other } );
+    return( static_cast< int >( expression.states.size( ) ) - 1 );
+}
+
+
+/*!
+ * Makes the states for a subexpression. The states are made from the end back to the start so
+ * each state's successor is known when it is made.
+ *
+ * \param index The subexpression.
+ * \param next The state that follows the subexpression.
+ * \param reversed True to make the states that match the reversed subexpression.
+ * \return The first state of the subexpression, or -1 if there are too many states.
+ */
+int RegularExpression::Parser::build( const int index, const int next, const bool reversed )
+{
+    if( next < 0  ||  expression.states.size( ) > largest_automaton ) return( -1 );
+
+    const Node item = nodes[index];
+    switch( item.kind ) {
+    case Node::EMPTY:
+        return( next );
+
+    case Node::BYTES:
+        return( state( State::BYTES, item.set, next, -1 ) );
+
+    case Node::CONCATENATE:
+        if( reversed ) return( build( item.right, build( item.left, next, reversed ), reversed ) );
+        return( build( item.left, build( item.right, next, reversed ), reversed ) );
+
+    case Node::ALTERNATE: {
+        const int left = build( item.left, next, reversed );
+        const int right = build( item.right, next, reversed );
+        if( left < 0  ||  right < 0 ) return( -1 );
+        return( state( State::SPLIT, -1, left, right ) );
+    }
+
+    case Node::STAR:
+    case Node::PLUS: {
+        const int loop = state( State::SPLIT, -1, -1, next );
+        const int body = build( item.left, loop, reversed );
+        if( body < 0 ) return( -1 );
+        expression.states[loop].out = body;
+        return( item.kind == Node::STAR ? loop : body );
+    }
+
+    case Node::OPTIONAL: {
+        const int body = build( item.left, next, reversed );
+        if( body < 0 ) return( -1 );
+        return( state( State::SPLIT, -1, body, next ) );
+    }
+    }
+    return( -1 );
+}
+
+
+//! Parses the pattern and makes the automata. Returns what is wrong, or NULL.
+const char *RegularExpression::Parser::parse( )
+{
+    const int root = alternation( );
+    if( error != NULL ) return( error );
+    if( root < 0  ||  !at_end( ) ) return( "Unmatched )" );
+    if( nullable( root ) ) return( "The expression matches empty text" );
+
+    const int forward_start = build( root, state( State::MATCH, -1, -1, -1 ), false );
+    const int backward_start = build( root, state( State::MATCH, -1, -1, -1 ), true );
+    if( forward_start < 0  ||  backward_start < 0 ) return( "The expression is too complex" );
+
+    // Characters that are in the same sets behave the same way. Divide the characters into
+    // classes of such characters so the deterministic automata need one transition per class.
+    std::fill( expression.classes, expression.classes + 256, 0 );
+    int count = 1;
+    for( const std::bitset< 256 > &set : expression.sets ) {
+        std::vector< int > renumber( 2 * count, -1 );
+        int new_count = 0;
+        for( int ch = 0; ch < 256; ++ch ) {
+            int &number = renumber[2 * expression.classes[ch] + set[ch]];
+            if( number < 0 ) number = new_count++;
+            expression.classes[ch] = static_cast< unsigned char >( number );
+        }
+        count = new_count;
+    }
+    expression.class_count = count;
+    expression.representative.assign( count, 0 );
+    for( int ch = 255; ch >= 0; --ch ) {
+        expression.representative[expression.classes[ch]] = static_cast< unsigned char >( ch );
+    }
+
+    expression.forward.initialize( &expression, forward_start, false );
+    expression.backward.initialize( &expression, backward_start, !expression.end_anchored );
+    return( NULL );
+}
+
+/*=======================================*/
+/*           class Automaton             */
+/*=======================================*/
+
+RegularExpression::Automaton::Automaton( ) :
+    expression( NULL ), start_state( -1 ), floating( false ), initial( -1 ), generation( 0 )
+{ }
+
+
+/*!
+ * \param owner The expression whose states the automaton uses.
+ * \param start The initial nondeterministic state.
+ * \param is_floating True if a match can start at any character (the automaton looks for the
+ * expression anywhere, not only at the start of the text).
+ */
+void RegularExpression::Automaton::initialize(
+    const RegularExpression *owner, const int start, const bool is_floating )
+{
+    expression  = owner;
+    start_state = start;
+    floating    = is_floating;
+    marks.assign( expression->states.size( ), 0 );
+    clear( );
+}
+
+
+//! Discards all states except the dead state, which is state zero.
+void RegularExpression::Automaton::clear( )
+{
+    state_sets.clear( );
+    transitions.clear( );
+    accepting_states.clear( );
+    known.clear( );
+    initial = -1;
+
+    std::vector< int > empty;
+    find( empty );
+}
+
+
+//! Finds the state for a set of nondeterministic states, making it if necessary.
+int RegularExpression::Automaton::find( std::vector< int > &set )
+{
+    std::sort( set.begin( ), set.end( ) );
+    const auto existing = known.find( set );
+    if( existing != known.end( ) ) return( existing->second );
+
+    const int result = static_cast< int >( state_sets.size( ) );
+    bool accepts = false;
+    for( int member : set ) {
+        if( expression->states[member].kind == State::MATCH ) accepts = true;
+    }
+    known.emplace( set, result );
+    state_sets.push_back( set );
+    accepting_states.push_back( accepts );
+
+    // The dead state stays dead.
+    transitions.resize( transitions.size( ) + expression->class_count, result == 0 ? 0 : -1 );
+    return( result );
+}
+
+
+//! Adds a state and the states that can be reached from it without consuming characters.
+void RegularExpression::Automaton::add( std::vector< int > &set, const int state )
+{
+    std::vector< int > pending( 1, state );
+    while( !pending.empty( ) ) {
+        const int next = pending.back( );
+        pending.pop_back( );
+        if( marks[next] == generation ) continue;
+        marks[next] = generation;
+
+        const State &item = expression->states[next];
+        if( item.kind == State::SPLIT ) {
+            pending.push_back( item.other );
+            pending.push_back( item.out );
+        }
+        else set.push_back( next );
+    }
+}
+
+
+//! Returns the initial state.
+int RegularExpression::Automaton::start( )
+{
+    if( initial < 0 ) {
+        std::vector< int > set;
+        ++generation;
+        add( set, start_state );
+        initial = find( set );
+    }
+    return( initial );
+}
+
+
+//! Makes the transition out of a state for a class of characters.
+int RegularExpression::Automaton::make_transition( int state, const int byte_class )
+{
+    // If there are too many states, start over. Only the states in use now are kept.
+    if( state_sets.size( ) >= largest_cache ) {
+        std::vector< int > current( state_sets[state] );
+        clear( );
+        state = find( current );
+    }
+
+    const unsigned char ch = expression->representative[byte_class];
+    std::vector< int > set;
+    ++generation;
+    for( int member : state_sets[state] ) {
+        const State &item = expression->states[member];
+        if( item.kind == State::BYTES  &&  expression->sets[item.set][ch] ) add( set, item.out );
+    }
+    if( floating ) add( set, start_state );
+
+    const int result = find( set );
+    transitions[state * expression->class_count + byte_class] = result;
+    return( result );
+}
+
+
+//! Returns the state after consuming a character.
+inline int RegularExpression::Automaton::step( const int state, const unsigned char ch )
+{
+    const int byte_class = expression->classes[ch];
+    const int next = transitions[state * expression->class_count + byte_class];
+    return( next >= 0 ? next : make_transition( state, byte_class ) );
+}
+
+/*=======================================*/
+/*           class RegularExpression     */
+/*=======================================*/
+
+/*!
+ * Scans the text backwards from its end, noting the offsets where matches start.
+ *
+ * \param start The offset where the scan stops.
+ * \param limit Offsets at or after the limit are not noted.
+ * \param nearest True to stop at the first offset noted (the last before the limit). Otherwise
+ * the scan continues to find the first offset.
+ * \return The offset found, or npos if there is none.
+ */
+std::size_t RegularExpression::find_start(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t start, const std::size_t limit, const bool nearest ) const
+{
+    std::size_t found = npos;
+    int state = backward.start( );
+    std::size_t i = first_length + second_length;
+    for( ; i > first_length  &&  i > start; --i ) {
+        const char ch = second[i - first_length - 1];
+        state = backward.step( state, static_cast< unsigned char >( ch ) );
+        if( Automaton::dead( state ) ) return( found );
+        if( backward.accepting( state )  &&  i - 1 < limit ) {
+            found = i - 1;
+            if( nearest ) return( found );
+        }
+    }
+    for( ; i > start; --i ) {
+        state = backward.step( state, static_cast< unsigned char >( first[i - 1] ) );
+        if( Automaton::dead( state ) ) return( found );
+        if( backward.accepting( state )  &&  i - 1 < limit ) {
+            found = i - 1;
+            if( nearest ) return( found );
+        }
+    }
+    return( found );
+}
+
+
+//! Returns the end of the longest match that starts at a given offset, or npos if there is none.
+std::size_t RegularExpression::longest(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t start ) const
+{
+    std::size_t result = npos;
+    int state = forward.start( );
+    for( std::size_t i = start; i < first_length; ++i ) {
+        state = forward.step( state, static_cast< unsigned char >( first[i] ) );
+        if( Automaton::dead( state ) ) return( result );
+        if( forward.accepting( state ) ) result = i + 1;
+    }
+    const std::size_t second_start = ( start > first_length ) ? start - first_length : 0;
+    for( std::size_t i = second_start; i < second_length; ++i ) {
+        state = forward.step( state, static_cast< unsigned char >( second[i] ) );
+        if( Automaton::dead( state ) ) return( result );
+        if( forward.accepting( state ) ) result = first_length + i + 1;
+    }
+    return( result );
+}
+
+
+//! Finds the longest match that starts at a given offset (which may be npos, for no match).
+bool RegularExpression::match(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t start, std::size_t &match_start, std::size_t &match_length ) const
+{
+    if( start == npos ) return false;
+    const std::size_t end = longest( first, first_length, second, second_length, start );
+    if( end == npos  ||  ( end_anchored  &&  end != first_length + second_length ) ) return false;
+    match_start  = start;
+    match_length = end - start;
+    return true;
+}
+
+
+/*!
+ * \param pattern The expression. If it is invalid the object can't be used to search; see
+ * error( ).
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+RegularExpression::RegularExpression( const std::string &pattern ) :
+    error_message ( NULL ),
+    start_anchored( false ),
+    end_anchored  ( false ),
+    class_count   ( 1 )
+{
+    std::string body( pattern );
+    if( !body.empty( )  &&  body[0] == '^' ) {
+        start_anchored = true;
+        body.erase( 0, 1 );
+    }
+
+    // A $ at the end is an anchor unless it is escaped by an odd number of backslashes.
+    if( !body.empty( )  &&  body.back( ) == '$' ) {
+        std::size_t backslashes = 0;
+        while( backslashes + 1 < body.size( )  &&  body[body.size( ) - 2 - backslashes] == '\\' )
+            ++backslashes;
+        if( backslashes % 2 == 0 ) {
+            end_anchored = true;
+            body.pop_back( );
+        }
+    }
+
+    Parser parser( *this, body );
+    error_message = parser.parse( );
+}
+
+
+/*!
+ * Finds the leftmost longest match in some text. The text is given in two pieces, which are
+ * searched as if they were one, so that text stored with a gap needn't be copied.
+ *
+ * \param first The first piece of the text.
+ * \param first_length The number of characters in the first piece.
+ * \param second The second piece of the text.
+ * \param second_length The number of characters in the second piece.
+ * \param start The offset where the search starts. Matches that start before it are ignored.
+ * \param match_start Set to the offset of the match.
+ * \param match_length Set to the length of the match.
+ * \return true if a match was found.
+ */
+bool RegularExpression::search(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t start, std::size_t &match_start, std::size_t &match_length ) const
+{
+    const std::size_t length = first_length + second_length;
+    if( error_message != NULL  ||  start > length ) return false;
+
+    std::size_t found = npos;
+    if( start_anchored ) {
+        if( start == 0 ) found = 0;
+    }
+    else found = find_start( first, first_length, second, second_length, start, npos, false );
+    return( match( first, first_length, second, second_length, found, match_start, match_length ) );
+}
+
+
+/*!
+ * Finds the match that starts last before a given offset, and of the matches starting there the
+ * longest. The match may extend past the offset. The parameters are as for search( ).
+ *
+ * \param end The offset where the search starts. Only matches that start before it are found.
+ */
+bool RegularExpression::search_backward(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t end, std::size_t &match_start, std::size_t &match_length ) const
+{
+    if( error_message != NULL  ||  end == 0 ) return false;
+
+    std::size_t found = npos;
+    if( start_anchored ) found = 0;
+    else found = find_start( first, first_length, second, second_length, 0, end, true );
+    return( match( first, first_length, second, second_length, found, match_start, match_length ) );
+}
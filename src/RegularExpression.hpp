@@ -0,0 +1,141 @@
+/*! \file    RegularExpression.hpp
+ *  \brief   Interface to class RegularExpression
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef REGULAREXPRESSION_HPP
+#define REGULAREXPRESSION_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+//! A regular expression compiled for searching text.
+/*!
+ * The expression is compiled to a nondeterministic automaton (Thompson's construction). Text is
+ * searched with deterministic automata whose states are sets of the nondeterministic states.
+ * They are made lazily, as the text needs them, and are kept so that later searches can reuse
+ * them. Nothing ever backtracks, so searching takes time proportional to the length of the text
+ * whatever the expression.
+ *
+ * The leftmost match is found, and of the matches starting there the longest. To find it the
+ * text is scanned backwards with an automaton for the reversed expression, which notes every
+ * place a match starts, and then forwards from the leftmost such place. Searching backwards
+ * uses the same scan but stops at the first place noted.
+ *
+ * The syntax is the usual one:
+ *
+ *     c          The character c unless it is one of the special characters below.
+ *     \c         The character c even if it is special.
+ *     .          Any character.
+ *     [abc]      Any of the listed characters. Ranges such as a-z are allowed. [^abc] is any
+ *                character not listed.
+ *     \d \w \s   A digit, a word character (letter, digit or underscore), or a space or tab.
+ *                \D \W and \S are the other characters. These can also be used in brackets.
+ *     \t         A tab.
+ *     (r)        The expression r.
+ *     r*  r+  r? Zero or more, one or more, or zero or one r.
+ *     r{m} r{m,} r{m,n}
+ *                Exactly m, at least m, or from m to n r.
+ *     rs         r followed by s.
+ *     r|s        r or s.
+ *     ^  $       At the start of the expression, the start of the line. At the end, the end
+ *                of the line. Elsewhere they are ordinary characters.
+ *
+ * Expressions that match empty text are not allowed since they would match everywhere.
+ *
+ * Searching changes the automata so a RegularExpression must only be used by one thread at a
+ * time.
+ */
+class RegularExpression {
+public:
+    explicit RegularExpression( const std::string &pattern );
+
+    //! Returns a description of what is wrong with the expression, or NULL if nothing is.
+    const char *error( ) const
+        { return( error_message ); }
+
+    bool search( const char *first, std::size_t first_length,
+                 const char *second, std::size_t second_length,
+                 std::size_t start, std::size_t &match_start, std::size_t &match_length ) const;
+    bool search_backward(
+        const char *first, std::size_t first_length, const char *second, std::size_t second_length,
+        std::size_t end, std::size_t &match_start, std::size_t &match_length ) const;
+
+private:
+    //! A state of the nondeterministic automaton.
+    struct State {
+        enum Kind { BYTES, SPLIT, MATCH };
+        Kind kind;
+        int  set;    //!< For BYTES, the index in sets of the characters that can be consumed.
+        int  out;    //!< The next state.
+        int  other;  //!< For SPLIT, the other next state.
+    };
+
+    //! A deterministic automaton made as it is used.
+    class Automaton {
+    public:
+        Automaton( );
+        void initialize( const RegularExpression *owner, int start, bool floating );
+
+        int start( );
+        int step( int state, unsigned char ch );
+
+        //! Returns true if the state has seen a match.
+        bool accepting( int state ) const
+            { return( accepting_states[state] ); }
+
+        //! Returns true if no match can follow the state.
+        static bool dead( int state )
+            { return( state == 0 ); }
+
+    private:
+        const RegularExpression *expression;  //!< The expression the automaton recognizes.
+        int   start_state;                    //!< The initial nondeterministic state.
+        bool  floating;                       //!< True if matches can start anywhere.
+        int   initial;                        //!< The initial state, or -1 if not yet made.
+        std::vector< std::vector< int > > state_sets;        //!< The states of each state.
+        std::vector< int >                transitions;       //!< -1 for those not yet made.
+        std::vector< char >               accepting_states;  //!< True for accepting states.
+        std::map< std::vector< int >, int > known;           //!< Finds states by their sets.
+        std::vector< unsigned >           marks;             //!< Used by add( ).
+        unsigned                          generation;        //!< The current mark.
+
+        void clear( );
+        int  find( std::vector< int > &set );
+        void add( std::vector< int > &set, int state );
+        int  make_transition( int state, int byte_class );
+    };
+
+    const char *error_message;                   //!< What is wrong, or NULL.
+    bool  start_anchored;                        //!< True if matches must start the line.
+    bool  end_anchored;                          //!< True if matches must end the line.
+    std::vector< State > states;                 //!< The nondeterministic automaton.
+    std::vector< std::bitset< 256 > > sets;      //!< The character sets of BYTES states.
+    unsigned char classes[256];                  //!< The class of each character.
+    int   class_count;                           //!< The number of classes.
+    std::vector< unsigned char > representative; //!< A character in each class.
+
+    mutable Automaton forward;    //!< Finds the end of a match from its start.
+    mutable Automaton backward;   //!< Finds where matches start.
+
+    class Parser;
+
+    std::size_t find_start( const char *first, std::size_t first_length,
+                            const char *second, std::size_t second_length,
+                            std::size_t start, std::size_t limit, bool nearest ) const;
+    std::size_t longest( const char *first, std::size_t first_length,
+                         const char *second, std::size_t second_length,
+                         std::size_t start ) const;
+    bool match( const char *first, std::size_t first_length,
+                const char *second, std::size_t second_length,
+                std::size_t start, std::size_t &match_start, std::size_t &match_length ) const;
+
+    // RegularExpressions can't be copied (the automata refer to the expression).
+    RegularExpression( const RegularExpression & ) = delete;
+    RegularExpression &operator=( const RegularExpression & ) = delete;
+};
+
+#endif
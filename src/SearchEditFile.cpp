@@ -3,58 +3,114 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cstring>
+#include <cstddef>
 
 #include "EditBuffer.hpp"
 #include "SearchEditFile.hpp"
 
 
 /*!
- * Search from the current point forward in the file's data looking for the first occurrence of
- * search_string. If the current point is already on the start of a valid copy of the search
- * string, the search stops at once and the current point is not moved.
+ * Search from the current point forward in the file's data looking for the first match of a
+ * pattern. If the current point is already on the start of a valid copy of the search
+ * string, the search stops at once and the current point is not moved. The lines are searched
+ * where they are stored; nothing is copied.
  *
- *
- * \param search_string The string being searched for. The string must be contained entirely on
- * a single line to be considered found on that line.
+ * \param pattern The string being searched for. The string must be contained entirely on a
+ * single line to be considered found on that line.
  * \return True if an occurrence of the search string is found, otherwise return false. If an
  * occurrence is found the current point is moved to the start of that occurrence.
  */
-bool SearchEditFile::simple_search( const char *search_string )
+bool SearchEditFile::simple_search( const SearchPattern &pattern )
+{
+    std::size_t match_length;
+    return( simple_search( pattern, match_length ) );
+}
+
+
+/*!
+ * As above, and also returns the length of the match. Matches of a regular expression vary in
+ * length.
+ *
+ * \param pattern The string or expression being searched for.
+ * \param match_length Set to the length of the match, if one is found.
+ */
+bool SearchEditFile::simple_search( const SearchPattern &pattern, std::size_t &match_length )
 {
-    const char *found_string;    // Points at copy of string inside a line.
-    bool        found = false;   // =true if the string is found.
+    const EditBuffer *line;    // The line being searched.
+    std::size_t       offset;  // The offset of the string in the line.
 
     // Check the current line (if there is one).
     file_data.jump_to( current_point.cursor_line( ) );
-    if( file_data.get( ) != NULL ) {
+    if( ( line = file_data.get( ) ) != NULL ) {
 
-        // If the current point on the text of a line, check the partial line.
-        if( current_point.cursor_column( ) < file_data.get( )->length( ) ) {
-            std::string line = file_data.get( )->to_string( );
-
-            // If we've found it already, jump to it and set found.
-            if( ( found_string = std::strstr( line.c_str( ) + current_point.cursor_column( ),
-                    search_string ) ) != NULL ) {
-                found = true;
-                current_point.jump_to_column( found_string - line.c_str( ) );
+        // If the current point on the text of a line, check the partial line. If we've found it
+        // already, jump to it.
+        if( current_point.cursor_column( ) < line->length( ) ) {
+            offset = line->find( pattern, current_point.cursor_column( ), match_length );
+            if( offset != SearchPattern::npos ) {
+                current_point.jump_to_column( offset );
+                return true;
             }
         }
     }
 
-    // Check all other lines in the object if we haven't already found it.
-    if( found == false ) {
+    // Check all other lines in the object.
+    for( file_data.next( ); ( line = file_data.get( ) ) != NULL; file_data.next( ) ) {
+        if( ( offset = line->find( pattern, 0, match_length ) ) != SearchPattern::npos ) {
+            current_point.jump_to_line( file_data.current_index( ) );
+            current_point.jump_to_column( offset );
+            return true;
+        }
+    }
+    return false;
+}
 
-        for( file_data.next( ); file_data.get( ) != NULL; file_data.next( ) ) {
-            std::string line = file_data.get( )->to_string( );
-            if( ( found_string = std::strstr( line.c_str( ), search_string ) ) != NULL) {
-                found = true;
-                current_point.jump_to_line( file_data.current_index( ) );
-                current_point.jump_to_column( found_string - line.c_str( ) );
-                break;
-            }
+
+/*!
+ * Search from the current point backward in the file's data looking for the nearest match of a
+ * pattern that starts before the current point. Lines are examined from the current line
+ * upward, each from its end, so the time taken depends on how far back the match is. Nothing
+ * is copied.
+ *
+ * \param pattern The string or expression being searched for.
+ * \return True if a match is found. The current point is then moved to its start.
+ */
+bool SearchEditFile::reverse_search( const SearchPattern &pattern )
+{
+    std::size_t match_length;
+    return( reverse_search( pattern, match_length ) );
+}
+
+
+/*!
+ * As above, and also returns the length of the match.
+ *
+ * \param pattern The string or expression being searched for.
+ * \param match_length Set to the length of the match, if one is found.
+ */
+bool SearchEditFile::reverse_search( const SearchPattern &pattern, std::size_t &match_length )
+{
+    const EditBuffer *line;    // The line being searched.
+    std::size_t       offset;  // The offset of the match in the line.
+
+    // Check the part of the current line before the current point (if there is a line).
+    file_data.jump_to( current_point.cursor_line( ) );
+    if( ( line = file_data.get( ) ) != NULL  &&  current_point.cursor_column( ) > 0 ) {
+        offset = line->rfind( pattern, current_point.cursor_column( ), match_length );
+        if( offset != SearchPattern::npos ) {
+            current_point.jump_to_column( offset );
+            return true;
+        }
+    }
+
+    // Check the lines above, nearest first.
+    while( ( line = file_data.previous( ) ) != NULL ) {
+        offset = line->rfind( pattern, line->length( ), match_length );
+        if( offset != SearchPattern::npos ) {
+            current_point.jump_to_line( file_data.current_index( ) );
+            current_point.jump_to_column( offset );
+            return true;
         }
     }
-    
-    return found;
+    return false;
 }
@@ -6,13 +6,21 @@
 #ifndef SEARCHEDITFILE_HPP
 #define SEARCHEDITFILE_HPP
 
+#include <cstddef>
+
 #include "EditFile.hpp"
+#include "SearchPattern.hpp"
 
 //! Adds simple search abilities to class EditFile.
 class SearchEditFile : private virtual EditFile {
 public:
     //! Adjusts current point to start of string if found.
-    bool simple_search( const char *search_string );
+    bool simple_search( const SearchPattern &pattern );
+    bool simple_search( const SearchPattern &pattern, std::size_t &match_length );
+
+    //! Adjusts current point to start of the previous match if found.
+    bool reverse_search( const SearchPattern &pattern );
+    bool reverse_search( const SearchPattern &pattern, std::size_t &match_length );
 };
 
 #endif
@@ -0,0 +1,324 @@
+/*! \file    SearchPattern.cpp
+ *  \brief   Implementation of class SearchPattern
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "RegularExpression.hpp"
+#include "SearchPattern.hpp"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Searches using the Boyer-Moore-Horspool algorithm. The pattern must not be empty.
+std::size_t SearchPattern::horspool(
+    const char *const text, const std::size_t length, std::size_t start ) const
+{
+    const std::size_t size = pattern.size( );
+    const char last = pattern[size - 1];
+
+    while( length - start >= size ) {
+        const char ch = text[start + size - 1];
+        if( ch == last  &&  std::memcmp( text + start, pattern.data( ), size - 1 ) == 0 ) {
+            return( start );
+        }
+        start += skip[static_cast< unsigned char >( ch )];
+    }
+    return( npos );
+}
+
+
+//! Prepares the tables (or the automaton) used to search for the pattern.
+void SearchPattern::compile( const bool regular_expression )
+{
+    // A window can be shifted past a character that isn't in the string (other than as its last
+    // character). Otherwise it can be shifted to line up the last such character in the string.
+    const std::size_t size = pattern.size( );
+    for( std::size_t &shift : skip ) shift = ( size == 0 ) ? 1 : size;
+    for( std::size_t i = 0; i + 1 < size; ++i ) {
+        skip[static_cast< unsigned char >( pattern[i] )] = size - 1 - i;
+    }
+
+    // Similarly, going backwards, a window can be shifted to line up the first such character
+    // (other than the string's first character).
+    for( std::size_t &shift : reverse_skip ) shift = ( size == 0 ) ? 1 : size;
+    for( std::size_t i = size; i-- > 1; ) {
+        reverse_skip[static_cast< unsigned char >( pattern[i] )] = i;
+    }
+
+    if( regular_expression ) expression.reset( new RegularExpression( pattern ) );
+    else expression.reset( );
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Makes a pattern that matches the empty string.
+SearchPattern::SearchPattern( )
+{
+    for( std::size_t &shift : skip ) shift = 1;
+    for( std::size_t &shift : reverse_skip ) shift = 1;
+}
+
+
+/*!
+ * \param text The string (or expression) to search for.
+ * \param regular_expression True if the text is a regular expression. If the expression is
+ * invalid the pattern matches nothing; error( ) describes the problem.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+SearchPattern::SearchPattern( const std::string &text, const bool regular_expression ) :
+    pattern( text )
+{
+    compile( regular_expression );
+}
+
+
+//! Copies a pattern. An expression is compiled again so the copies can be used independently.
+SearchPattern::SearchPattern( const SearchPattern &other ) : pattern( other.pattern )
+{
+    compile( other.is_regular_expression( ) );
+}
+
+
+SearchPattern &SearchPattern::operator=( const SearchPattern &other )
+{
+    if( this != &other ) {
+        pattern = other.pattern;
+        compile( other.is_regular_expression( ) );
+    }
+    return( *this );
+}
+
+
+// Defined here, where RegularExpression is complete.
+SearchPattern::~SearchPattern( )
+{ }
+
+
+//! Returns a description of what is wrong with an expression, or NULL if nothing is.
+const char *SearchPattern::error( ) const
+{
+    return( expression == nullptr ? NULL : expression->error( ) );
+}
+
+
+/*!
+ * Finds the first occurrence of the string in some text.
+ *
+ * \param text The text to search. It need not be null terminated.
+ * \param length The number of characters in the text.
+ * \param start The offset in the text where the search starts.
+ * \return The offset of the first occurrence of the string at or after start, or npos if there
+ * is none. The empty string is found at start if start is no more than length.
+ */
+std::size_t SearchPattern::find(
+    const char *const text, const std::size_t length, std::size_t start ) const
+{
+    if( expression != nullptr ) {
+        std::size_t match_length;
+        return( find( text, length, NULL, 0, start, match_length ) );
+    }
+
+    const std::size_t size = pattern.size( );
+    if( start > length  ||  length - start < size ) return( npos );
+    if( size == 0 ) return( start );
+
+    if( size == 1 ) {
+        const void *const found = std::memchr( text + start, pattern[0], length - start );
+        return( found == NULL ? npos : static_cast< const char * >( found ) - text );
+    }
+
+#ifdef SEARCH_SSE2
+    // Look for windows whose first and last characters match, 16 windows at a time. Only those
+    // are compared in full.
+    const __m128i first = _mm_set1_epi8( pattern[0] );
+    const __m128i last  = _mm_set1_epi8( pattern[size - 1] );
+    while( length - start >= size + 15 ) {
+        const char *const window = text + start;
+        const __m128i starts = _mm_loadu_si128( reinterpret_cast< const __m128i * >( window ) );
+        const __m128i ends   =
+            _mm_loadu_si128( reinterpret_cast< const __m128i * >( window + size - 1 ) );
+        unsigned mask = static_cast< unsigned >( _mm_movemask_epi8(
+            _mm_and_si128( _mm_cmpeq_epi8( starts, first ), _mm_cmpeq_epi8( ends, last ) ) ) );
+        while( mask != 0 ) {
+            const int offset = std::countr_zero( mask );
+            if( std::memcmp( window + offset + 1, pattern.data( ) + 1, size - 2 ) == 0 ) {
+                return( start + offset );
+            }
+            mask &= mask - 1;
+        }
+        start += 16;
+    }
+#endif
+
+    return( horspool( text, length, start ) );
+}
+
+
+/*!
+ * Finds the first match in text that is stored in two pieces, such as a line with a gap in it.
+ * The pieces are searched as if they were one. Only the few characters on either side of the
+ * join are copied, to look for strings that span it.
+ *
+ * \param first The first piece of the text.
+ * \param first_length The number of characters in the first piece.
+ * \param second The second piece of the text.
+ * \param second_length The number of characters in the second piece.
+ * \param start The offset in the text where the search starts.
+ * \param match_length Set to the length of the match, if there is one.
+ * \return The offset of the first match at or after start, or npos if there is none. For
+ * expressions the longest of the matches at that offset is found.
+ */
+std::size_t SearchPattern::find(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t start, std::size_t &match_length ) const
+{
+    if( expression != nullptr ) {
+        std::size_t match_start;
+        if( !expression->search(
+                first, first_length, second, second_length, start, match_start, match_length ) )
+            return( npos );
+        return( match_start );
+    }
+
+    const std::size_t size = pattern.size( );
+    match_length = size;
+    if( second_length == 0 ) return( find( first, first_length, start ) );
+    if( first_length  == 0 ) return( find( second, second_length, start ) );
+
+    // Matches in the first piece.
+    std::size_t result = npos;
+    if( start <= first_length ) result = find( first, first_length, start );
+    if( result != npos ) return( result );
+
+    // Matches that span the join.
+    const std::size_t overlap = size - ( size != 0 );
+    if( overlap != 0  &&  start < first_length ) {
+        const std::size_t before = std::min( first_length - start, overlap );
+        const std::size_t after  = std::min( second_length, overlap );
+        char local_copy[128];
+        std::string large_copy;
+        char *copy = local_copy;
+        if( before + after > sizeof( local_copy ) ) {
+            large_copy.resize( before + after );
+            copy = &large_copy[0];
+        }
+        std::memcpy( copy, first + first_length - before, before );
+        std::memcpy( copy + before, second, after );
+        result = find( copy, before + after );
+        if( result != npos ) return( first_length - before + result );
+    }
+
+    // Matches in the second piece.
+    result = find( second, second_length, std::max( start, first_length ) - first_length );
+    return( result == npos ? result : first_length + result );
+}
+
+
+/*!
+ * Finds the last occurrence of the string in some text that starts before a given offset. The
+ * text is examined backwards from there, so the time taken depends on how far back the string
+ * is rather than on the length of the text.
+ *
+ * \param text The text to search. It need not be null terminated.
+ * \param length The number of characters in the text.
+ * \param end Only occurrences that start before this offset are found. It may be greater than
+ * length.
+ * \return The offset of the occurrence, or npos if there is none. The empty string is found
+ * at the last offset before end that is no more than length.
+ */
+std::size_t SearchPattern::rfind(
+    const char *const text, const std::size_t length, const std::size_t end ) const
+{
+    if( expression != nullptr ) {
+        std::size_t match_length;
+        return( rfind( text, length, NULL, 0, end, match_length ) );
+    }
+
+    const std::size_t size = pattern.size( );
+    if( end == 0  ||  length < size ) return( npos );
+    if( size == 0 ) return( std::min( end - 1, length ) );
+
+    // Line up the string's first character with each window in turn, shifting back by the
+    // amount allowed by the character under it.
+    std::size_t start = std::min( end - 1, length - size );
+    const char first = pattern[0];
+    while( true ) {
+        const char ch = text[start];
+        if( ch == first  &&  std::memcmp( text + start + 1, pattern.data( ) + 1, size - 1 ) == 0 ) {
+            return( start );
+        }
+        const std::size_t shift = reverse_skip[static_cast< unsigned char >( ch )];
+        if( start < shift ) return( npos );
+        start -= shift;
+    }
+}
+
+
+/*!
+ * Finds the last match that starts before a given offset in text stored in two pieces. For
+ * expressions the longest of the matches at the offset found is used. The match may extend past
+ * the given offset. The parameters are as for find( ).
+ *
+ * \param end Only matches that start before this offset are found.
+ * \return The offset of the match, or npos if there is none.
+ */
+std::size_t SearchPattern::rfind(
+    const char *const first,  const std::size_t first_length,
+    const char *const second, const std::size_t second_length,
+    const std::size_t end, std::size_t &match_length ) const
+{
+    if( expression != nullptr ) {
+        std::size_t match_start;
+        if( !expression->search_backward(
+                first, first_length, second, second_length, end, match_start, match_length ) )
+            return( npos );
+        return( match_start );
+    }
+
+    const std::size_t size = pattern.size( );
+    match_length = size;
+    if( second_length == 0 ) return( rfind( first, first_length, end ) );
+    if( first_length  == 0 ) return( rfind( second, second_length, end ) );
+
+    // Matches in the second piece.
+    std::size_t result = npos;
+    if( end > first_length ) result = rfind( second, second_length, end - first_length );
+    if( result != npos ) return( first_length + result );
+
+    // Matches that span the join.
+    const std::size_t overlap = size - ( size != 0 );
+    if( overlap != 0 ) {
+        const std::size_t before = std::min( first_length, overlap );
+        const std::size_t after  = std::min( second_length, overlap );
+        if( end > first_length - before ) {
+            char local_copy[128];
+            std::string large_copy;
+            char *copy = local_copy;
+            if( before + after > sizeof( local_copy ) ) {
+                large_copy.resize( before + after );
+                copy = &large_copy[0];
+            }
+            std::memcpy( copy, first + first_length - before, before );
+            std::memcpy( copy + before, second, after );
+            const std::size_t copy_end = std::min( end, first_length ) - ( first_length - before );
+            result = rfind( copy, before + after, copy_end );
+            if( result != npos ) return( first_length - before + result );
+        }
+    }
+
+    // Matches in the first piece.
+    return( rfind( first, first_length, std::min( end, first_length ) ) );
+}
@@ -0,0 +1,75 @@
+/*! \file    SearchPattern.hpp
+ *  \brief   Interface to class SearchPattern
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SEARCHPATTERN_HPP
+#define SEARCHPATTERN_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class RegularExpression;
+
+//! A string being searched for, prepared so that text can be searched quickly.
+/*!
+ * The tables needed to search for the string are built once, when the pattern is made, and are
+ * used by every search for it. Searching makes no copies of the text and allocates no memory.
+ *
+ * Where the platform allows, candidate positions are found 16 at a time by comparing the first
+ * and last characters of the string with vector instructions. Otherwise, and for the last few
+ * bytes of the text, the Boyer-Moore-Horspool algorithm is used: the text is examined in steps
+ * given by a table of how far each character allows the string to be shifted. Searching
+ * backwards uses a second table, of how far each character allows the string to be shifted
+ * back.
+ *
+ * A pattern can instead be a regular expression (see RegularExpression). Matches of an
+ * expression vary in length so the length of each match is returned by find( ).
+ */
+class SearchPattern {
+public:
+    //! Returned by find( ) when the string isn't found.
+    static const std::size_t npos = static_cast< std::size_t >( -1 );
+
+    SearchPattern( );
+    explicit SearchPattern( const std::string &text, bool regular_expression = false );
+    SearchPattern( const SearchPattern &other );
+    SearchPattern &operator=( const SearchPattern &other );
+   ~SearchPattern( );
+
+    //! Returns the string (or expression) being searched for.
+    const std::string &text( ) const
+        { return( pattern ); }
+
+    //! Returns the length of the string being searched for. Not meaningful for expressions.
+    std::size_t length( ) const
+        { return( pattern.size( ) ); }
+
+    //! Returns true if the pattern is a regular expression.
+    bool is_regular_expression( ) const
+        { return( expression != nullptr ); }
+
+    const char *error( ) const;
+
+    std::size_t find( const char *text, std::size_t length, std::size_t start = 0 ) const;
+    std::size_t find( const char *first, std::size_t first_length,
+                      const char *second, std::size_t second_length,
+                      std::size_t start, std::size_t &match_length ) const;
+    std::size_t rfind( const char *text, std::size_t length, std::size_t end ) const;
+    std::size_t rfind( const char *first, std::size_t first_length,
+                       const char *second, std::size_t second_length,
+                       std::size_t end, std::size_t &match_length ) const;
+
+private:
+    std::string pattern;    //!< The string being searched for.
+    std::size_t skip[256];  //!< The shift allowed by each character at the end of a window.
+    std::size_t reverse_skip[256];  //!< The shift back allowed by each character at the start.
+    std::unique_ptr< RegularExpression > expression;  //!< The compiled expression, if any.
+
+    void compile( bool regular_expression );
+
+    std::size_t horspool( const char *text, std::size_t length, std::size_t start ) const;
+};
+
+#endif
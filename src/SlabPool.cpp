@@ -0,0 +1,289 @@
+/*! \file    SlabPool.cpp
+ *  \brief   Implementation of class SlabPool
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include "SlabPool.hpp"
+
+// All objects are aligned suitably for any type.
+static const std::size_t object_alignment = alignof( std::max_align_t );
+
+// Every existing pool is on a list so that totals( ) can add up their counters. The counters of
+// deleted pools are added into retired_counters. These are protected by registry_lock.
+static std::mutex            registry_lock;
+static SlabPool             *all_pools        = NULL;
+static SlabPool::Statistics  retired_counters = { 0, 0, 0, 0 };
+
+static std::size_t align( const std::size_t size )
+{
+    return( ( size + object_alignment - 1 ) / object_alignment * object_alignment );
+}
+
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+SlabPool::SlabPool( const std::size_t size ) :
+    object_size  ( align( size == 0 ? 1 : size ) ),
+    available    ( NULL ),
+    held         ( NULL ),
+    attached     ( true ),
+    counters     ( { 0, 0, 0, 0 } ),
+    next_pool    ( NULL ),
+    previous_pool( NULL )
+{ }
+
+
+//! Removes the pool from the list of all pools and deletes it.
+void SlabPool::retire( )
+{
+    {
+        std::lock_guard< std::mutex > guard( registry_lock );
+        if( previous_pool != NULL ) previous_pool->next_pool = next_pool;
+        else all_pools = next_pool;
+        if( next_pool != NULL ) next_pool->previous_pool = previous_pool;
+        retired_counters.allocations   += counters.allocations;
+        retired_counters.slab_requests += counters.slab_requests;
+    }
+    delete this;
+}
+
+
+//! Returns the number of bytes at the start of each slab reserved for the slab header.
+std::size_t SlabPool::header_bytes( )
+{
+    return( align( sizeof( Slab ) ) );
+}
+
+
+//! Obtains a new slab from the system and adds it to the list of available slabs.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+SlabPool::Slab *SlabPool::new_slab( )
+{
+    void *const raw = ::operator new( slab_bytes, std::align_val_t( slab_bytes ) );
+    Slab *const slab = new( raw ) Slab;
+    slab->pool         = this;
+    slab->free_objects = NULL;
+    slab->unused       = static_cast< char * >( raw ) + header_bytes( );
+    slab->live         = 0;
+    link( slab );
+    hold( slab );
+
+    ++counters.slabs;
+    ++counters.slab_requests;
+    return( slab );
+}
+
+
+//! Returns an empty slab to the system.
+void SlabPool::delete_slab( Slab *const slab )
+{
+    unlink( slab );
+    if( slab->previous_held != NULL ) slab->previous_held->next_held = slab->next_held;
+    else held = slab->next_held;
+    if( slab->next_held != NULL ) slab->next_held->previous_held = slab->previous_held;
+    slab->~Slab( );
+    ::operator delete( slab, std::align_val_t( slab_bytes ) );
+    --counters.slabs;
+}
+
+
+//! Adds a slab to the front of the list of slabs with room.
+void SlabPool::link( Slab *const slab )
+{
+    slab->previous = NULL;
+    slab->next     = available;
+    if( available != NULL ) available->previous = slab;
+    available = slab;
+}
+
+
+//! Adds a slab to the front of the list of slabs held by the pool.
+void SlabPool::hold( Slab *const slab )
+{
+    slab->previous_held = NULL;
+    slab->next_held     = held;
+    if( held != NULL ) held->previous_held = slab;
+    held = slab;
+}
+
+
+//! Removes a slab from the list of slabs with room.
+void SlabPool::unlink( Slab *const slab )
+{
+    if( slab->previous != NULL ) slab->previous->next = slab->next;
+    else available = slab->next;
+    if( slab->next != NULL ) slab->next->previous = slab->previous;
+    slab->next = slab->previous = NULL;
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Creates a new pool.
+/*!
+ * No memory for objects is obtained until the first object is allocated. The caller owns the
+ * new pool and must eventually call detach( ) on it.
+ *
+ * \param object_size The size of the objects managed by the pool. Must not exceed
+ * largest_object.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+SlabPool *SlabPool::make( const std::size_t object_size )
+{
+    SlabPool *const pool = new SlabPool( object_size );
+
+    std::lock_guard< std::mutex > guard( registry_lock );
+    pool->next_pool = all_pools;
+    if( all_pools != NULL ) all_pools->previous_pool = pool;
+    all_pools = pool;
+    return( pool );
+}
+
+
+//! Returns the counters summed over all pools that currently exist or ever existed.
+/*!
+ * The counters of pools being used by other threads at the same time may be out of date.
+ */
+SlabPool::Statistics SlabPool::totals( )
+{
+    std::lock_guard< std::mutex > guard( registry_lock );
+    Statistics result = retired_counters;
+    for( const SlabPool *pool = all_pools; pool != NULL; pool = pool->next_pool ) {
+        result.live          += pool->counters.live;
+        result.slabs         += pool->counters.slabs;
+        result.allocations   += pool->counters.allocations;
+        result.slab_requests += pool->counters.slab_requests;
+    }
+    return( result );
+}
+
+
+//! Gives up ownership of the pool.
+/*!
+ * If no objects are allocated the pool is deleted at once. Otherwise it is deleted when its
+ * last object is released. The caller must not use the pool after calling this method.
+ */
+void SlabPool::detach( )
+{
+    attached = false;
+    if( counters.live != 0 ) return;
+    while( available != NULL ) {
+        delete_slab( available );
+    }
+    retire( );
+}
+
+
+//! Allocates one object.
+/*!
+ * \return A pointer to uninitialized, suitably aligned storage for one object.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void *SlabPool::allocate( )
+{
+    Slab *const slab = ( available != NULL ) ? available : new_slab( );
+
+    void *result;
+    if( slab->free_objects != NULL ) {
+        result = slab->free_objects;
+        slab->free_objects = slab->free_objects->next;
+    }
+    else {
+        result = slab->unused;
+        slab->unused += object_size;
+    }
+    ++slab->live;
+    if( is_full( slab ) ) unlink( slab );
+
+    ++counters.live;
+    ++counters.allocations;
+    return( result );
+}
+
+
+//! Returns an object to the pool it came from.
+/*!
+ * A slab that becomes empty is returned to the system unless it is the last slab of a pool that
+ * still has an owner. A detached pool is deleted when its last slab is returned.
+ *
+ * \param object Pointer to an object previously obtained from allocate( ). The object must
+ * already have been destroyed. It is not an error to release a NULL pointer.
+ */
+void SlabPool::release( void *const object )
+{
+    if( object == NULL ) return;
+    Slab     *const slab = slab_of( object );
+    SlabPool *const pool = slab->pool;
+
+    if( pool->is_full( slab ) ) pool->link( slab );
+    FreeObject *const freed = static_cast< FreeObject * >( object );
+    freed->next = slab->free_objects;
+    slab->free_objects = freed;
+    --slab->live;
+    --pool->counters.live;
+
+    if( slab->live == 0 && ( !pool->attached || pool->counters.slabs > 1 ) ) {
+        pool->delete_slab( slab );
+        if( !pool->attached && pool->counters.slabs == 0 ) pool->retire( );
+    }
+}
+
+
+//! Returns every slab of the pool to the system at once.
+/*!
+ * This takes time proportional to the number of slabs rather than the number of objects. The
+ * pool remains usable afterward.
+ *
+ * The caller must have destroyed every object allocated from the pool, and none of them may be
+ * released afterward.
+ */
+void SlabPool::release_all( )
+{
+    while( held != NULL ) {
+        Slab *const slab = held;
+        held = slab->next_held;
+        slab->~Slab( );
+        ::operator delete( slab, std::align_val_t( slab_bytes ) );
+    }
+    available      = NULL;
+    counters.live  = 0;
+    counters.slabs = 0;
+}
+
+
+//! Takes over all the slabs of another pool.
+/*!
+ * The objects allocated from the other pool become objects of this pool, and the other pool is
+ * left empty (but still usable). This takes time proportional to the number of slabs moved.
+ *
+ * \param other The pool giving up its slabs. It must not be used by another thread.
+ * \return false if the pools manage objects of different sizes. In that case nothing is moved.
+ */
+bool SlabPool::absorb( SlabPool &other )
+{
+    if( &other == this ) return( true );
+    if( other.object_size != object_size ) return( false );
+
+    while( other.held != NULL ) {
+        Slab *const slab = other.held;
+        other.held = slab->next_held;
+        const bool has_room = !is_full( slab );
+        if( has_room ) other.unlink( slab );
+        slab->pool = this;
+        if( has_room ) link( slab );
+        hold( slab );
+    }
+    counters.live        += other.counters.live;
+    counters.slabs       += other.counters.slabs;
+    other.counters.live   = 0;
+    other.counters.slabs  = 0;
+    return( true );
+}
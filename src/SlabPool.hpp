@@ -0,0 +1,111 @@
+/*! \file    SlabPool.hpp
+ *  \brief   Interface to class SlabPool
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SLABPOOL_HPP
+#define SLABPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+//! Allocator for many small objects of the same size.
+/*!
+ * A SlabPool obtains memory from the system in large, aligned slabs and carves each slab into
+ * objects of a fixed size. Allocating or releasing an object is a few pointer operations and
+ * never calls the system allocator except when a new slab is needed. A slab is returned to the
+ * system as soon as all of its objects have been released, so memory used by a large file is
+ * given back in slab sized pieces (not one object at a time) when the file is discarded. An owner
+ * that has destroyed all of its objects can give back every slab at once with release_all( )
+ * instead of releasing the objects one at a time.
+ *
+ * Every object knows the pool it came from by way of the slab that contains it. Objects can
+ * thus be released without knowing their pool, and objects can outlive the owner of their
+ * pool. An owner gives up its pool by calling detach( ); the pool is then deleted after its
+ * last object is released.
+ *
+ * SlabPools are not thread safe. Only one thread at a time may allocate or release objects of a
+ * particular pool. Different threads may use different pools at the same time. Thus objects
+ * made by one thread can be handed to another once the first thread stops using the pool.
+ */
+class SlabPool {
+public:
+    //! Counters describing the use of a pool (or of all pools together).
+    struct Statistics {
+        std::size_t live;           //!< Number of objects currently allocated.
+        std::size_t slabs;          //!< Number of slabs currently held.
+        std::size_t allocations;    //!< Number of objects ever allocated.
+        std::size_t slab_requests;  //!< Number of slabs ever obtained from the system.
+    };
+
+    //! Size (and alignment) of each slab in bytes.
+    static const std::size_t slab_bytes = 64 * 1024;
+
+    //! Largest object size a pool can manage.
+    static const std::size_t largest_object = 1024;
+
+    static SlabPool *make( std::size_t object_size );
+    void detach( );
+
+    void *allocate( );
+    static void release( void *object );
+    void release_all( );
+    bool absorb( SlabPool &other );
+
+    //! Returns the counters for this pool.
+    const Statistics &statistics( ) const
+        { return( counters ); }
+
+    static Statistics totals( );
+
+private:
+    struct FreeObject {
+        FreeObject *next;
+    };
+
+    //! Header at the start of every slab.
+    struct Slab {
+        SlabPool   *pool;          //!< The pool that owns this slab.
+        Slab       *next;          //!< Next slab with room for another object.
+        Slab       *previous;      //!< Previous slab with room for another object.
+        Slab       *next_held;     //!< Next slab held by the pool.
+        Slab       *previous_held; //!< Previous slab held by the pool.
+        FreeObject *free_objects;  //!< Released objects available for reuse.
+        char       *unused;        //!< Start of space in the slab never yet allocated.
+        std::size_t live;          //!< Number of allocated objects in this slab.
+    };
+
+    std::size_t object_size;  //!< Size of each object (a multiple of the alignment).
+    Slab       *available;    //!< List of slabs with room for another object.
+    Slab       *held;         //!< List of all slabs held by the pool.
+    bool        attached;     //!< True while the pool has an owner.
+    Statistics  counters;     //!< Counters for this pool.
+    SlabPool   *next_pool;      //!< Next pool in the list of all pools.
+    SlabPool   *previous_pool;  //!< Previous pool in the list of all pools.
+
+    void retire( );
+
+    explicit SlabPool( std::size_t size );
+   ~SlabPool( ) { }
+
+    // Pools are shared by reference and never copied.
+    SlabPool( const SlabPool & ) = delete;
+    SlabPool &operator=( const SlabPool & ) = delete;
+
+    static std::size_t header_bytes( );
+    static Slab *slab_of( void *object )
+        { return( reinterpret_cast< Slab * >(
+            reinterpret_cast< std::uintptr_t >( object ) & ~std::uintptr_t( slab_bytes - 1 ) ) ); }
+    bool is_full( const Slab *slab ) const
+        { return( slab->free_objects == NULL &&
+                  slab->unused + object_size >
+                      reinterpret_cast< const char * >( slab ) + slab_bytes ); }
+
+    Slab *new_slab( );
+    void  delete_slab( Slab *slab );
+    void  link( Slab *slab );
+    void  hold( Slab *slab );
+    void  unlink( Slab *slab );
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*! \file    TextBlock.cpp
+ *  \brief   Implementation of class TextBlock
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include "TextBlock.hpp"
+
+#if eOPSYS == ePOSIX
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#if eOPSYS == ePOSIX
+namespace {
+
+    /*
+     * If a mapped file shrinks, using the text past its new end raises SIGBUS. The handler below
+     * replaces the missing page of a mapping with a page of null characters and lets the program
+     * continue. The mappings are recorded in a fixed table so the handler can find them without
+     * taking locks or allocating memory.
+     */
+
+    //! A mapping of a file. A null start means the entry is unused.
+    struct Mapping {
+        std::atomic< char * >      start;   //!< The first byte of the mapping.
+        std::atomic< std::size_t > length;  //!< The number of bytes mapped.
+    };
+
+    const int max_mappings = 64;
+
+    Mapping             mappings[max_mappings];  //!< The mappings protected.
+    std::mutex          mappings_lock;           //!< Serializes changes to mappings.
+    std::atomic< bool > any_shrank( false );     //!< Set when a missing page is replaced.
+    struct sigaction    previous_action;         //!< What SIGBUS did before.
+    std::size_t         page_size;               //!< The size of a page of memory.
+
+    //! Replaces the page of a mapping that caused SIGBUS with null characters.
+    void bus_handler( int, siginfo_t *info, void * )
+    {
+        char *const address = static_cast< char * >( info->si_addr );
+        for( Mapping &mapping : mappings ) {
+            char *const start = mapping.start.load( std::memory_order_acquire );
+            if( start == NULL  ||  address < start  ||
+                address >= start + mapping.length.load( std::memory_order_relaxed ) ) continue;
+
+            // Mappings start on a page boundary.
+            char *const page = start + ( address - start ) / page_size * page_size;
+            if( mmap( page, page_size, PROT_READ,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 ) == MAP_FAILED ) break;
+            any_shrank.store( true, std::memory_order_relaxed );
+            return;
+        }
+
+        // Not a mapped file. The fault happens again when the handler returns and is then
+        // handled as it was before bus_handler was installed.
+        sigaction( SIGBUS, &previous_action, NULL );
+    }
+
+
+    //! Installs bus_handler. Returns false if it can't be installed.
+    bool install_handler( )
+    {
+        const long size = sysconf( _SC_PAGESIZE );
+        if( size <= 0 ) return false;
+        page_size = static_cast< std::size_t >( size );
+
+        struct sigaction action;
+        action.sa_sigaction = bus_handler;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset( &action.sa_mask );
+        return( sigaction( SIGBUS, &action, &previous_action ) == 0 );
+    }
+
+
+    //! Records a mapping so that bus_handler protects it. Returns false if the table is full.
+    bool protect( char *const start, const std::size_t length )
+    {
+        static const bool installed = install_handler( );
+        if( !installed ) return false;
+
+        // The length is set before the start so the handler never sees a stale length.
+        std::lock_guard< std::mutex > guard( mappings_lock );
+        for( Mapping &mapping : mappings ) {
+            if( mapping.start.load( std::memory_order_relaxed ) != NULL ) continue;
+            mapping.length.store( length, std::memory_order_relaxed );
+            mapping.start.store( start, std::memory_order_release );
+            return true;
+        }
+        return false;
+    }
+
+
+    //! Removes a mapping from the table.
+    void unprotect( char *const start )
+    {
+        std::lock_guard< std::mutex > guard( mappings_lock );
+        for( Mapping &mapping : mappings ) {
+            if( mapping.start.load( std::memory_order_relaxed ) == start ) {
+                mapping.start.store( NULL, std::memory_order_relaxed );
+                return;
+            }
+        }
+    }
+
+}
+#endif
+
+//! Creates a new block.
+/*!
+ * The new block has a reference count of one; that reference belongs to the caller.
+ *
+ * \param initial_size The number of bytes of text the block should be able to hold.
+ * \return A pointer to the new block or NULL if there is insufficient memory.
+ */
+TextBlock *TextBlock::make( const std::size_t initial_size )
+{
+    TextBlock *const result = new( std::nothrow ) TextBlock;
+    if( result == NULL ) return NULL;
+
+    // Always allocate at least one byte so the text pointer is never NULL.
+    result->text = static_cast< char * >( std::malloc( initial_size == 0 ? 1 : initial_size ) );
+    if( result->text == NULL ) {
+        delete result;
+        return NULL;
+    }
+    result->length = initial_size;
+    return( result );
+}
+
+
+#if eOPSYS == ePOSIX
+//! Creates a new block holding a read-only mapping of a file.
+/*!
+ * The text is not read; it is paged in from the file as it is used and the system can drop it
+ * again when memory is needed. Thus the file can be larger than the memory available. The file
+ * should not be changed while it is mapped. If it shrinks, the missing text reads as null
+ * characters instead of crashing the program, and shrank( ) reports it.
+ *
+ * \param descriptor The file to map. It can be closed once the block is made.
+ * \param size The number of bytes to map, starting at the beginning of the file. Must not be
+ * zero.
+ * \return A pointer to the new block or NULL if the file can't be mapped.
+ */
+TextBlock *TextBlock::map( const int descriptor, const std::size_t size )
+{
+    void *const address = mmap( NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+    if( address == MAP_FAILED ) return NULL;
+
+    TextBlock *const result = new( std::nothrow ) TextBlock;
+    if( result == NULL  ||  !protect( static_cast< char * >( address ), size ) ) {
+        delete result;
+        munmap( address, size );
+        return NULL;
+    }
+    result->text   = static_cast< char * >( address );
+    result->length = size;
+    result->mapped = true;
+    return( result );
+}
+
+
+//! Returns true if a mapped file has shrunk since the last call. See map( ).
+bool TextBlock::shrank( )
+{
+    return( any_shrank.exchange( false, std::memory_order_relaxed ) );
+}
+#endif
+
+
+TextBlock::~TextBlock( )
+{
+  #if eOPSYS == ePOSIX
+    if( mapped ) {
+        unprotect( text );
+        munmap( text, length );
+        return;
+    }
+  #endif
+    std::free( text );
+}
+
+
+//! Changes the size of the block.
+/*!
+ * This method may only be used by the creator of the block before any other references to it
+ * have been made. It can't be used on a mapped block. The text may move in memory as a result.
+ * The existing text up to the smaller of the old and new sizes is preserved.
+ *
+ * \param new_size The number of bytes of text the block should hold.
+ * \return false if there is insufficient memory. In that case the block is unchanged.
+ */
+bool TextBlock::resize( const std::size_t new_size )
+{
+    if( mapped ) return false;
+
+    char *const new_text =
+        static_cast< char * >( std::realloc( text, new_size == 0 ? 1 : new_size ) );
+    if( new_text == NULL ) return false;
+    text   = new_text;
+    length = new_size;
+    return true;
+}
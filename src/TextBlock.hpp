@@ -0,0 +1,73 @@
+/*! \file    TextBlock.hpp
+ *  \brief   Interface to class TextBlock
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef TEXTBLOCK_HPP
+#define TEXTBLOCK_HPP
+
+#include <atomic>
+#include <cstddef>
+
+#include "environ.hpp"
+
+//! Reference counted block of text shared by many EditBuffers.
+/*!
+ * A TextBlock holds a large run of raw text, typically the entire contents of a file as it was
+ * read from disk. It plays the role of the "original buffer" in a piece table. EditBuffers that
+ * have not been modified since they were loaded refer to a slice of a TextBlock instead of
+ * holding their own copy of the text. When such an EditBuffer is first modified it copies its
+ * slice into private storage and releases its reference to the block.
+ *
+ * The block is filled by its creator immediately after it is made, or gradually while it is
+ * in use as long as the text still being filled hasn't been given to anyone. Text in the block
+ * that has been given to anyone else must never change. A block can also be a read-only
+ * mapping of a file, in which case its text is paged in from the file as it is used. The block
+ * deletes itself when the last reference to it is released. References can be acquired and
+ * released by several threads at once.
+ */
+class TextBlock {
+public:
+    static TextBlock *make( std::size_t initial_size );
+  #if eOPSYS == ePOSIX
+    static TextBlock *map( int descriptor, std::size_t size );
+    static bool shrank( );
+  #endif
+
+    //! Returns a pointer to the text in the block.
+    char *data( )
+        { return( text ); }
+
+    //! Returns the number of bytes in the block.
+    std::size_t size( ) const
+        { return( length ); }
+
+    //! Returns true if the block is a mapping of a file. Its text can't be changed.
+    bool is_mapped( ) const
+        { return( mapped ); }
+
+    bool resize( std::size_t new_size );
+
+    //! Records a new reference to the block.
+    void acquire( )
+        { reference_count.fetch_add( 1, std::memory_order_relaxed ); }
+
+    //! Releases a reference to the block. The block is deleted when no references remain.
+    void release( )
+        { if( reference_count.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) delete this; }
+
+private:
+    std::atomic< std::size_t > reference_count; //!< Number of references to this block.
+    std::size_t length;          //!< Number of bytes of text in the block.
+    char       *text;            //!< Pointer to the text (allocated with std::malloc or mapped).
+    bool        mapped;          //!< True if the text is a mapping of a file.
+
+    TextBlock( ) : reference_count( 1 ), length( 0 ), text( NULL ), mapped( false ) { }
+   ~TextBlock( );
+
+    // Blocks are shared by reference and never copied.
+    TextBlock( const TextBlock & ) = delete;
+    TextBlock &operator=( const TextBlock & ) = delete;
+};
+
+#endif
@@ -119,11 +119,10 @@ static bool process_paragraph( EditList &list, long first, long last )
     list.jump_to( first );
     if( (*list.get( ))[0] == ' ' ) indentor = "     ";
 
-    // Copy pointers to lines into temporary and delete free nodes from the list.
+    // Move the lines into temporary.
     long count = last - first;
     while( !abort && count-- ) {
-        if( temp.insert( list.get( ) ) == NULL ) abort = true;
-        else list.erase( );
+        if( temp.insert( list.release( ) ) == NULL ) abort = true;
     }
 
     // Tell user if it didn't work.
@@ -137,34 +136,28 @@ static bool process_paragraph( EditList &list, long first, long last )
   
     // Loop over all the lines in the temporary list.
     for( temp.jump_to( 0 ); !abort && temp.get( ) != NULL; temp.next( ) ) {
-
-        // TODO: Clean this mess up!
-        std::string string_buffer = temp.get( )->to_string( );
-        char *buffer = new char[string_buffer.length( ) + 1];
-        std::strcpy( buffer, string_buffer.c_str( ) );
-        char *word = std::strtok( buffer, " " );
+        const EditBuffer &old_line = *temp.get( );
+        const std::size_t length   = old_line.length( );
+        std::size_t       offset   = 0;
 
         // Loop over all words in the line from the temporary list.
-        while( word != NULL ) {
+        while( true ) {
+            while( offset < length && old_line[offset] == ' ' ) ++offset;
+            if( offset == length ) break;
+            std::size_t word_end = offset;
+            while( word_end < length && old_line[word_end] != ' ' ) ++word_end;
 
             // If this line will become too long, insert what we've got and start next line.
-            if( new_line->length( ) + std::strlen( word ) > 96 ) {
+            if( new_line->length( ) + ( word_end - offset ) > 96 ) {
                 list.insert( new_line );
-                new_line = new EditBuffer( word );
-                new_line->append( ' ' );
-            }
-
-            // Otherwise put this word on the temporary line.
-            else {
-                new_line->append( word );
-                new_line->append( ' ' );
+                new_line = new EditBuffer;
             }
 
-            // Try to extract the next word.
-            word = std::strtok( NULL, " " );
+            // Put this word on the temporary line.
+            new_line->append( old_line.subbuffer( offset, word_end ) );
+            new_line->append( ' ' );
+            offset = word_end;
         }
-
-        delete buffer;
     }
 
     if( abort ) {
@@ -209,9 +202,12 @@ bool WPEditFile::reformat_paragraph( )
         long first = first_line( file_data );
         long last  = last_line( file_data );
 
-        // Modify the object and mark it as changed.
+        // Modify the object and mark it as changed. The paragraph's lines are replaced.
         is_changed = true;
+        const long old_size = file_data.size( );
+        journal_delete( first, last - first );
         result = process_paragraph( file_data, first, last );
+        journal_insert( first, file_data.size( ) - old_size + ( last - first ) );
     }
     return result;
 }
@@ -571,17 +571,17 @@ static KeyboardAssociation keyboard_map[] = {
     KeyboardAssociation( scr::K_SF6    , "\"Command Unknown\" error_message" ),
     KeyboardAssociation( scr::K_SF7    , "\"Command Unknown\" error_message" ),
     KeyboardAssociation( scr::K_SF8    , "\"Command Unknown\" error_message" ),
-    KeyboardAssociation( scr::K_SF9    , "\"Command Unknown\" error_message" ),
+    KeyboardAssociation( scr::K_SF9    , "search_tree" ),
     KeyboardAssociation( scr::K_SF10   , "redirect_to" ),
     KeyboardAssociation( scr::K_CF1    , "search_first" ),
     KeyboardAssociation( scr::K_CF2    , "search_next" ),
     KeyboardAssociation( scr::K_CF3    , "search_replace" ),
-    KeyboardAssociation( scr::K_CF4    , "\"Command Unknown\" error_message" ),
+    KeyboardAssociation( scr::K_CF4    , "toggle_regex" ),
     KeyboardAssociation( scr::K_CF5    , "set_mark" ),
     KeyboardAssociation( scr::K_CF6    , "toggle_mark" ),
-    KeyboardAssociation( scr::K_CF7    , "\"Command Unknown\" error_message" ),
-    KeyboardAssociation( scr::K_CF8    , "\"Command Unknown\" error_message" ),
-    KeyboardAssociation( scr::K_CF9    , "\"Command Unknown\" error_message" ),
+    KeyboardAssociation( scr::K_CF7    , "search_previous" ),
+    KeyboardAssociation( scr::K_CF8    , "incremental_search" ),
+    KeyboardAssociation( scr::K_CF9    , "search_all_files" ),
     KeyboardAssociation( scr::K_CF10   , "redirect_from" ),
     KeyboardAssociation( scr::K_AF1    , "refresh_file" ),
     KeyboardAssociation( scr::K_AF2    , "rename_file" ),
@@ -589,7 +589,7 @@ static KeyboardAssociation keyboard_map[] = {
     KeyboardAssociation( scr::K_AF4    , "kill_file" ),
     KeyboardAssociation( scr::K_AF5    , "\"Command Unknown\" error_message" ),
     KeyboardAssociation( scr::K_AF6    , "copy" ),
-    KeyboardAssociation( scr::K_AF7    , "\"Command Unknown\" error_message" ),
+    KeyboardAssociation( scr::K_AF7    , "goto_match" ),
     KeyboardAssociation( scr::K_AF8    , "file_insert" ),
     KeyboardAssociation( scr::K_AF9    , "goto_column" ),
     KeyboardAssociation( scr::K_AF10   , "external_filter" ),
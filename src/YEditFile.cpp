@@ -45,6 +45,9 @@ YEditFile::YEditFile( const char *name_of_file, int tab_distance, int file_color
         set_timestamp( file_name.c_str( ) );  // Read the time stamp for the first load.
     }
 
+    // The text as loaded is the base version for merging changes made on disk.
+    remember_base( );
+
     // File has not yet changed. (Note: new files will not save unless something is entered into
     // them).
     //
@@ -317,3 +320,47 @@ void YEditFile::display( )
               ( int ) ( 2 + current_point.cursor_line( ) - current_point.window_line( ) ),
                         2 + current_point.cursor_column( ) - current_point.window_column( ) );
 }
+
+
+/*!
+ * This function marks the matches of a pattern in the lines on the screen. The match at the
+ * current point is marked differently from the others. It must be called after display( ) since
+ * it only changes the colors of what display( ) wrote. Only the lines on the screen are
+ * searched.
+ */
+void YEditFile::show_matches( const SearchPattern &pattern )
+{
+    if( pattern.length( ) == 0 ) return;
+
+    const int screen_width  = scr::number_of_columns( );
+    const int screen_height = scr::number_of_rows( );
+    const std::size_t left  = current_point.window_column( );
+    const std::size_t right = left + screen_width - 2;
+
+    file_data.jump_to( current_point.window_line( ) );
+    EditBuffer *edit_line;
+    for( int i = 2; i < screen_height  &&  ( edit_line = file_data.next( ) ) != NULL; i++ ) {
+        const long line_number = current_point.window_line( ) + ( i - 2 );
+        std::size_t length;
+        std::size_t offset = edit_line->find( pattern, 0, length );
+
+        // Mark the part of each match that is on the screen.
+        while( offset != SearchPattern::npos  &&  offset < right ) {
+            const std::size_t first = ( offset < left ) ? left : offset;
+            const std::size_t last  = ( offset + length > right ) ? right : offset + length;
+            if( first < last ) {
+                const bool current = ( line_number == current_point.cursor_line( )  &&
+                                       offset == current_point.cursor_column( ) );
+                scr::set_color( i, static_cast< int >( 2 + first - left ),
+                                static_cast< int >( last - first ), 1,
+                                current ? scr::BLACK|scr::REV_WHITE : scr::BLACK|scr::REV_CYAN );
+            }
+            offset = edit_line->find( pattern, offset + ( length == 0 ? 1 : length ), length );
+        }
+    }
+
+    // Put the cursor back.
+    scr::set_cursor_position(
+              ( int ) ( 2 + current_point.cursor_line( ) - current_point.window_line( ) ),
+                        2 + current_point.cursor_column( ) - current_point.window_column( ) );
+}
@@ -65,6 +65,9 @@ public:
 
     //! Redraws entire display.
     void display( );
+
+    //! Highlights the matches of a pattern in the lines displayed.
+    void show_matches( const SearchPattern &pattern );
 };
 
 #endif
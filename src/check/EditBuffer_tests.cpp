@@ -2,16 +2,28 @@
  *  \brief   EditBuffer unit tests.
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  *
- * The tests below take into account the fact that edit buffers are initially allocated with a
- * capacity of 8. These tests explore the boundary between a size of 8 and a size of 9 to verify
- * that no errors occur just before or just after a re-allocation of internal memory. If
- * EditBuffer's initial capacity is changed, these tests should be adjusted to remain effective.
+ * EditBuffers store up to 32 characters inline. Longer text made by a constructor or an
+ * assignment is stored in an array of exactly its size, and text that grows past its storage is
+ * moved to a larger array. The inline_tests explore the boundary between a size of 32 and a
+ * size of 33 to verify that no errors occur just before or just after text moves between inline
+ * and dynamic storage in either direction, and that an exactly sized array grows correctly. If
+ * EditBuffer's inline capacity is changed, these tests should be adjusted to remain effective.
+ * The sizes of 8 and 9 in the earlier tests date from an older design and no longer fall on a
+ * boundary.
  */
 
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <utility>
 
 // From Y.
 #include "EditBuffer.hpp"
+#include "TextBlock.hpp"
+
+#if eOPSYS == ePOSIX
+#include <unistd.h>
+#endif
 
 // From SpicaCpp.
 #include "UnitTestManager.hpp"
@@ -178,6 +190,278 @@ namespace {
         UNIT_CHECK( test_buffer1.length( ) == 0 );
     }
 
+    void borrowed_tests( )
+    {
+        UnitTestManager::UnitTest test( "borrowed_tests" );
+
+        TextBlock *block = TextBlock::make( 11 );
+        std::memcpy( block->data( ), "Hello\nWorld", 11 );
+
+        EditBuffer test_buffer1( block, 0, 5 );
+        EditBuffer test_buffer2( block, 6, 5 );
+        block->release( );
+
+        // Borrowed text reads like any other text.
+        EditBuffer_compare( test_buffer1, "Hello" );
+        EditBuffer_compare( test_buffer2, "World" );
+        UNIT_CHECK( test_buffer1[5] == '\0' );
+        UNIT_CHECK( test_buffer2.to_string( ) == "World" );
+
+        // Copies and subbuffers share the block.
+        EditBuffer test_buffer3( test_buffer1 );
+        EditBuffer test_buffer4 = test_buffer2.subbuffer( 1, 4 );
+        EditBuffer_compare( test_buffer3, "Hello" );
+        EditBuffer_compare( test_buffer4, "orl" );
+
+        // Modifying a buffer does not disturb the others.
+        test_buffer3.replace( 'J', 0 );
+        test_buffer3.append( '!' );
+        EditBuffer_compare( test_buffer3, "Jello!" );
+        EditBuffer_compare( test_buffer1, "Hello" );
+        test_buffer1.insert( 'x', 2 );
+        EditBuffer_compare( test_buffer1, "Hexllo" );
+
+        // Narrowing borrowed text at either end, and trimming it.
+        UNIT_CHECK( test_buffer2.erase( 0 ) == 'W' );
+        UNIT_CHECK( test_buffer2.erase( 3 ) == 'd' );
+        EditBuffer_compare( test_buffer2, "orl" );
+        UNIT_CHECK( test_buffer2.erase( 1 ) == 'r' );
+        EditBuffer_compare( test_buffer2, "ol" );
+        test_buffer4.trim( 1 );
+        EditBuffer_compare( test_buffer4, "o" );
+        UNIT_CHECK( test_buffer4 == EditBuffer( "o" ) );
+    }
+
+    #if eOPSYS == ePOSIX
+    void mapped_tests( )
+    {
+        UnitTestManager::UnitTest test( "mapped_tests" );
+
+        // A file of three pages, each filled with one letter.
+        char name[] = "/tmp/Ycheck.XXXXXX";
+        const int descriptor = mkstemp( name );
+        if( descriptor < 0 ) {
+            UNIT_CHECK( false );
+            return;
+        }
+        unlink( name );
+        const std::size_t page = static_cast< std::size_t >( sysconf( _SC_PAGESIZE ) );
+        std::string text( page, 'a' );
+        text.append( page, 'b' );
+        text.append( page, 'c' );
+        TextBlock *block = NULL;
+        if( write( descriptor, text.data( ), text.size( ) ) ==
+                static_cast< ssize_t >( text.size( ) ) ) {
+            block = TextBlock::map( descriptor, text.size( ) );
+        }
+        UNIT_CHECK( block != NULL  &&  block->is_mapped( ) );
+        if( block == NULL ) {
+            close( descriptor );
+            return;
+        }
+
+        EditBuffer first( block, 0, 3 );
+        EditBuffer last( block, 2 * page + 1, 3 );
+        block->release( );
+        EditBuffer_compare( first, "aaa" );
+        UNIT_CHECK( !TextBlock::shrank( ) );
+
+        // Text past the new end of a file that shrinks reads as null characters.
+        UNIT_CHECK( ftruncate( descriptor, static_cast< off_t >( page ) ) == 0 );
+        close( descriptor );
+        UNIT_CHECK( last[0] == '\0'  &&  last[2] == '\0' );
+        UNIT_CHECK( TextBlock::shrank( ) );
+        UNIT_CHECK( !TextBlock::shrank( ) );
+        EditBuffer_compare( first, "aaa" );
+    }
+    #endif
+
+    void gap_tests( )
+    {
+        UnitTestManager::UnitTest test( "gap_tests" );
+
+        EditBuffer test_buffer1( "0123456789" );
+        std::string model( "0123456789" );
+
+        // Typing, backspacing, and deleting in the middle of the text.
+        for( char letter = 'a'; letter <= 'z'; ++letter ) {
+            test_buffer1.insert( letter, 5 + ( letter - 'a' ) );
+            model.insert( 5 + ( letter - 'a' ), 1, letter );
+        }
+        EditBuffer_compare( test_buffer1, model.c_str( ) );
+        UNIT_CHECK( test_buffer1.erase( 30 ) == model[30] );
+        model.erase( 30, 1 );
+        UNIT_CHECK( test_buffer1.erase( 29 ) == model[29] );
+        model.erase( 29, 1 );
+        UNIT_CHECK( test_buffer1.erase( 3 ) == model[3] );
+        model.erase( 3, 1 );
+        UNIT_CHECK( test_buffer1.to_string( ) == model );
+
+        // Random edits checked against a model.
+        std::srand( 1 );
+        for( int i = 0; i < 2000; ++i ) {
+            const std::size_t offset = std::rand( ) % ( model.size( ) + 3 );
+            const char letter = static_cast< char >( 'A' + std::rand( ) % 26 );
+            switch( std::rand( ) % 4 ) {
+            case 0:
+            case 1:
+                test_buffer1.insert( letter, offset );
+                if( offset > model.size( ) ) model.append( offset - model.size( ), ' ' );
+                model.insert( offset, 1, letter );
+                break;
+            case 2:
+                if( offset < model.size( ) ) {
+                    UNIT_CHECK( test_buffer1.erase( offset ) == model[offset] );
+                    model.erase( offset, 1 );
+                }
+                else UNIT_CHECK( test_buffer1.erase( offset ) == '\0' );
+                break;
+            case 3:
+                test_buffer1.replace( letter, offset );
+                if( offset >= model.size( ) ) {
+                    model.append( offset - model.size( ), ' ' );
+                    model.append( 1, letter );
+                }
+                else model[offset] = letter;
+                break;
+            }
+        }
+        UNIT_CHECK( test_buffer1.to_string( ) == model );
+
+        // Operations that read the whole text see it correctly wherever the gap is.
+        test_buffer1.insert( '#', model.size( ) / 2 );
+        model.insert( model.size( ) / 2, 1, '#' );
+        EditBuffer test_buffer2( test_buffer1 );
+        UNIT_CHECK( test_buffer2.to_string( ) == model );
+        UNIT_CHECK( test_buffer1.subbuffer( 2, 20 ).to_string( ) == model.substr( 2, 18 ) );
+        test_buffer2.append( test_buffer1 );
+        UNIT_CHECK( test_buffer2.to_string( ) == model + model );
+        test_buffer1.append( test_buffer1 );
+        UNIT_CHECK( test_buffer1 == test_buffer2 );
+        test_buffer1.trim( 10 );
+        UNIT_CHECK( test_buffer1.to_string( ) == model.substr( 0, 10 ) );
+    }
+
+    void inline_tests( )
+    {
+        UnitTestManager::UnitTest test( "inline_tests" );
+
+        const char *const text32 = "0123456789abcdefghijklmnopqrstuv";
+        const char *const text33 = "0123456789abcdefghijklmnopqrstuvw";
+
+        // Construction on either side of the boundary.
+        EditBuffer test_buffer1( text32 );
+        EditBuffer test_buffer2( text33 );
+        EditBuffer_compare( test_buffer1, text32 );
+        EditBuffer_compare( test_buffer2, text33 );
+
+        // Growing from inline storage to dynamic storage, with the gap in the middle.
+        test_buffer1.insert( 'w', 32 );
+        EditBuffer_compare( test_buffer1, text33 );
+        test_buffer1.erase( 10 );
+        test_buffer1.insert( 'a', 10 );
+        EditBuffer_compare( test_buffer1, text33 );
+        test_buffer1.insert( '!', 5 );
+        UNIT_CHECK( test_buffer1.to_string( ) == "01234!56789abcdefghijklmnopqrstuvw" );
+
+        // Copies and assignments between inline and dynamic storage.
+        EditBuffer test_buffer3( test_buffer2 );
+        EditBuffer test_buffer4( "short" );
+        EditBuffer_compare( test_buffer3, text33 );
+        test_buffer3 = test_buffer4;
+        EditBuffer_compare( test_buffer3, "short" );
+        test_buffer4 = test_buffer2;
+        EditBuffer_compare( test_buffer4, text33 );
+        test_buffer3.insert( 'x', 2 );
+        test_buffer4 = test_buffer3;
+        EditBuffer_compare( test_buffer4, "shxort" );
+
+        // Trimming dynamic storage back to inline storage.
+        test_buffer2.insert( '-', 16 );
+        test_buffer2.trim( 20 );
+        EditBuffer_compare( test_buffer2, "0123456789abcdef-ghi" );
+        test_buffer2.append( text32 );
+        EditBuffer_compare( test_buffer2, "0123456789abcdef-ghi0123456789abcdefghijklmnopqrstuv" );
+        UNIT_CHECK( test_buffer2.subbuffer( 20, 52 ) == EditBuffer( text32 ) );
+        test_buffer2.erase( );
+        UNIT_CHECK( test_buffer2.length( ) == 0 );
+        test_buffer2.append( text33 );
+        EditBuffer_compare( test_buffer2, text33 );
+    }
+
+    void move_tests( )
+    {
+        UnitTestManager::UnitTest test( "move_tests" );
+
+        const char *const long_text = "This text is too long to be stored inline in an EditBuffer";
+
+        // Moving dynamic, inline, and borrowed text.
+        EditBuffer test_buffer1( long_text );
+        EditBuffer test_buffer2( std::move( test_buffer1 ) );
+        EditBuffer_compare( test_buffer2, long_text );
+        UNIT_CHECK( test_buffer1.length( ) == 0 );
+        test_buffer1.append( "reusable" );
+        EditBuffer_compare( test_buffer1, "reusable" );
+
+        EditBuffer test_buffer3( std::move( test_buffer1 ) );
+        EditBuffer_compare( test_buffer3, "reusable" );
+        UNIT_CHECK( test_buffer1.length( ) == 0 );
+
+        test_buffer3 = std::move( test_buffer2 );
+        EditBuffer_compare( test_buffer3, long_text );
+        test_buffer2 = EditBuffer( "short" );
+        EditBuffer_compare( test_buffer2, "short" );
+
+        TextBlock *block = TextBlock::make( 5 );
+        std::memcpy( block->data( ), "Hello", 5 );
+        EditBuffer test_buffer4( block, 0, 5 );
+        block->release( );
+        UNIT_CHECK( test_buffer4.is_borrowed( ) );
+        test_buffer2 = std::move( test_buffer4 );
+        UNIT_CHECK( test_buffer2.is_borrowed( ) );
+        UNIT_CHECK( !test_buffer4.is_borrowed( ) );
+        EditBuffer_compare( test_buffer2, "Hello" );
+
+        // Copying text out.
+        char result[8];
+        test_buffer3.insert( '*', 3 );
+        UNIT_CHECK( test_buffer3.copy( result, 8, 1 ) == 8 );
+        UNIT_CHECK( std::memcmp( result, "hi*s tex", 8 ) == 0 );
+        UNIT_CHECK( test_buffer2.copy( result, 8, 2 ) == 3 );
+        UNIT_CHECK( std::memcmp( result, "llo", 3 ) == 0 );
+        UNIT_CHECK( test_buffer2.copy( result, 8, 5 ) == 0 );
+    }
+
+
+    void hash_tests( )
+    {
+        UnitTestManager::UnitTest test( "hash_tests" );
+
+        const char *const long_text = "This text is too long to be stored inline in an EditBuffer";
+
+        // The same text has the same hash however it is stored.
+        TextBlock *block = TextBlock::make( std::strlen( long_text ) );
+        std::memcpy( block->data( ), long_text, std::strlen( long_text ) );
+        EditBuffer test_buffer1( block, 0, std::strlen( long_text ) );
+        block->release( );
+        EditBuffer test_buffer2( long_text );
+        UNIT_CHECK( test_buffer1.hash( ) == test_buffer2.hash( ) );
+
+        // Moving the gap doesn't change the hash.
+        test_buffer2.insert( 'x', 5 );
+        UNIT_CHECK( test_buffer1.hash( ) != test_buffer2.hash( ) );
+        test_buffer2.erase( 5 );
+        UNIT_CHECK( test_buffer1.hash( ) == test_buffer2.hash( ) );
+
+        EditBuffer test_buffer3( "short" );
+        EditBuffer test_buffer4( "shrt" );
+        test_buffer4.insert( 'o', 2 );
+        UNIT_CHECK( test_buffer3.hash( ) == test_buffer4.hash( ) );
+        UNIT_CHECK( test_buffer3.hash( ) == EditBuffer::hash( "short", 5 ) );
+        UNIT_CHECK( EditBuffer( ).hash( ) == EditBuffer( "" ).hash( ) );
+        UNIT_CHECK( EditBuffer( "ab" ).hash( ) != EditBuffer( "ba" ).hash( ) );
+    }
+
 }
 
 
@@ -191,5 +475,13 @@ bool EditBuffer_tests( )
     append_tests( );
     subbuffer_tests( );
     trim_tests( );
+    borrowed_tests( );
+    #if eOPSYS == ePOSIX
+    mapped_tests( );
+    #endif
+    gap_tests( );
+    inline_tests( );
+    move_tests( );
+    hash_tests( );
     return true;
 }
@@ -3,7 +3,12 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cstdlib>
+#include <string>
+#include <vector>
+
 // From Y.
+#include "EditBuffer.hpp"
 #include "EditList.hpp"
 
 // From SpicaCpp.
@@ -11,7 +16,426 @@
 
 #include "check.hpp"
 
+namespace {
+
+    // Returns true if the list holds the same lines as the model.
+    bool EditList_matches( EditList &list, const std::vector< std::string > &model )
+    {
+        if( list.size( ) != static_cast< long >( model.size( ) ) ) return false;
+
+        // Check in order (following links) and at scattered positions (searching the tree).
+        list.jump_to( 0 );
+        for( std::size_t i = 0; i < model.size( ); ++i ) {
+            EditBuffer *line = list.next( );
+            if( line == NULL || line->to_string( ) != model[i] ) return false;
+        }
+        if( list.next( ) != NULL ) return false;
+        for( std::size_t i = 0; i < model.size( ); i += 97 ) {
+            const long target = static_cast< long >( model.size( ) - 1 - i );
+            list.jump_to( target );
+            if( list.current_index( ) != target ) return false;
+            if( list.get( )->to_string( ) != model[target] ) return false;
+        }
+        return true;
+    }
+
+    // Supplies numbered lines and remembers how many it has supplied.
+    class CountingSource : public LineSource {
+    public:
+        CountingSource( int total, int &supplied ) : total( total ), supplied( supplied )
+            { supplied = 0; }
+
+        EditBuffer *next_line( )
+        {
+            if( supplied == total ) return NULL;
+            return new EditBuffer( std::to_string( supplied++ ).c_str( ) );
+        }
+
+    private:
+        int  total;
+        int &supplied;
+    };
+
+    // Shows numbered lines and remembers how many lines it has made.
+    class CountingView : public LineView {
+    public:
+        CountingView( long total, long &made ) : total( total ), made( made )
+            { made = 0; }
+
+        bool has_line( long index ) { return( index >= 0  &&  index < total ); }
+        long size( ) { return( total ); }
+
+        EditBuffer *make_line( long index )
+        {
+            ++made;
+            return new EditBuffer( std::to_string( index ).c_str( ) );
+        }
+
+    private:
+        long  total;
+        long &made;
+    };
+
+    void navigation_tests( )
+    {
+        UnitTestManager::UnitTest test( "navigation_tests" );
+
+        EditList list;
+        UNIT_CHECK( list.size( ) == 0 );
+        UNIT_CHECK( list.get( ) == NULL );
+        UNIT_CHECK( list.next( ) == NULL );
+        UNIT_CHECK( list.previous( ) == NULL );
+
+        std::vector< std::string > model;
+        for( int i = 0; i < 1000; ++i ) {
+            model.push_back( std::to_string( i ) );
+            list.insert( new EditBuffer( model.back( ).c_str( ) ) );
+        }
+        UNIT_CHECK( list.current_index( ) == 1000 );
+        UNIT_CHECK( EditList_matches( list, model ) );
+
+        // Out of bounds jumps leave the current point just past the end.
+        list.jump_to( 5000 );
+        UNIT_CHECK( list.current_index( ) == 1000 );
+        UNIT_CHECK( list.get( ) == NULL );
+        list.jump_to( -1 );
+        UNIT_CHECK( list.current_index( ) == 1000 );
+
+        // Long jumps followed by short steps.
+        list.jump_to( 500 );
+        UNIT_CHECK( list.previous( )->to_string( ) == "499" );
+        UNIT_CHECK( list.next( )->to_string( ) == "499" );
+        UNIT_CHECK( list.next( )->to_string( ) == "500" );
+        list.set_end( );
+        UNIT_CHECK( list.previous( )->to_string( ) == "999" );
+    }
+
+    void insert_erase_tests( )
+    {
+        UnitTestManager::UnitTest test( "insert_erase_tests" );
+
+        EditList list;
+        std::vector< std::string > model;
+        std::srand( 42 );
+
+        // Random insertions and erasures at scattered positions.
+        for( int i = 0; i < 5000; ++i ) {
+            const long position = std::rand( ) % ( static_cast< long >( model.size( ) ) + 1 );
+            list.jump_to( position );
+            if( model.empty( ) || std::rand( ) % 3 != 0 ) {
+                const std::string text = "line " + std::to_string( i );
+                list.insert( new EditBuffer( text.c_str( ) ) );
+                model.insert( model.begin( ) + position, text );
+                UNIT_CHECK( list.current_index( ) == position + 1 );
+            }
+            else if( position < static_cast< long >( model.size( ) ) ) {
+                delete list.get( );
+                list.erase( );
+                model.erase( model.begin( ) + position );
+                UNIT_CHECK( list.current_index( ) == position );
+            }
+        }
+        UNIT_CHECK( EditList_matches( list, model ) );
+
+        // Erase everything from the front.
+        list.jump_to( 0 );
+        while( list.get( ) != NULL ) {
+            delete list.get( );
+            list.erase( );
+        }
+        UNIT_CHECK( list.size( ) == 0 );
+
+        // The list is still usable after being emptied or cleared.
+        list.insert( new EditBuffer( "a" ) );
+        list.insert( new EditBuffer( "b" ) );
+        list.clear( );
+        UNIT_CHECK( list.size( ) == 0 );
+        list.insert( new EditBuffer( "c" ) );
+        UNIT_CHECK( EditList_matches( list, std::vector< std::string >{ "c" } ) );
+    }
+
+    void append_tests( )
+    {
+        UnitTestManager::UnitTest test( "append_tests" );
+
+        // Lines added at the end are put in the tree later. Mix that with other operations.
+        EditList list;
+        std::vector< std::string > model;
+        std::srand( 3 );
+        for( int round = 0; round < 50; ++round ) {
+            list.set_end( );
+            const int count = std::rand( ) % 200;
+            for( int i = 0; i < count; ++i ) {
+                model.push_back( std::to_string( round ) + "." + std::to_string( i ) );
+                list.insert( new EditBuffer( model.back( ).c_str( ) ) );
+            }
+            const long position = std::rand( ) % ( static_cast< long >( model.size( ) ) + 1 );
+            list.jump_to( position );
+            if( round % 2 == 0 && position < static_cast< long >( model.size( ) ) ) {
+                delete list.get( );
+                list.erase( );
+                model.erase( model.begin( ) + position );
+            }
+            else {
+                list.insert( new EditBuffer( "middle" ) );
+                model.insert( model.begin( ) + position, "middle" );
+            }
+        }
+        UNIT_CHECK( EditList_matches( list, model ) );
+    }
+
+    void ownership_tests( )
+    {
+        UnitTestManager::UnitTest test( "ownership_tests" );
+
+        EditList list1;
+        EditList list2;
+        std::vector< std::string > model1;
+        std::vector< std::string > model2;
+        for( int i = 0; i < 10; ++i ) {
+            model1.push_back( "first list line number " + std::to_string( i ) );
+            list1.insert( new EditBuffer( model1.back( ).c_str( ) ) );
+            model2.push_back( std::to_string( i ) );
+            list2.insert( new EditBuffer( model2.back( ).c_str( ) ) );
+        }
+
+        // Releasing a line transfers ownership without deleting it.
+        list1.jump_to( 3 );
+        EditBuffer *line = list1.release( );
+        UNIT_CHECK( line->to_string( ) == model1[3] );
+        UNIT_CHECK( list1.current_index( ) == 3 );
+        model1.erase( model1.begin( ) + 3 );
+        UNIT_CHECK( EditList_matches( list1, model1 ) );
+        delete line;
+        list1.set_end( );
+        UNIT_CHECK( list1.release( ) == NULL );
+
+        // Taking all the lines of another list.
+        list1.jump_to( 2 );
+        list1.take( list2 );
+        UNIT_CHECK( list1.current_index( ) == 12 );
+        UNIT_CHECK( list2.size( ) == 0 );
+        model1.insert( model1.begin( ) + 2, model2.begin( ), model2.end( ) );
+        UNIT_CHECK( EditList_matches( list1, model1 ) );
+
+        // Sharing the text makes every nonempty line borrowed without changing it.
+        list1.jump_to( 0 );
+        list1.insert( new EditBuffer );
+        model1.insert( model1.begin( ), "" );
+        list1.jump_to( 5 );
+        list1.share_text( );
+        UNIT_CHECK( list1.current_index( ) == 5 );
+        UNIT_CHECK( EditList_matches( list1, model1 ) );
+        list1.jump_to( 1 );
+        while( ( line = list1.next( ) ) != NULL ) {
+            UNIT_CHECK( line->is_borrowed( ) );
+        }
+        list1.jump_to( 1 );
+        EditBuffer copy( *list1.get( ) );
+        UNIT_CHECK( copy.is_borrowed( ) );
+        list1.get( )->append( '!' );
+        UNIT_CHECK( !list1.get( )->is_borrowed( ) );
+        UNIT_CHECK( copy.to_string( ) == model1[1] );
+    }
+
+    void splice_tests( )
+    {
+        UnitTestManager::UnitTest test( "splice_tests" );
+
+        EditList list1;
+        EditList list2;
+        std::vector< std::string > model1;
+        std::vector< std::string > model2;
+        for( int i = 0; i < 2000; ++i ) {
+            model1.push_back( "a" + std::to_string( i ) );
+            list1.insert( new EditBuffer( model1.back( ).c_str( ) ) );
+            model2.push_back( "b" + std::to_string( i ) );
+            list2.insert( new EditBuffer( model2.back( ).c_str( ) ) );
+        }
+
+        // A range in the middle of one list goes to the middle of the other.
+        list1.jump_to( 100 );
+        list2.jump_to( 700 );
+        list1.splice( list2, 500 );
+        UNIT_CHECK( list1.current_index( ) == 600 );
+        UNIT_CHECK( list1.get( )->to_string( ) == "a100" );
+        UNIT_CHECK( list2.current_index( ) == 700 );
+        UNIT_CHECK( list2.get( )->to_string( ) == "b1200" );
+        model1.insert( model1.begin( ) + 100, model2.begin( ) + 700, model2.begin( ) + 1200 );
+        model2.erase( model2.begin( ) + 700, model2.begin( ) + 1200 );
+        UNIT_CHECK( EditList_matches( list1, model1 ) );
+        UNIT_CHECK( EditList_matches( list2, model2 ) );
+
+        // Asking for more than remains moves only what remains. Asking for nothing does nothing.
+        list2.jump_to( 1400 );
+        list1.set_end( );
+        list1.splice( list2, 1000 );
+        model1.insert( model1.end( ), model2.begin( ) + 1400, model2.end( ) );
+        model2.erase( model2.begin( ) + 1400, model2.end( ) );
+        list1.splice( list2, 10 );
+        list1.splice( list2, 0 );
+        list1.splice( list1, 10 );
+        UNIT_CHECK( EditList_matches( list1, model1 ) );
+        UNIT_CHECK( EditList_matches( list2, model2 ) );
+
+        // Random ranges back and forth.
+        bool positioned = true;
+        std::srand( 7 );
+        for( int i = 0; i < 200; ++i ) {
+            EditList                   &from       = ( i % 2 == 0 ) ? list1  : list2;
+            EditList                   &to         = ( i % 2 == 0 ) ? list2  : list1;
+            std::vector< std::string > &from_model = ( i % 2 == 0 ) ? model1 : model2;
+            std::vector< std::string > &to_model   = ( i % 2 == 0 ) ? model2 : model1;
+            const long from_size = static_cast< long >( from_model.size( ) );
+            const long to_size   = static_cast< long >( to_model.size( ) );
+            const long start     = std::rand( ) % ( from_size + 1 );
+            const long count     = std::rand( ) % ( from_size - start + 1 );
+            const long target    = std::rand( ) % ( to_size + 1 );
+            from.jump_to( start );
+            to.jump_to( target );
+            to.splice( from, count );
+            to_model.insert(
+                to_model.begin( ) + target,
+                from_model.begin( ) + start, from_model.begin( ) + start + count );
+            from_model.erase( from_model.begin( ) + start, from_model.begin( ) + start + count );
+            if( to.current_index( ) != target + count ) positioned = false;
+        }
+        UNIT_CHECK( positioned );
+        UNIT_CHECK( EditList_matches( list1, model1 ) );
+        UNIT_CHECK( EditList_matches( list2, model2 ) );
+    }
+
+    void source_tests( )
+    {
+        UnitTestManager::UnitTest test( "source_tests" );
+
+        std::vector< std::string > model;
+        for( int i = 0; i < 10000; ++i ) {
+            model.push_back( std::to_string( i ) );
+        }
+
+        // Lines are taken only as they are reached.
+        int supplied;
+        EditList list;
+        list.set_source( new CountingSource( 10000, supplied ) );
+        UNIT_CHECK( list.has_source( ) );
+        UNIT_CHECK( supplied == 0 );
+        list.jump_to( 0 );
+        UNIT_CHECK( list.get( )->to_string( ) == "0" );
+        UNIT_CHECK( supplied > 0 && supplied < 10000 );
+        list.jump_to( 5000 );
+        UNIT_CHECK( supplied >= 5001 && supplied < 10000 );
+        UNIT_CHECK( list.get( )->to_string( ) == "5000" );
+
+        // Editing the lines that have been taken doesn't disturb the others.
+        list.insert( new EditBuffer( "new" ) );
+        model.insert( model.begin( ) + 5000, "new" );
+        delete list.release( );
+        model.erase( model.begin( ) + 5001 );
+        UNIT_CHECK( supplied < 10000 );
+        const int taken = supplied;
+        list.jump_to( taken );
+        list.insert( new EditBuffer( "at the edge" ) );
+        model.insert( model.begin( ) + taken, "at the edge" );
+        UNIT_CHECK( list.fill_more( 100 ) );
+
+        // Asking for the size takes everything.
+        UNIT_CHECK( list.size( ) == 10001 );
+        UNIT_CHECK( supplied == 10000 );
+        UNIT_CHECK( !list.has_source( ) );
+        UNIT_CHECK( EditList_matches( list, model ) );
+
+        // Walking off the end or splicing takes lines as needed.
+        EditList list2;
+        list2.set_source( new CountingSource( 3000, supplied ) );
+        list2.jump_to( 0 );
+        int count = 0;
+        while( list2.next( ) != NULL ) ++count;
+        UNIT_CHECK( count == 3000 );
+        UNIT_CHECK( !list2.has_source( ) );
+
+        list2.clear( );
+        list2.set_source( new CountingSource( 3000, supplied ) );
+        list2.jump_to( 10 );
+        list.set_end( );
+        list.splice( list2, 2500 );
+        UNIT_CHECK( list.size( ) == 12501 );
+        UNIT_CHECK( list.get( ) == NULL );
+        UNIT_CHECK( list.previous( )->to_string( ) == "2509" );
+        UNIT_CHECK( list2.size( ) == 500 );
+
+        // Clearing a list discards its source.
+        list2.clear( );
+        list2.set_source( new CountingSource( 3000, supplied ) );
+        list2.clear( );
+        UNIT_CHECK( supplied == 0 );
+        UNIT_CHECK( list2.size( ) == 0 );
+    }
+
+    void view_tests( )
+    {
+        UnitTestManager::UnitTest test( "view_tests" );
+
+        long made;
+        std::vector< std::string > model;
+        for( int i = 0; i < 100000; ++i ) model.push_back( std::to_string( i ) );
+
+        EditList list;
+        list.set_view( new CountingView( 100000, made ) );
+        UNIT_CHECK( list.has_view( ) );
+        UNIT_CHECK( made == 0 );
+        UNIT_CHECK( EditList_matches( list, model ) );
+
+        // Lines in use are kept; others are made again.
+        list.jump_to( 500 );
+        EditBuffer *const line = list.get( );
+        const long before = made;
+        UNIT_CHECK( list.next( ) == line );
+        UNIT_CHECK( list.previous( ) == line );
+        UNIT_CHECK( list.previous( )->to_string( ) == "499" );
+        UNIT_CHECK( list.current_index( ) == 499 );
+        UNIT_CHECK( made == before + 1 );
+
+        // The list can't be changed.
+        EditBuffer extra( "extra" );
+        UNIT_CHECK( list.insert( &extra ) == NULL );
+        UNIT_CHECK( list.release( ) == NULL );
+        list.erase( );
+        UNIT_CHECK( list.get( )->to_string( ) == "499" );
+        UNIT_CHECK( list.size( ) == 100000 );
+
+        // Jumping out of bounds goes to the end.
+        list.jump_to( 100000 );
+        UNIT_CHECK( list.current_index( ) == 100000 );
+        UNIT_CHECK( list.get( ) == NULL );
+        UNIT_CHECK( list.next( ) == NULL );
+        UNIT_CHECK( list.previous( )->to_string( ) == "99999" );
+        list.jump_to( -1 );
+        UNIT_CHECK( list.current_index( ) == 100000 );
+
+        // Lines can be copied out of a view.
+        EditList copies;
+        list.jump_to( 10 );
+        for( int i = 0; i < 5; ++i ) copies.insert( new EditBuffer( *list.next( ) ) );
+        copies.jump_to( 4 );
+        UNIT_CHECK( copies.get( )->to_string( ) == "14" );
+
+        list.clear( );
+        UNIT_CHECK( !list.has_view( ) );
+        UNIT_CHECK( list.size( ) == 0 );
+    }
+
+}
+
+
 bool EditList_tests( )
 {
-     return true;
+    navigation_tests( );
+    insert_erase_tests( );
+    append_tests( );
+    ownership_tests( );
+    splice_tests( );
+    source_tests( );
+    view_tests( );
+    return true;
 }
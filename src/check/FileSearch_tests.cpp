@@ -0,0 +1,198 @@
+/*! \file    FileSearch_tests.cpp
+ *  \brief   Unit tests of the functions that search many files at once.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "environ.hpp"
+
+#if eOPSYS == ePOSIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// From Y.
+#include "EditBuffer.hpp"
+#include "FileSearch.hpp"
+#include "SearchPattern.hpp"
+
+// From SpicaCpp.
+#include "UnitTestManager.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+    // Searches the targets one line after another on this thread.
+    std::vector< std::string > reference_search(
+        const SearchPattern &pattern, const std::vector< SearchTarget > &targets )
+    {
+        std::vector< std::string > result;
+        for( const SearchTarget &target : targets ) {
+            for( std::size_t i = 0; i < target.lines.size( ); ++i ) {
+                std::size_t match_length;
+                const std::size_t offset = target.lines[i].find( pattern, 0, match_length );
+                if( offset != SearchPattern::npos ) {
+                    result.push_back( format_match(
+                        target.name, static_cast< long >( i ), offset,
+                        target.lines[i].to_string( ) ) );
+                }
+            }
+        }
+        return( result );
+    }
+
+    void format_tests( )
+    {
+        UnitTestManager::UnitTest test( "format_tests" );
+
+        std::string name;
+        long line;
+        long column;
+
+        UNIT_CHECK( format_match( "a.cpp", 9, 4, "int x;" ) == "a.cpp:10:5: int x;" );
+        UNIT_CHECK( parse_match( "a.cpp:10:5: int x;", name, line, column ) );
+        UNIT_CHECK( name == "a.cpp"  &&  line == 9  &&  column == 4 );
+
+        // The column is optional and names can contain colons.
+        UNIT_CHECK( parse_match( "C:\\Y\\b.hpp:3: error", name, line, column ) );
+        UNIT_CHECK( name == "C:\\Y\\b.hpp"  &&  line == 2  &&  column == 0 );
+        UNIT_CHECK( parse_match( "x:y.txt:7:12:", name, line, column ) );
+        UNIT_CHECK( name == "x:y.txt"  &&  line == 6  &&  column == 11 );
+
+        UNIT_CHECK( !parse_match( "no location here", name, line, column ) );
+        UNIT_CHECK( !parse_match( "a.cpp:12 text", name, line, column ) );
+        UNIT_CHECK( !parse_match( "a.cpp:0: text", name, line, column ) );
+    }
+
+    void search_tests( )
+    {
+        UnitTestManager::UnitTest test( "search_tests" );
+
+        // Several files of different sizes. Some are larger than the pieces searched.
+        std::vector< SearchTarget > targets( 5 );
+        for( std::size_t i = 0; i < targets.size( ); ++i ) {
+            char name[32];
+            std::sprintf( name, "file%zu.txt", i );
+            targets[i].name = name;
+
+            const long size = ( i == 2 ) ? 0 : 3000L * static_cast< long >( i * i + 1 );
+            for( long line = 0; line < size; ++line ) {
+                char text[64];
+                std::sprintf( text, "line %ld with value %ld", line, ( line * 7919 ) % 1000 );
+                targets[i].lines.push_back( EditBuffer( text ) );
+            }
+        }
+
+        const SearchPattern text( "value 42" );
+        const SearchPattern expression( "value (1|2)3+$", true );
+        const SearchPattern missing( "nothing" );
+        for( unsigned threads = 1; threads <= 4; ++threads ) {
+            const std::vector< std::string > found = search_targets( text, targets, threads );
+            UNIT_CHECK( !found.empty( )  &&  found == reference_search( text, targets ) );
+            UNIT_CHECK( search_targets( expression, targets, threads ) ==
+                        reference_search( expression, targets ) );
+            UNIT_CHECK( search_targets( missing, targets, threads ).empty( ) );
+        }
+
+        // The default is a thread for each processor.
+        UNIT_CHECK( search_targets( text, targets ) == reference_search( text, targets ) );
+        UNIT_CHECK( search_targets( text, std::vector< SearchTarget >( ) ).empty( ) );
+    }
+
+
+    #if eOPSYS == ePOSIX
+    // Writes a file for tree_tests.
+    void write_file( const std::string &name, const char *text, std::size_t length )
+    {
+        std::FILE *file = std::fopen( name.c_str( ), "wb" );
+        if( file == NULL ) return;
+        std::fwrite( text, 1, length, file );
+        std::fclose( file );
+    }
+
+
+    // Searches a directory tree, waiting for the search to finish, and sorts the results.
+    std::vector< std::string > search_tree(
+        const SearchPattern &pattern, const std::string &directory, const char *wild_name,
+        unsigned threads )
+    {
+        std::vector< std::string > result;
+        TreeSearch search( pattern, directory, wild_name, threads );
+        UNIT_CHECK( search.started( ) );
+        while( !search.take_results( result ) ) usleep( 1000 );
+        std::sort( result.begin( ), result.end( ) );
+        return( result );
+    }
+
+
+    void tree_tests( )
+    {
+        UnitTestManager::UnitTest test( "tree_tests" );
+
+        char directory[] = "/tmp/Ycheck.XXXXXX";
+        if( mkdtemp( directory ) == NULL ) {
+            UNIT_CHECK( false );
+            return;
+        }
+        const std::string top( directory );
+        mkdir( ( top + "/sub" ).c_str( ), 0700 );
+        mkdir( ( top + "/sub/deeper" ).c_str( ), 0700 );
+        mkdir( ( top + "/.hidden" ).c_str( ), 0700 );
+
+        // Tabs are expanded so the columns are those the user sees. The last line has no end.
+        const char a[] = "first line\n\tneedle here\nthird\n";
+        const char b[] = "needle\nno\nneedle again";
+        const char binary[] = "needle\0\n";
+        write_file( top + "/a.txt", a, sizeof( a ) - 1 );
+        write_file( top + "/sub/b.txt", b, sizeof( b ) - 1 );
+        write_file( top + "/sub/deeper/c.txt", b, sizeof( b ) - 1 );
+        write_file( top + "/sub/deeper/d.dat", b, sizeof( b ) - 1 );
+        write_file( top + "/sub/binary.txt", binary, sizeof( binary ) - 1 );
+        write_file( top + "/.hidden/e.txt", b, sizeof( b ) - 1 );
+        write_file( top + "/empty.txt", "", 0 );
+
+        // Opening a named pipe would wait for a writer. It must be skipped.
+        mkfifo( ( top + "/pipe.txt" ).c_str( ), 0600 );
+
+        std::vector< std::string > expected;
+        expected.push_back( top + "/a.txt:2:9: " + std::string( 8, ' ' ) + "needle here" );
+        expected.push_back( top + "/sub/b.txt:1:1: needle" );
+        expected.push_back( top + "/sub/b.txt:3:1: needle again" );
+        expected.push_back( top + "/sub/deeper/c.txt:1:1: needle" );
+        expected.push_back( top + "/sub/deeper/c.txt:3:1: needle again" );
+        std::sort( expected.begin( ), expected.end( ) );
+
+        const SearchPattern text( "needle" );
+        const SearchPattern expression( "ne+dle", true );
+        const SearchPattern missing( "nothing" );
+        for( unsigned threads = 1; threads <= 4; ++threads ) {
+            UNIT_CHECK( search_tree( text, top, "*.txt", threads ) == expected );
+            UNIT_CHECK( search_tree( expression, top, "*.txt", threads ) == expected );
+            UNIT_CHECK( search_tree( missing, top, "*", threads ).empty( ) );
+        }
+        UNIT_CHECK( search_tree( text, top, "*.dat", 0 ).size( ) == 2 );
+        UNIT_CHECK( search_tree( text, top + "/none", "*", 0 ).empty( ) );
+
+        const std::string command = "rm -rf " + top;
+        std::system( command.c_str( ) );
+    }
+    #endif
+
+}
+
+
+bool FileSearch_tests( )
+{
+    format_tests( );
+    search_tests( );
+    #if eOPSYS == ePOSIX
+    tree_tests( );
+    #endif
+    return true;
+}
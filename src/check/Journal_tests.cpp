@@ -0,0 +1,224 @@
+/*! \file    Journal_tests.cpp
+ *  \brief   Unit tests of class Journal.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * Replaying a journal rewrites the user's text when Y starts, so these tests check that the
+ * operations recorded are made exactly and that journals which are incomplete, damaged, or for
+ * another version of the file are handled as documented.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// From Y.
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "Journal.hpp"
+
+// From SpicaCpp.
+#include "UnitTestManager.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+    const char *const journal_name = "Journal_tests.yjy";
+
+    // Adds lines to the end of a list.
+    void fill_list( EditList &list, const std::vector< std::string > &model )
+    {
+        list.set_end( );
+        for( const std::string &text : model ) {
+            list.insert( new EditBuffer( text.c_str( ) ) );
+        }
+    }
+
+    // Returns true if the list holds the same lines as the model.
+    bool list_matches( EditList &list, const std::vector< std::string > &model )
+    {
+        if( list.size( ) != static_cast< long >( model.size( ) ) ) return false;
+        list.jump_to( 0 );
+        for( const std::string &text : model ) {
+            EditBuffer *const line = list.next( );
+            if( line == NULL  ||  line->to_string( ) != text ) return false;
+        }
+        return true;
+    }
+
+    // Reads an entire file into a string.
+    std::string read_file( const char *name )
+    {
+        std::string result;
+        std::FILE *const file = std::fopen( name, "rb" );
+        if( file == NULL ) return result;
+        char buffer[256];
+        std::size_t count;
+        while( ( count = std::fread( buffer, 1, sizeof( buffer ), file ) ) > 0 ) {
+            result.append( buffer, count );
+        }
+        std::fclose( file );
+        return result;
+    }
+
+    // Replaces a file with the given data.
+    void write_file( const char *name, const std::string &data )
+    {
+        std::FILE *const file = std::fopen( name, "wb" );
+        if( file == NULL ) return;
+        std::fwrite( data.data( ), 1, data.size( ), file );
+        std::fclose( file );
+    }
+
+    // Returns the header of a journal with the given digest, written by process zero.
+    std::string header( std::uint64_t digest )
+    {
+        std::string result( "YJY1" );
+        for( int i = 0; i < 8; ++i ) result.push_back( static_cast< char >( digest >> 8 * i ) );
+        result.push_back( '\0' );
+        return result;
+    }
+
+    void round_trip_tests( )
+    {
+        UnitTestManager::UnitTest test( "round_trip_tests" );
+
+        const std::vector< std::string > base = { "one", "two", "three" };
+        const std::uint64_t digest = Journal::digest( { 1, 2, 3 } );
+        std::remove( journal_name );
+
+        // Edit a copy of the base version, recording each operation.
+        EditList edited;
+        fill_list( edited, base );
+        std::size_t first_size;
+        {
+            Journal journal( journal_name, digest );
+            UNIT_CHECK( !journal.pending( ) );
+
+            // Changes to a line are combined; only the final text is recorded.
+            edited.jump_to( 1 );
+            EditBuffer *const line = edited.get( );
+            *line = EditBuffer( "TWO" );
+            journal.changed( 1, line );
+            line->append( '!' );
+            journal.changed( 1, line );
+            UNIT_CHECK( journal.pending( ) );
+
+            edited.set_end( );
+            edited.insert( new EditBuffer( "four" ) );
+            edited.insert( new EditBuffer( "" ) );
+            edited.jump_to( 3 );
+            journal.inserted( 3, 2, edited );
+
+            journal.deleted( 0, 1 );
+            edited.jump_to( 0 );
+            delete edited.release( );
+
+            UNIT_CHECK( journal.flush( edited.size( ) ) );
+            UNIT_CHECK( !journal.pending( ) );
+            first_size = read_file( journal_name ).size( );
+
+            // Operations recorded after a flush are added to the same file.
+            edited.jump_to( 0 );
+            EditBuffer *const first = edited.get( );
+            *first = EditBuffer( "a longer text for the first line" );
+            journal.changed( 0, first );
+            journal.deleted( 3, 1 );
+            edited.jump_to( 3 );
+            delete edited.release( );
+            UNIT_CHECK( journal.flush( edited.size( ) ) );
+        }
+        const std::vector< std::string > first_model = { "TWO!", "three", "four", "" };
+        const std::vector< std::string > final_model =
+            { "a longer text for the first line", "three", "four" };
+        UNIT_CHECK( list_matches( edited, final_model ) );
+
+        // Replaying the journal over the base version recreates the edited text.
+        EditList replayed;
+        fill_list( replayed, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, replayed ) == Journal::REPLAYED );
+        UNIT_CHECK( list_matches( replayed, final_model ) );
+
+        // A record cut off in the middle of a field (Y died while writing it) is ignored. The
+        // operations before it are made.
+        const std::string data = read_file( journal_name );
+        UNIT_CHECK( data.size( ) > first_size + 4 );
+        write_file( journal_name, data.substr( 0, first_size + 4 ) );
+        EditList truncated;
+        fill_list( truncated, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, truncated ) == Journal::REPLAYED );
+        UNIT_CHECK( list_matches( truncated, first_model ) );
+
+        // Even a record with only its type is ignored.
+        write_file( journal_name, data.substr( 0, first_size + 1 ) );
+        EditList type_only;
+        fill_list( type_only, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, type_only ) == Journal::REPLAYED );
+        UNIT_CHECK( list_matches( type_only, first_model ) );
+
+        std::remove( journal_name );
+    }
+
+    void damage_tests( )
+    {
+        UnitTestManager::UnitTest test( "damage_tests" );
+
+        const std::vector< std::string > base = { "one", "two", "three" };
+        const std::uint64_t digest = 0x0123456789ABCDEFULL;
+
+        // An index past the end of the text. The operation before it is made.
+        write_file( journal_name, header( digest ) + "S\x01\x01X" + "D\x05\x01" );
+        EditList out_of_range;
+        fill_list( out_of_range, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, out_of_range ) == Journal::DAMAGED );
+        UNIT_CHECK( list_matches( out_of_range, { "one", "X", "three" } ) );
+
+        // Deleting more lines than there are, inserting past the end, and setting a line that
+        // doesn't exist.
+        const char *const damaged[] = { "D\x01\x03", "I\x04\x01\x01Y", "S\x03\x01Z" };
+        for( const char *record : damaged ) {
+            write_file( journal_name, header( digest ) + record );
+            EditList lines;
+            fill_list( lines, base );
+            UNIT_CHECK( Journal::replay( journal_name, digest, lines ) == Journal::DAMAGED );
+            UNIT_CHECK( list_matches( lines, base ) );
+        }
+
+        // A checkpoint that disagrees with the number of lines, and an unknown record type.
+        write_file( journal_name, header( digest ) + "C\x02" );
+        EditList wrong_count;
+        fill_list( wrong_count, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, wrong_count ) == Journal::DAMAGED );
+        write_file( journal_name, header( digest ) + "Q" );
+        EditList unknown;
+        fill_list( unknown, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, unknown ) == Journal::DAMAGED );
+
+        // A journal for another version of the file is not replayed at all.
+        write_file( journal_name, header( digest ) + std::string( "S\0\1X", 4 ) );
+        EditList mismatched;
+        fill_list( mismatched, base );
+        UNIT_CHECK(
+            Journal::replay( journal_name, digest + 1, mismatched ) == Journal::MISMATCHED );
+        UNIT_CHECK( list_matches( mismatched, base ) );
+
+        // Nor is a file that isn't a journal, or one that doesn't exist.
+        write_file( journal_name, "not a journal" );
+        EditList not_journal;
+        fill_list( not_journal, base );
+        UNIT_CHECK( Journal::replay( journal_name, digest, not_journal ) == Journal::MISSING );
+        std::remove( journal_name );
+        UNIT_CHECK( Journal::replay( journal_name, digest, not_journal ) == Journal::MISSING );
+        UNIT_CHECK( list_matches( not_journal, base ) );
+    }
+
+}
+
+
+bool Journal_tests( )
+{
+    round_trip_tests( );
+    damage_tests( );
+    return true;
+}
@@ -0,0 +1,218 @@
+/*! \file    RegularExpression_tests.cpp
+ *  \brief   Unit tests of class RegularExpression.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+#include <string>
+
+// From Y.
+#include "EditBuffer.hpp"
+#include "RegularExpression.hpp"
+#include "SearchPattern.hpp"
+
+// From SpicaCpp.
+#include "UnitTestManager.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+    // Searches a string, returning true if there is a match at the expected place.
+    bool matches( const char *pattern, const char *text, std::size_t start, std::size_t length )
+    {
+        const RegularExpression expression( pattern );
+        std::size_t match_start;
+        std::size_t match_length;
+        if( !expression.search(
+                text, std::strlen( text ), NULL, 0, 0, match_start, match_length ) ) return false;
+        return( match_start == start  &&  match_length == length );
+    }
+
+    // Returns true if the pattern doesn't match the text.
+    bool misses( const char *pattern, const char *text )
+    {
+        const RegularExpression expression( pattern );
+        std::size_t match_start;
+        std::size_t match_length;
+        return( !expression.search(
+            text, std::strlen( text ), NULL, 0, 0, match_start, match_length ) );
+    }
+
+    // Finds the leftmost longest match the slow way, using std::regex to test each substring.
+    std::size_t reference_search(
+        const std::regex &expression, bool start_anchored, bool end_anchored,
+        const std::string &text, std::size_t start, std::size_t &match_length )
+    {
+        for( std::size_t i = start; i <= text.size( ); ++i ) {
+            if( start_anchored  &&  i != 0 ) break;
+            for( std::size_t j = text.size( ) + 1; j-- > i; ) {
+                if( end_anchored  &&  j != text.size( ) ) continue;
+                if( std::regex_match( text.begin( ) + i, text.begin( ) + j, expression ) ) {
+                    match_length = j - i;
+                    return( i );
+                }
+            }
+        }
+        return( SearchPattern::npos );
+    }
+
+    // Finds the last match starting before end, and the longest there, the slow way.
+    std::size_t reference_search_backward(
+        const std::regex &expression, bool start_anchored, bool end_anchored,
+        const std::string &text, std::size_t end, std::size_t &match_length )
+    {
+        for( std::size_t i = end; i-- > 0; ) {
+            const std::size_t found = reference_search(
+                expression, start_anchored, end_anchored, text, i, match_length );
+            if( found == i ) return( i );
+        }
+        return( SearchPattern::npos );
+    }
+
+    void syntax_tests( )
+    {
+        UnitTestManager::UnitTest test( "syntax_tests" );
+
+        UNIT_CHECK( RegularExpression( "a(b|c)*d" ).error( ) == NULL );
+        UNIT_CHECK( RegularExpression( "(ab" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "ab)" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "*a" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "[ab" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "[z-a]" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "a{3,2}" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "a{2000}" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "ab\\" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "a*" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "a|" ).error( ) != NULL );
+        UNIT_CHECK( RegularExpression( "((a{50}){50}){50}" ).error( ) != NULL );
+
+        UNIT_CHECK( matches( "cat", "the cat sat", 4, 3 ) );
+        UNIT_CHECK( matches( "c.t", "the cot sat", 4, 3 ) );
+        UNIT_CHECK( matches( "[a-c]+", "xxbcaby", 2, 4 ) );
+        UNIT_CHECK( matches( "[^a-c ]+", "abc def", 4, 3 ) );
+        UNIT_CHECK( matches( "[]x]+", "a]x]b", 1, 3 ) );
+        UNIT_CHECK( matches( "[a-]+", "b-a-c", 1, 3 ) );
+        UNIT_CHECK( matches( "\\d+", "line 1234 here", 5, 4 ) );
+        UNIT_CHECK( matches( "\\w+", "  foo_bar2 ", 2, 8 ) );
+        UNIT_CHECK( matches( "\\s\\S", "ab\tc", 2, 2 ) );
+        UNIT_CHECK( matches( "[\\d.]+", "x3.14y", 1, 4 ) );
+        UNIT_CHECK( matches( "a\\.b", "axb a.b", 4, 3 ) );
+        UNIT_CHECK( matches( "x{2}", "xaxxx", 2, 2 ) );
+        UNIT_CHECK( matches( "x{2,}", "xaxxxx", 2, 4 ) );
+        UNIT_CHECK( matches( "x{1,2}y", "xxxy", 1, 3 ) );
+        UNIT_CHECK( matches( "a{b", "xa{b", 1, 3 ) );
+        UNIT_CHECK( matches( "(foo|foobar)baz", "foobarbaz", 0, 9 ) );
+        UNIT_CHECK( matches( "^abc", "abcabc", 0, 3 ) );
+        UNIT_CHECK( misses( "^abc", "xabc" ) );
+        UNIT_CHECK( matches( "abc$", "abcabc", 3, 3 ) );
+        UNIT_CHECK( misses( "abc$", "abcx" ) );
+        UNIT_CHECK( matches( "a\\$", "xa$", 1, 2 ) );
+        UNIT_CHECK( matches( "a^b", "a^b", 0, 3 ) );
+        UNIT_CHECK( matches( "^(a|b)+$", "abba", 0, 4 ) );
+    }
+
+    void search_tests( )
+    {
+        UnitTestManager::UnitTest test( "search_tests" );
+
+        // Expressions whose automata have many states, for which std::regex is still fast.
+        const char *const patterns[] = {
+            "a(b|c)*d", "(ab|a)(bc|c)", "[ab]+c?", "b(a|b)*a", "^a*b", "(a|b)*c$", "a[abc]{3}b",
+            "(aa|b)+", "c{2,3}", "(a|ab)(c|bcd)(d*)", "[^c]b", "^c", "a$", "(ab)?c|bc"
+        };
+
+        std::srand( 11 );
+        bool agrees = true;
+        for( const char *pattern : patterns ) {
+            const bool start_anchored = ( pattern[0] == '^' );
+            const std::size_t length = std::strlen( pattern );
+            const bool end_anchored = ( pattern[length - 1] == '$' );
+            const std::regex reference( std::string( pattern + start_anchored,
+                length - start_anchored - end_anchored ), std::regex::extended );
+            const SearchPattern compiled( pattern, true );
+
+            for( int trial = 0; trial < 50; ++trial ) {
+                std::string text( std::rand( ) % 24, 'a' );
+                for( char &ch : text ) ch = static_cast< char >( 'a' + std::rand( ) % 4 );
+
+                // Search the text stored with a gap at some random place.
+                EditBuffer line( text.c_str( ) );
+                const std::size_t position = std::rand( ) % ( text.size( ) + 1 );
+                line.insert( 'x', position );
+                line.erase( position );
+
+                for( std::size_t start = 0; start <= text.size( ); ++start ) {
+                    std::size_t expected_length = 0;
+                    std::size_t match_length = 0;
+                    const std::size_t expected = reference_search(
+                        reference, start_anchored, end_anchored, text, start, expected_length );
+                    const std::size_t found = line.find( compiled, start, match_length );
+                    if( found != expected ) agrees = false;
+                    if( found != SearchPattern::npos  &&  match_length != expected_length )
+                        agrees = false;
+
+                    // Searching backwards from the same place.
+                    const std::size_t expected_last = reference_search_backward(
+                        reference, start_anchored, end_anchored, text, start, expected_length );
+                    const std::size_t last = line.rfind( compiled, start, match_length );
+                    if( last != expected_last ) agrees = false;
+                    if( last != SearchPattern::npos  &&  match_length != expected_length )
+                        agrees = false;
+                }
+            }
+        }
+        UNIT_CHECK( agrees );
+
+        // An expression whose deterministic automata would have more states than are kept. The
+        // backward automaton must remember which of the last 14 characters were b.
+        std::string text( 20000, 'a' );
+        for( char &ch : text ) ch = static_cast< char >( 'a' + std::rand( ) % 2 );
+        const RegularExpression large( "a[ab]{13}b" );
+        std::size_t expected = 3;
+        while( text[expected] != 'a'  ||  text[expected + 14] != 'b' ) ++expected;
+        std::size_t match_start;
+        std::size_t match_length;
+        UNIT_CHECK( large.search(
+            text.data( ), 100, text.data( ) + 100, text.size( ) - 100, 3, match_start,
+            match_length ) );
+        UNIT_CHECK( match_start == expected  &&  match_length == 15 );
+    }
+
+
+    void pattern_tests( )
+    {
+        UnitTestManager::UnitTest test( "pattern_tests" );
+
+        const SearchPattern text( "a.c" );
+        const SearchPattern expression( "a.c", true );
+        UNIT_CHECK( !text.is_regular_expression( )  &&  expression.is_regular_expression( ) );
+        UNIT_CHECK( text.error( ) == NULL  &&  expression.error( ) == NULL );
+        UNIT_CHECK( SearchPattern( "(", true ).error( ) != NULL );
+
+        EditBuffer line( "abc a.c" );
+        std::size_t match_length;
+        UNIT_CHECK( line.find( text ) == 4 );
+        UNIT_CHECK( line.find( expression, 0, match_length ) == 0  &&  match_length == 3 );
+
+        // Copies are compiled again and can be used independently.
+        SearchPattern copy( expression );
+        UNIT_CHECK( copy.is_regular_expression( ) );
+        UNIT_CHECK( line.find( copy, 1 ) == 4 );
+        copy = text;
+        UNIT_CHECK( !copy.is_regular_expression( ) );
+        UNIT_CHECK( line.find( copy ) == 4 );
+    }
+
+}
+
+
+bool RegularExpression_tests( )
+{
+    syntax_tests( );
+    search_tests( );
+    pattern_tests( );
+    return true;
+}
@@ -0,0 +1,130 @@
+/*! \file    SearchPattern_tests.cpp
+ *  \brief   Unit tests of class SearchPattern.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <string>
+
+// From Y.
+#include "EditBuffer.hpp"
+#include "SearchPattern.hpp"
+
+// From SpicaCpp.
+#include "UnitTestManager.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+    // Returns the result std::string::find gives in the form SearchPattern uses.
+    std::size_t reference_find(
+        const std::string &text, const std::string &pattern, std::size_t start )
+    {
+        if( start > text.size( ) ) return SearchPattern::npos;
+        const std::string::size_type found = text.find( pattern, start );
+        return( found == std::string::npos ? SearchPattern::npos : found );
+    }
+
+    // Returns the last occurrence starting before end that std::string::rfind gives.
+    std::size_t reference_rfind(
+        const std::string &text, const std::string &pattern, std::size_t end )
+    {
+        if( end == 0 ) return SearchPattern::npos;
+        const std::string::size_type found = text.rfind( pattern, end - 1 );
+        return( found == std::string::npos ? SearchPattern::npos : found );
+    }
+
+    void find_tests( )
+    {
+        UnitTestManager::UnitTest test( "find_tests" );
+
+        const SearchPattern empty;
+        UNIT_CHECK( empty.find( "abc", 3, 0 ) == 0 );
+        UNIT_CHECK( empty.find( "abc", 3, 3 ) == 3 );
+        UNIT_CHECK( empty.find( "abc", 3, 4 ) == SearchPattern::npos );
+
+        const SearchPattern hello( "Hello" );
+        const std::string text( "Say Hello, then Hello again" );
+        UNIT_CHECK( hello.length( ) == 5 );
+        UNIT_CHECK( hello.find( text.data( ), text.size( ) ) == 4 );
+        UNIT_CHECK( hello.find( text.data( ), text.size( ), 5 ) == 16 );
+        UNIT_CHECK( hello.find( text.data( ), text.size( ), 17 ) == SearchPattern::npos );
+        UNIT_CHECK( hello.find( text.data( ), 8 ) == SearchPattern::npos );
+        UNIT_CHECK( SearchPattern( "H" ).find( text.data( ), text.size( ), 5 ) == 16 );
+        UNIT_CHECK(
+            SearchPattern( "hello" ).find( text.data( ), text.size( ) ) == SearchPattern::npos );
+
+        // Patterns of various lengths at each position of texts with various lengths. The texts
+        // are made of few letters so there are many near misses.
+        std::srand( 3 );
+        bool agrees = true;
+        for( int trial = 0; trial < 2000; ++trial ) {
+            std::string text( std::rand( ) % 80, 'a' );
+            for( char &ch : text ) ch = static_cast< char >( 'a' + std::rand( ) % 3 );
+            std::string pattern( 1 + std::rand( ) % 20, 'a' );
+            for( char &ch : pattern ) ch = static_cast< char >( 'a' + std::rand( ) % 3 );
+            if( !text.empty( )  &&  std::rand( ) % 2 == 0 ) {
+                pattern = text.substr( std::rand( ) % text.size( ), pattern.size( ) );
+            }
+
+            const SearchPattern compiled( pattern );
+            for( std::size_t start = 0; start <= text.size( ) + 1; ++start ) {
+                if( compiled.find( text.data( ), text.size( ), start ) !=
+                    reference_find( text, pattern, start ) ) agrees = false;
+            }
+        }
+        UNIT_CHECK( agrees );
+    }
+
+    void buffer_tests( )
+    {
+        UnitTestManager::UnitTest test( "buffer_tests" );
+
+        EditBuffer line( "the cat sat on the mat" );
+        UNIT_CHECK( line.find( SearchPattern( "the" ) ) == 0 );
+        UNIT_CHECK( line.find( SearchPattern( "the" ), 1 ) == 15 );
+        UNIT_CHECK( line.find( SearchPattern( "dog" ) ) == SearchPattern::npos );
+        UNIT_CHECK( line.find( SearchPattern( "mat" ), 30 ) == SearchPattern::npos );
+
+        std::size_t match_length;
+        UNIT_CHECK( line.rfind( SearchPattern( "the" ), 22, match_length ) == 15 );
+        UNIT_CHECK( line.rfind( SearchPattern( "the" ), 15, match_length ) == 0 );
+        UNIT_CHECK( line.rfind( SearchPattern( "the" ), 0, match_length ) == SearchPattern::npos );
+        UNIT_CHECK( line.rfind( SearchPattern( "at" ), 30, match_length ) == 20 );
+
+        // Matches before, after, and across the gap of a line being edited, with the gap at each
+        // position. Long lines are stored outside the object.
+        const std::string model( "abcabdabcabdabcabcabdabdabcabcabdabcabdabdabcabdabcabdab" );
+        const char *const patterns[] = { "abcab", "dab", "d", "bdabcabda", "cabcabdabdab", "" };
+        bool agrees = true;
+        for( std::size_t length : { std::size_t( 20 ), model.size( ) } ) {
+            const std::string text = model.substr( 0, length );
+            for( std::size_t position = 0; position <= length; ++position ) {
+                EditBuffer edited( text.c_str( ) );
+                edited.insert( 'x', position );
+                edited.erase( position );
+                for( const char *pattern : patterns ) {
+                    const SearchPattern compiled( pattern );
+                    for( std::size_t start = 0; start <= length + 1; ++start ) {
+                        const std::size_t found = edited.find( compiled, start );
+                        if( found != reference_find( text, pattern, start ) ) agrees = false;
+                        std::size_t match_length;
+                        const std::size_t last = edited.rfind( compiled, start, match_length );
+                        if( last != reference_rfind( text, pattern, start ) ) agrees = false;
+                    }
+                }
+            }
+        }
+        UNIT_CHECK( agrees );
+    }
+
+}
+
+
+bool SearchPattern_tests( )
+{
+    find_tests( );
+    buffer_tests( );
+    return true;
+}
@@ -0,0 +1,194 @@
+/*! \file    SlabPool_tests.cpp
+ *  \brief   SlabPool unit tests.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+// From Y.
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "SlabPool.hpp"
+
+// From SpicaCpp.
+#include "UnitTestManager.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+    void allocation_tests( )
+    {
+        UnitTestManager::UnitTest test( "allocation_tests" );
+
+        SlabPool *pool = SlabPool::make( 40 );
+        UNIT_CHECK( pool->statistics( ).slabs == 0 );
+
+        // Fill several slabs with distinct, writable objects.
+        std::vector< void * > objects;
+        std::set< void * > distinct;
+        for( int i = 0; i < 5000; ++i ) {
+            void *object = pool->allocate( );
+            std::memset( object, i & 0xFF, 40 );
+            objects.push_back( object );
+            distinct.insert( object );
+        }
+        UNIT_CHECK( distinct.size( ) == objects.size( ) );
+        UNIT_CHECK( pool->statistics( ).live == 5000 );
+        UNIT_CHECK( pool->statistics( ).allocations == 5000 );
+        UNIT_CHECK( pool->statistics( ).slabs > 1 );
+        UNIT_CHECK( pool->statistics( ).slabs == pool->statistics( ).slab_requests );
+        bool intact = true;
+        for( int i = 0; i < 5000; ++i ) {
+            if( *static_cast< unsigned char * >( objects[i] ) != ( i & 0xFF ) ) intact = false;
+        }
+        UNIT_CHECK( intact );
+
+        // Released objects are reused without obtaining new slabs.
+        const std::size_t requests = pool->statistics( ).slab_requests;
+        for( int i = 0; i < 5000; i += 2 ) {
+            SlabPool::release( objects[i] );
+        }
+        for( int i = 0; i < 5000; i += 2 ) {
+            objects[i] = pool->allocate( );
+        }
+        UNIT_CHECK( pool->statistics( ).slab_requests == requests );
+        UNIT_CHECK( pool->statistics( ).live == 5000 );
+
+        // Empty slabs are given back, except for the last one.
+        for( void *object : objects ) {
+            SlabPool::release( object );
+        }
+        UNIT_CHECK( pool->statistics( ).live == 0 );
+        UNIT_CHECK( pool->statistics( ).slabs == 1 );
+        SlabPool::release( NULL );
+        pool->detach( );
+    }
+
+    void detach_tests( )
+    {
+        UnitTestManager::UnitTest test( "detach_tests" );
+
+        // A detached pool lives until its last object is released.
+        const std::size_t slabs = SlabPool::totals( ).slabs;
+        SlabPool *pool = SlabPool::make( 16 );
+        std::vector< void * > objects;
+        for( int i = 0; i < 10000; ++i ) {
+            objects.push_back( pool->allocate( ) );
+        }
+        UNIT_CHECK( SlabPool::totals( ).slabs > slabs );
+        pool->detach( );
+        for( void *object : objects ) {
+            SlabPool::release( object );
+        }
+        UNIT_CHECK( SlabPool::totals( ).slabs == slabs );
+    }
+
+    void bulk_tests( )
+    {
+        UnitTestManager::UnitTest test( "bulk_tests" );
+
+        SlabPool *pool1 = SlabPool::make( 24 );
+        SlabPool *pool2 = SlabPool::make( 24 );
+        SlabPool *pool3 = SlabPool::make( 48 );
+        std::vector< void * > objects;
+        for( int i = 0; i < 6000; ++i ) {
+            objects.push_back( pool1->allocate( ) );
+        }
+        void *other = pool2->allocate( );
+
+        // Absorbing a pool takes over its slabs and objects.
+        const std::size_t slabs = pool1->statistics( ).slabs + pool2->statistics( ).slabs;
+        UNIT_CHECK( pool2->absorb( *pool1 ) );
+        UNIT_CHECK( pool1->statistics( ).live == 0 );
+        UNIT_CHECK( pool1->statistics( ).slabs == 0 );
+        UNIT_CHECK( pool2->statistics( ).live == 6001 );
+        UNIT_CHECK( pool2->statistics( ).slabs == slabs );
+        UNIT_CHECK( !pool3->absorb( *pool2 ) );
+        UNIT_CHECK( pool2->statistics( ).live == 6001 );
+
+        // Absorbed objects are released to their new pool.
+        for( int i = 0; i < 3000; ++i ) {
+            SlabPool::release( objects[i] );
+        }
+        UNIT_CHECK( pool2->statistics( ).live == 3001 );
+        UNIT_CHECK( pool1->allocate( ) != NULL );
+        UNIT_CHECK( pool1->statistics( ).live == 1 );
+
+        // All slabs, full or not, can be given back at once. The pool is still usable.
+        pool2->release_all( );
+        UNIT_CHECK( pool2->statistics( ).live == 0 );
+        UNIT_CHECK( pool2->statistics( ).slabs == 0 );
+        other = pool2->allocate( );
+        UNIT_CHECK( pool2->statistics( ).live == 1 );
+        SlabPool::release( other );
+
+        pool1->release_all( );
+        pool1->detach( );
+        pool2->detach( );
+        pool3->detach( );
+    }
+
+    void list_tests( )
+    {
+        UnitTestManager::UnitTest test( "list_tests" );
+
+        // Each list allocates nodes from its own pool.
+        const char *const text = "text of a line that is too long to be stored inline";
+        EditList list1;
+        EditList list2;
+        for( int i = 0; i < 3000; ++i ) {
+            list1.insert( new EditBuffer( text ) );
+        }
+        list2.insert( new EditBuffer( text ) );
+        UNIT_CHECK( list1.node_statistics( ).live == 3000 );
+        UNIT_CHECK( list2.node_statistics( ).live == 1 );
+
+        // Moving all the lines of a list moves the slabs holding them as well.
+        list2.take( list1 );
+        UNIT_CHECK( list1.size( ) == 0 );
+        UNIT_CHECK( list1.node_statistics( ).live == 0 );
+        UNIT_CHECK( list1.node_statistics( ).slabs == 0 );
+        UNIT_CHECK( list2.node_statistics( ).live == 3001 );
+
+        // Moving only some of the lines leaves them in their own pool.
+        EditList list3;
+        list3.insert( new EditBuffer );
+        list2.jump_to( 0 );
+        list3.splice( list2, 1000 );
+        UNIT_CHECK( list3.size( ) == 1001 );
+        UNIT_CHECK( list3.node_statistics( ).live == 1 );
+        UNIT_CHECK( list2.node_statistics( ).live == 3001 );
+
+        // Clearing such a list returns each node to the pool it came from.
+        list3.clear( );
+        UNIT_CHECK( list3.node_statistics( ).live == 0 );
+        UNIT_CHECK( list2.node_statistics( ).live == 2001 );
+
+        // A list whose pool holds only its own nodes is cleared by emptying the pool.
+        const std::size_t live = SlabPool::totals( ).live;
+        list2.clear( );
+        UNIT_CHECK( list2.size( ) == 0 );
+        UNIT_CHECK( list2.node_statistics( ).live == 0 );
+        UNIT_CHECK( list2.node_statistics( ).slabs == 0 );
+        UNIT_CHECK( SlabPool::totals( ).live == live - 3 * 2001 );
+
+        // The lists are still usable.
+        list2.insert( new EditBuffer( "again" ) );
+        list1.take( list2 );
+        UNIT_CHECK( list1.size( ) == 1  &&  list1.node_statistics( ).live == 1 );
+    }
+
+}
+
+
+bool SlabPool_tests( )
+{
+    allocation_tests( );
+    detach_tests( );
+    bulk_tests( );
+    list_tests( );
+    return true;
+}
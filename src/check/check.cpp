@@ -29,6 +29,12 @@ int main( int argc, char **argv )
 
     UnitTestManager::register_suite( EditBuffer_tests, "EditBuffer" );
     UnitTestManager::register_suite( EditList_tests, "EditList" );
+    UnitTestManager::register_suite( FileSearch_tests, "FileSearch" );
+    UnitTestManager::register_suite( Journal_tests, "Journal" );
+    UnitTestManager::register_suite( RegularExpression_tests, "RegularExpression" );
+    UnitTestManager::register_suite( SearchPattern_tests, "SearchPattern" );
+    UnitTestManager::register_suite( SlabPool_tests, "SlabPool" );
+    UnitTestManager::register_suite( scan_tests, "scan" );
 
     UnitTestManager::execute_suites( *output, "Y Unit Tests" );
     return UnitTestManager::test_status( );
@@ -8,5 +8,11 @@
 
 bool EditBuffer_tests( );
 bool EditList_tests( );
+bool FileSearch_tests( );
+bool Journal_tests( );
+bool RegularExpression_tests( );
+bool SearchPattern_tests( );
+bool SlabPool_tests( );
+bool scan_tests( );
 
 #endif
@@ -0,0 +1,137 @@
+/*! \file    scan_tests.cpp
+ *  \brief   Unit tests of the fast text scanning functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <string>
+
+// From Y.
+#include "scan.hpp"
+
+// From SpicaCpp.
+#include "UnitTestManager.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+    // The obvious implementation of find_line_special.
+    const char *reference_find( const char *text, const char *end )
+    {
+        while( text != end  &&  *text != '\n'  &&  !is_raw_byte( *text ) ) ++text;
+        return text;
+    }
+
+    void line_special_tests( )
+    {
+        UnitTestManager::UnitTest test( "line_special_tests" );
+
+        UNIT_CHECK( !is_raw_byte( 'a' ) );
+        UNIT_CHECK( !is_raw_byte( ' ' ) );
+        UNIT_CHECK( !is_raw_byte( '\r' ) );
+        UNIT_CHECK(  is_raw_byte( '\t' ) );
+        UNIT_CHECK(  is_raw_byte( '\0' ) );
+        UNIT_CHECK(  is_raw_byte( static_cast< char >( 0x80 ) ) );
+        UNIT_CHECK(  is_raw_byte( static_cast< char >( 0xFF ) ) );
+
+        const std::string empty;
+        UNIT_CHECK( find_line_special( empty.data( ), empty.data( ) ) == empty.data( ) );
+
+        // Each kind of special byte at each position of texts with various lengths and alignments.
+        const char specials[] = { '\n', '\t', '\0', static_cast< char >( 0x80 ), '\xC3' };
+        bool found_all = true;
+        for( const char special : specials ) {
+            for( std::size_t length = 1; length < 70; ++length ) {
+                std::string text( length + 16, 'x' );
+                for( std::size_t offset = 0; offset < 16; ++offset ) {
+                    const char *const start = text.data( ) + offset;
+                    if( find_line_special( start, start + length ) != start + length ) {
+                        found_all = false;
+                    }
+                    for( std::size_t position = 0; position < length; ++position ) {
+                        text[offset + position] = special;
+                        if( find_line_special( start, start + length ) != start + position ) {
+                            found_all = false;
+                        }
+                        text[offset + position] = 'x';
+                    }
+                }
+            }
+        }
+        UNIT_CHECK( found_all );
+
+        // Random text with occasional special bytes agrees with the obvious implementation.
+        std::srand( 11 );
+        std::string text( 100000, ' ' );
+        for( char &ch : text ) {
+            const int choice = std::rand( ) % 200;
+            if     ( choice == 0 ) ch = '\n';
+            else if( choice == 1 ) ch = '\t';
+            else if( choice == 2 ) ch = '\0';
+            else if( choice == 3 ) ch = static_cast< char >( 0x80 + std::rand( ) % 128 );
+            else ch = static_cast< char >( ' ' + std::rand( ) % 95 );
+        }
+        bool agrees = true;
+        const char *const end = text.data( ) + text.size( );
+        for( const char *start = text.data( ); start < end; ) {
+            const char *const found = find_line_special( start, end );
+            if( found != reference_find( start, end ) ) agrees = false;
+            start = found + 1;
+        }
+        UNIT_CHECK( agrees );
+    }
+
+    void trailing_space_tests( )
+    {
+        UnitTestManager::UnitTest test( "trailing_space_tests" );
+
+        const std::string empty;
+        UNIT_CHECK( find_trailing_spaces( empty.data( ), empty.data( ) ) == empty.data( ) );
+
+        // Texts of various lengths and alignments ending in various numbers of spaces.
+        bool found_all = true;
+        for( std::size_t length = 1; length < 70; ++length ) {
+            for( std::size_t offset = 0; offset < 16; ++offset ) {
+                for( std::size_t spaces = 0; spaces <= length; ++spaces ) {
+                    std::string text( offset, 'x' );
+                    text.append( length - spaces, 'a' );
+                    text.append( spaces, ' ' );
+                    if( length - spaces > 2 ) text[offset + ( length - spaces ) / 2] = ' ';
+                    const char *const start = text.data( ) + offset;
+                    const char *const found = find_trailing_spaces( start, start + length );
+                    if( found != start + length - spaces ) found_all = false;
+                }
+            }
+        }
+        UNIT_CHECK( found_all );
+    }
+
+    void cook_tests( )
+    {
+        UnitTestManager::UnitTest test( "cook_tests" );
+
+        std::string result( "old" );
+        cook_text( "", 0, result );
+        UNIT_CHECK( result.empty( ) );
+        cook_text( "plain", 5, result );
+        UNIT_CHECK( result == "plain" );
+
+        // Tabs go to the next stop even when characters before them are removed.
+        const char raw[] = "a\tbc\x80\xC3\tx\0y\t";
+        cook_text( raw, sizeof( raw ) - 1, result );
+        UNIT_CHECK( result == "a       bc      xy      " );
+        cook_text( "\t\r", 2, result );
+        UNIT_CHECK( result == "        \r" );
+    }
+
+}
+
+
+bool scan_tests( )
+{
+    line_special_tests( );
+    trailing_space_tests( );
+    cook_tests( );
+    return true;
+}
@@ -37,6 +37,7 @@ extern bool file_info_command( );
 extern bool file_insert_command( );
 extern bool filter_command( );
 extern bool find_file_command( );
+extern bool follow_file_command( );
 extern bool foreground_color_command( );
 extern bool goto_column_command( );
 extern bool goto_file_end_command( );
@@ -44,7 +45,9 @@ extern bool goto_file_start_command( );
 extern bool goto_line_command( );
 extern bool goto_line_end_command( );
 extern bool goto_line_start_command( );
+extern bool goto_match_command( );
 extern bool help_command( );
+extern bool incremental_search_command( );
 extern bool input_command( );
 extern bool insert_command( );
 extern bool insert_file_command( );
@@ -69,16 +72,21 @@ extern bool remove_file_command( );
 extern bool rename_file_command( );
 extern bool restricted_mode_command( );
 extern bool save_file_command( );
+extern bool search_all_files_command( );
 extern bool search_and_replace_command( );
 extern bool search_first_command( );
 extern bool search_next_command( );
+extern bool search_previous_command( );
+extern bool search_tree_command( );
 extern bool set_bookmark_command( );
+extern bool set_parallel_load_command( );
 extern bool set_tab_command( );
 extern bool skip_left_command( );
 extern bool skip_right_command( );
 extern bool tab_command( );
 extern bool toggle_block_command( );
 extern bool toggle_bookmark_command( );
+extern bool toggle_regex_command( );
 extern bool yexit_command( );
 
 // Experimental commands and "draft" commands.
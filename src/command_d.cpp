@@ -57,9 +57,10 @@ bool delete_block_command( )
     bool return_value;
     YEditFile &the_file = FileList::active_file( );
 
+    // Move the lines to the clipboard and share their text so that pasting copies none of it.
     clipboard.clear( );
-    return_value = the_file.get_block( clipboard );
-    if( return_value == true ) the_file.delete_block( );
+    return_value = the_file.extract_block( clipboard );
+    clipboard.share_text( );
 
     // Turn off block mode if it's on.
     if( the_file.get_block_state( ) ) the_file.toggle_block( );
@@ -12,21 +12,29 @@
 #include "FileList.hpp"
 #include "global.hpp"
 #include "scr.hpp"
+#include "SlabPool.hpp"
 #include "support.hpp"
 #include "YEditFile.hpp"
 #include "yfile.hpp"
 
 bool filelist_info_command( )
 {
-    error_message( "Not implemented" );
-    return false;
+    const SlabPool::Statistics totals = SlabPool::totals( );
+    info_message(
+        "%u files; %zu objects in %zu slabs; %zu allocations used %zu slab requests",
+        FileList::count( ), totals.live, totals.slabs, totals.allocations, totals.slab_requests );
+    return true;
 }
 
 
 bool file_info_command( )
 {
-    error_message( "Not implemented" );
-    return false;
+    YEditFile &the_file = FileList::active_file( );
+    const SlabPool::Statistics &nodes = the_file.node_statistics( );
+    info_message(
+        "%.40s: %ld lines; %zu nodes in %zu slabs", the_file.name( ), the_file.line_count( ),
+        nodes.live, nodes.slabs );
+    return true;
 }
 
 
@@ -159,6 +167,34 @@ bool find_file_command( )
 }
 
 
+bool follow_file_command( )
+{
+    YEditFile &the_file = FileList::active_file( );
+
+    // If the file is already followed, stop following it.
+    if( the_file.is_following( ) ) {
+        the_file.stop_following( );
+        info_message( "No longer following %s", the_file.name( ) );
+        return true;
+    }
+
+    if( the_file.read_only( ) ) {
+        error_message( "Can't follow %s. It is read only", the_file.name( ) );
+        return false;
+    }
+    if( the_file.changed( ) ) {
+        error_message( "Can't follow %s. It has been changed", the_file.name( ) );
+        return false;
+    }
+
+    // Ask if the cursor should stay at the end of the file as it grows.
+    const bool pinned = confirm_message( "Keep cursor at end of file? [y]/n ", 'n', true );
+    the_file.start_following( the_file.name( ), pinned );
+    if( pinned ) the_file.bottom_of_file( );
+    return true;
+}
+
+
 bool foreground_color_command( )
 {
     YEditFile &the_file = FileList::active_file( );
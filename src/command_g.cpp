@@ -4,9 +4,12 @@
  */
 
 #include <cstdlib>
+#include <string>
 
 #include "FileList.hpp"
+#include "FileSearch.hpp"
 #include "parameter_stack.hpp"
+#include "support.hpp"
 #include "YEditFile.hpp"
 
 bool goto_column_command( )
@@ -60,6 +63,36 @@ bool goto_line_command( )
   }
 
 
+/*!
+ * The current line must describe a match as the lines of a results file do (see
+ * format_match). Compiler error messages usually have the same form. The file named is loaded
+ * if necessary.
+ */
+bool goto_match_command( )
+{
+    const EditBuffer *line = FileList::active_file( ).get_line( );
+    std::string name;
+    long line_value;
+    long column_value;
+
+    if( line == NULL  ||  !parse_match( line->to_string( ), name, line_value, column_value ) ) {
+        error_message( "No file location on this line" );
+        return false;
+    }
+
+    if( FileList::lookup( name.c_str( ) ) == false  &&
+        FileList::new_file( name.c_str( ) ) == false ) {
+        error_message( "Can't open %s", name.c_str( ) );
+        return false;
+    }
+
+    YEditFile &the_file = FileList::active_file( );
+    the_file.CP( ).jump_to_line( line_value );
+    the_file.CP( ).jump_to_column( static_cast< unsigned >( column_value ) );
+    return true;
+}
+
+
 bool goto_line_end_command( )
 {
     FileList::active_file( ).end( );
@@ -3,13 +3,123 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cctype>
 #include <cstdlib>
+#include <string>
+#include <vector>
 
 #include "command.hpp"
 #include "FileList.hpp"
+#include "FilePosition.hpp"
+#include "global.hpp"
 #include "parameter_stack.hpp"
+#include "scr.hpp"
+#include "SearchPattern.hpp"
 #include "YEditFile.hpp"
 
+namespace {
+
+    //! The state of an incremental search after a keystroke.
+    struct SearchStep {
+        std::string  text;      //!< The text searched for.
+        FilePosition position;  //!< Where its match is (or where the search was when it failed).
+        bool         found;     //!< True if the text was found.
+    };
+
+    //! Shows the text being searched for on the bottom border of the screen.
+    void show_search_text( const SearchStep &step, const char *note )
+    {
+        const char *label = step.found ? "SEARCH FOR:" : "NOT FOUND:";
+        const int width = scr::number_of_columns( ) / 2;
+        scr::print_text( scr::number_of_rows( ), 3, width,
+                         " %s %s %s", label, step.text.c_str( ), note );
+    }
+
+}
+
+
+/*!
+ * Searches as the search string is typed. After each keystroke the cursor is moved to the first
+ * match at or after the cursor and the matches on the screen are highlighted. Backspace returns
+ * to the previous match, the up and down arrows move to the previous and next matches, Enter
+ * leaves the cursor at the match, and ESC returns the cursor to where it was.
+ *
+ * A match of a longer string is a match of every string it extends. When a character is added
+ * the search therefore starts at the previous match, and if the previous string wasn't found no
+ * search is done at all. Each step is remembered so that backspace needn't search either.
+ */
+bool incremental_search_command( )
+{
+    YEditFile &the_file = FileList::active_file( );
+    const FilePosition original_CP = the_file.CP( );
+
+    std::vector< SearchStep > steps( 1, SearchStep{ std::string( ), original_CP, true } );
+    const char *note = "";
+    int key;
+
+    do {
+        const SearchStep &current = steps.back( );
+        const SearchPattern pattern( current.text );
+        the_file.CP( ) = current.position;
+        the_file.display( );
+        show_search_text( current, note );
+        if( current.found ) the_file.show_matches( pattern );
+        note = "";
+
+        switch( key = scr::key( ) ) {
+        case scr::K_ESC:
+        case scr::K_RETURN:
+            break;
+
+        case scr::K_BACKSPACE:
+            if( steps.size( ) > 1 ) steps.pop_back( );
+            break;
+
+        case scr::K_DOWN:
+        case scr::K_UP:
+            if( current.found  &&  !current.text.empty( ) ) {
+                bool found;
+                if( key == scr::K_DOWN ) {
+                    the_file.CP( ).cursor_right( );
+                    found = the_file.simple_search( pattern );
+                }
+                else found = the_file.reverse_search( pattern );
+
+                if( found ) steps.push_back( SearchStep{ current.text, the_file.CP( ), true } );
+                else note = "(no more)";
+            }
+            break;
+
+        default:
+            if( key < 128  &&  std::isprint( key ) ) {
+                const char letter = static_cast< char >( key );
+                SearchStep next{ current.text + letter, current.position, false };
+                if( current.found ) {
+                    next.found = the_file.simple_search( SearchPattern( next.text ) );
+                    if( next.found ) next.position = the_file.CP( );
+                }
+                steps.push_back( next );
+            }
+            break;
+        }
+    } while( key != scr::K_ESC  &&  key != scr::K_RETURN );
+
+    if( key == scr::K_ESC ) {
+        the_file.CP( ) = original_CP;
+        return false;
+    }
+
+    // Let search_next continue from the match.
+    const SearchStep &last = steps.back( );
+    the_file.CP( ) = last.position;
+    if( !last.text.empty( ) ) {
+        search_pattern = SearchPattern( last.text );
+        search_set = true;
+    }
+    return last.found;
+}
+
+
 bool input_command( )
 {
     const char *input_string;
@@ -25,7 +25,9 @@ bool kill_file_command( )
         return false;
     }
 
-    // Make sure user knows if they are going to throw something out.
+    // Make sure user knows if they are going to throw something out. A file is changed again
+    // if its save failed.
+    FileList::finish_saves( );
     if( current.changed( ) ) {
         if( confirm_message( "Changes will be lost. Continue? [y]/n", 'N', false ) == false )
             return false;
@@ -13,9 +13,11 @@ bool quit_command( )
 {
     if( FileList::no_changes( ) ) std::exit( 0 );
     else {
-        // Be sure the user knows what he/she is doing.
-        if( confirm_message( "At least one file changed. Quit? y/[n]", 'Y', true ) == false )
+        // Be sure the user knows what he/she is doing. The changes won't be wanted later.
+        if( confirm_message( "At least one file changed. Quit? y/[n]", 'Y', true ) == false ) {
+            FileList::discard_journals( );
             std::exit( 0 );
+        }
     }
 
     return true;
@@ -154,8 +154,9 @@ bool refresh_file_command( )
 {
     bool return_value;
     YEditFile &the_file = FileList::active_file( );
-    FilePosition old_CP = the_file.CP( );
 
+    // Don't read the file while it is being saved.
+    FileList::finish_saves( );
     if( the_file.changed( ) ) {
         if( confirm_message( "Changes will be lost. Continue? [y]/n", 'N', false ) == false )
             return false;
@@ -164,23 +165,8 @@ bool refresh_file_command( )
     // Make sure block mode is off.
     the_file.set_block_state( false );
 
-    // Erase entire file.
-    the_file.top_of_file( );
-    the_file.toggle_block( );
-    the_file.bottom_of_file( );
-    the_file.delete_block( );
-    the_file.toggle_block( );
-
-    // Position cursor at the top of the file.
-    the_file.top_of_file( );
-
-    // Load the file.
-    return_value = the_file.load( the_file.name( ) );
-    the_file.set_timestamp( the_file.name( ) );
-    the_file.mark_as_unchanged( );
-
-    // Be sure cursor is positioned correctly.
-    the_file.CP( ) = old_CP;
+    // Only the lines that differ are replaced. The cursor stays with its line.
+    return_value = the_file.reload( the_file.name( ) );
 
     return return_value;
 }
@@ -196,7 +182,9 @@ bool remove_file_command( )
     }
 
     // Do the actual destruction if there is no problem with saving.
-    if( ( current.changed( ) ) ? current.save( current.name( ) ) : true ) {
+    FileList::finish_saves( );
+    if( ( current.changed( ) ) ?
+        current.save( current.name( ), YEditFile::ALL, YEditFile::ATOMIC ) : true ) {
         FileList::kill( );
     }
 
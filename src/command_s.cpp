@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 
 #include "command.hpp"
 #include "FileList.hpp"
@@ -18,14 +19,14 @@
 #include "YEditFile.hpp"
 
 
+//! Replaces the match at the current point, which is match_length characters long.
 static void do_replacement(
-    YEditFile &the_file, Parameter &search_parameter, Parameter &replace_parameter)
+    YEditFile &the_file, std::size_t match_length, Parameter &replace_parameter)
 {
-    std::string search_value = search_parameter.value( );
     std::string replace_value = replace_parameter.value( );
     unsigned i;
 
-    for( i = 0; i < search_value.length( ); i++ ) {
+    for( i = 0; i < match_length; i++ ) {
         the_file.delete_char( );
     }
     for( i = 0; i < replace_value.length( ); i++ ) {
@@ -36,18 +37,32 @@ static void do_replacement(
 }
 
 
+//! Prepares the search pattern from the search parameter. Returns false if it is invalid.
+static bool set_search_pattern( )
+{
+    search_pattern = SearchPattern( search_parameter.value( ), regex_search );
+    search_set = ( search_pattern.error( ) == NULL );
+    if( !search_set ) {
+        error_message( "%s", search_pattern.error( ) );
+    }
+    return search_set;
+}
+
+
 bool save_file_command( )
 {
     bool return_value;
     YEditFile &the_file = FileList::active_file( );
 
-    // If block mode is not on, just save the entire file under its normal name.
+    // If block mode is not on, save the entire file under its normal name. Editing can
+    // continue while the file is written. The result is reported when the save finishes.
     if( !the_file.get_block_state( ) ) {
-        return_value = the_file.save( the_file.name( ) );
-        if( return_value == true ) {
-            the_file.set_timestamp( the_file.name( ) );
-            the_file.mark_as_unchanged( );
+        if( the_file.read_only( ) ) {
+            error_message( "%s is read only", the_file.name( ) );
+            return false;
         }
+        FileList::save_in_background( the_file );
+        return_value = true;
     }
 
     // Otherwise prompt for a name and save the block.
@@ -70,6 +85,46 @@ bool save_file_command( )
 }
 
 
+bool search_all_files_command( )
+{
+    if( search_parameter.get( ) == false ) return false;
+    if( set_search_pattern( ) == false ) return false;
+
+    // The lines that match are shown in a results file. See goto_match.
+    const long count = FileList::search_all( search_pattern );
+    if( count == 0 ) {
+        info_message( "Not found" );
+        return false;
+    }
+    info_message( "%ld line%s found", count, ( count == 1 ) ? "" : "s" );
+    return true;
+}
+
+
+bool search_tree_command( )
+{
+    if( search_parameter.get( ) == false ) return false;
+    if( set_search_pattern( ) == false ) return false;
+
+    // The files are named by a directory and a wildcard pattern, for example "src/*.cpp".
+    static Parameter parameter( "IN FILES:" );
+    if( parameter.get( ) == false ) return false;
+    const std::string files = parameter.value( );
+
+    std::string directory = ".";
+    std::string wild_name = files;
+    const std::string::size_type separator = files.find_last_of( "/\\" );
+    if( separator != std::string::npos ) {
+        directory = ( separator == 0 ) ? files.substr( 0, 1 ) : files.substr( 0, separator );
+        wild_name = files.substr( separator + 1 );
+    }
+    if( wild_name.empty( ) ) wild_name = "*";
+
+    // The lines that match are shown as they are found. See goto_match.
+    return FileList::search_tree( search_pattern, directory.c_str( ), wild_name.c_str( ) );
+}
+
+
 bool search_and_replace_command( )
 {
     bool return_value = true;
@@ -79,8 +134,7 @@ bool search_and_replace_command( )
 
     // Get the search and replace strings.
     if( search_parameter.get( ) == false ) return false;
-    std::string search_value = search_parameter.value( );
-    search_set = true;
+    if( set_search_pattern( ) == false ) return false;
 
     if( replace_parameter.get( ) == false ) return false;
     std::string replace_value = replace_parameter.value( );
@@ -108,16 +162,17 @@ bool search_and_replace_command( )
     bool dont_question = false;   // =true when user says to do all.
     bool done;                    // =true when no more instances found.
     bool wiggle;                  // =true when CP must be adjusted to skip.
+    std::size_t match_length;     // The length of the instance found.
 
     // See if there's a match in the range of lines of interest.
-    done = static_cast< bool >( !the_file.simple_search( search_value.c_str( ) ) );
+    done = static_cast< bool >( !the_file.simple_search( search_pattern, match_length ) );
     if( the_file.CP( ).cursor_line( ) > bottom_line ) done = true;
 
     wiggle = true;
     while( !stop && !done ) {
 
         if( dont_question ) {
-            do_replacement( the_file, search_parameter, replace_parameter );
+            do_replacement( the_file, match_length, replace_parameter );
             wiggle = false;
         }
 
@@ -158,7 +213,7 @@ bool search_and_replace_command( )
                 // Fall through to do this replacement.
 
             default:
-                do_replacement( the_file, search_parameter, replace_parameter );
+                do_replacement( the_file, match_length, replace_parameter );
                 wiggle = false;
 
                 // Show the user the effect while s/he waits for next instance.
@@ -174,7 +229,7 @@ bool search_and_replace_command( )
             if( wiggle ) the_file.CP( ).cursor_right( );
 
             // Find the next instance.
-            done = static_cast< bool >( !the_file.simple_search( search_value.c_str( ) ) );
+            done = static_cast< bool >( !the_file.simple_search( search_pattern, match_length ) );
             if( the_file.CP( ).cursor_line( ) > bottom_line ) done = true;
 
             // Fix the CP adjustment if we are done so it looks nice for the user.
@@ -203,11 +258,10 @@ bool search_first_command( )
     YEditFile &the_file = FileList::active_file( );
 
     if( search_parameter.get( ) == false ) return false;
-    std::string search_value = search_parameter.value( );
-    search_set = true;
+    if( set_search_pattern( ) == false ) return false;
 
     // Do the actual search.
-    if( the_file.simple_search( search_value.c_str( ) ) == false ) {
+    if( the_file.simple_search( search_pattern ) == false ) {
         info_message( "Not found" );
         return_value = false;
     }
@@ -225,8 +279,7 @@ bool search_next_command( )
         return_value = false;
     }
     else {
-        std::string search_value = search_parameter.value( );
-        if( the_file.CP( ).cursor_right( ), the_file.simple_search( search_value.c_str( ) ) == false ) {
+        if( the_file.CP( ).cursor_right( ), the_file.simple_search( search_pattern ) == false ) {
             the_file.CP( ).cursor_left( );
             info_message( "Not found" );
             return_value = false;
@@ -236,6 +289,23 @@ bool search_next_command( )
 }
 
 
+bool search_previous_command( )
+{
+    bool return_value = true;
+    YEditFile &the_file = FileList::active_file( );
+
+    if( search_set == false ) {
+        error_message( "No search string set" );
+        return_value = false;
+    }
+    else if( the_file.reverse_search( search_pattern ) == false ) {
+        info_message( "Not found" );
+        return_value = false;
+    }
+    return return_value;
+}
+
+
 bool set_bookmark_command( )
 {
     FileList::set_bookmark( );
@@ -244,6 +314,22 @@ bool set_bookmark_command( )
 }
 
 
+bool set_parallel_load_command( )
+{
+    static Parameter parameter( "PARALLEL LOAD SIZE IN KB (0 FOR NEVER):" );
+    if( parameter.get( ) == false ) return false;
+    std::string parameter_value = parameter.value( );
+
+    const long size = std::atol( parameter_value.c_str( ) );
+    if( size < 0  ||  size > LONG_MAX / 1024 ) {
+        error_message( "Invalid size" );
+        return false;
+    }
+    DiskEditFile::parallel_load_size = size * 1024;
+    return true;
+}
+
+
 bool set_tab_command( )
 {
     static Parameter parameter( "NEW TAB DISTANCE:" );
@@ -5,6 +5,8 @@
 
 #include "command.hpp"
 #include "FileList.hpp"
+#include "global.hpp"
+#include "support.hpp"
 #include "YEditFile.hpp"
 
 bool tab_command( )
@@ -36,3 +38,11 @@ bool toggle_bookmark_command( )
     FileList::toggle_bookmark( );
     return true;
 }
+
+
+bool toggle_regex_command( )
+{
+    regex_search = !regex_search;
+    info_message( regex_search ? "Searching for regular expressions" : "Searching for text" );
+    return true;
+}
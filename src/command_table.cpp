@@ -23,93 +23,104 @@
 
 #include "command.hpp"
 #include "command_table.hpp"
+#include "FileList.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
+#include "YEditFile.hpp"
 
 struct DispatchTableEntry {
     const char *macro_word;
     bool ( *command_function )( );
+    bool        changes_text;  // True if the command changes the text of the active file.
 };
 
 
 static DispatchTableEntry command_table[] = {
-    { "add_text",           add_text_command           },
-    { "background_color",   background_color_command   },
-    { "backspace",          backspace_command          },
-    { "block_off",          block_off_command          },
-    { "copy",               copy_block_command         },
-    { "cursor_down",        CP_down_command            },
-    { "cursor_left",        CP_left_command            },
-    { "cursor_right",       CP_right_command           },
-    { "cursor_up",          CP_up_command              },
-    { "cut",                delete_block_command       },
-    { "define_key",         define_key_command         },
-    { "delete",             delete_command             },
-    { "delete_to_eol",      delete_EOL_command         },
-    { "delete_to_sol",      delete_SOL_command         },
-    { "editor_info",        editor_info_command        },
-    { "end_of_file",        goto_file_end_command      },
-    { "end_of_line",        goto_line_end_command      },
-    { "error_message",      error_message_command      },
-    { "execute_file",       execute_file_command       },
-    { "execute_macro",      execute_macro_command      },
-    { "exit",               exit_command               },
-    { "external_command",   external_command_command   },
-    { "external_filter",    filter_command             },
-    { "filelist_info",      filelist_info_command      },
-    { "file_info",          file_info_command          },
-    { "file_insert",        file_insert_command        },
-    { "find_file",          find_file_command          },
-    { "foreground_color",   foreground_color_command   },
-    { "goto_column",        goto_column_command        },
-    { "goto_line",          goto_line_command          },
-    { "help",               help_command               },
-    { "input",              input_command              },
-    { "insert_file",        insert_file_command        },
-    { "kill_file",          kill_file_command          },
-    { "legal_info",         legal_info_command         },
-    { "new_line",           new_line_command           },
-    { "next_file",          next_file_command          },
-    { "next_procedure",     next_procedure_command     },
-    { "page_down",          page_down_command          },
-    { "page_up",            page_up_command            },
-    { "paste",              paste_block_command        },
-    { "previous_file",      previous_file_command      },
-    { "previous_procedure", previous_procedure_command },
-    { "quit",               quit_command               },
-    { "redirect_from",      redirect_from_command      },
-    { "redirect_to",        redirect_to_command        },
-    { "reformat_paragraph", reformat_command           },
-    { "refresh_file",       refresh_file_command       },
-    { "remove_file",        remove_file_command        },
-    { "rename_file",        rename_file_command        },
-    { "restricted_mode",    restricted_mode_command    },
-    { "save_file",          save_file_command          },
-    { "search_first",       search_first_command       },
-    { "search_next",        search_next_command        },
-    { "search_replace",     search_and_replace_command },
-    { "set_mark",           set_bookmark_command       },
-    { "set_tab",            set_tab_command            },
-    { "start_of_line",      goto_line_start_command    },
-    { "tab",                tab_command                },
-    { "toggle_block",       toggle_block_command       },
-    { "toggle_mark",        toggle_bookmark_command    },
-    { "toggle_replace",     insert_command             },
-    { "top_of_file",        goto_file_start_command    },
-    { "word_left",          skip_left_command          },
-    { "word_right",         skip_right_command         },
-    { "yexit",              yexit_command              },
+    { "add_text",           add_text_command,           true  },
+    { "background_color",   background_color_command,   false },
+    { "backspace",          backspace_command,          true  },
+    { "block_off",          block_off_command,          false },
+    { "copy",               copy_block_command,         false },
+    { "cursor_down",        CP_down_command,            false },
+    { "cursor_left",        CP_left_command,            false },
+    { "cursor_right",       CP_right_command,           false },
+    { "cursor_up",          CP_up_command,              false },
+    { "cut",                delete_block_command,       true  },
+    { "define_key",         define_key_command,         false },
+    { "delete",             delete_command,             true  },
+    { "delete_to_eol",      delete_EOL_command,         true  },
+    { "delete_to_sol",      delete_SOL_command,         true  },
+    { "editor_info",        editor_info_command,        false },
+    { "end_of_file",        goto_file_end_command,      false },
+    { "end_of_line",        goto_line_end_command,      false },
+    { "error_message",      error_message_command,      false },
+    { "execute_file",       execute_file_command,       false },
+    { "execute_macro",      execute_macro_command,      false },
+    { "exit",               exit_command,               false },
+    { "external_command",   external_command_command,   false },
+    { "external_filter",    filter_command,             true  },
+    { "filelist_info",      filelist_info_command,      false },
+    { "file_info",          file_info_command,          false },
+    { "file_insert",        file_insert_command,        true  },
+    { "find_file",          find_file_command,          false },
+    { "follow_file",        follow_file_command,        false },
+    { "foreground_color",   foreground_color_command,   false },
+    { "goto_column",        goto_column_command,        false },
+    { "goto_line",          goto_line_command,          false },
+    { "goto_match",         goto_match_command,         false },
+    { "help",               help_command,               false },
+    { "incremental_search", incremental_search_command, false },
+    { "input",              input_command,              false },
+    { "insert_file",        insert_file_command,        true  },
+    { "kill_file",          kill_file_command,          false },
+    { "legal_info",         legal_info_command,         false },
+    { "new_line",           new_line_command,           true  },
+    { "next_file",          next_file_command,          false },
+    { "next_procedure",     next_procedure_command,     false },
+    { "page_down",          page_down_command,          false },
+    { "page_up",            page_up_command,            false },
+    { "paste",              paste_block_command,        true  },
+    { "previous_file",      previous_file_command,      false },
+    { "previous_procedure", previous_procedure_command, false },
+    { "quit",               quit_command,               false },
+    { "redirect_from",      redirect_from_command,      true  },
+    { "redirect_to",        redirect_to_command,        false },
+    { "reformat_paragraph", reformat_command,           true  },
+    { "refresh_file",       refresh_file_command,       false },
+    { "remove_file",        remove_file_command,        false },
+    { "rename_file",        rename_file_command,        false },
+    { "restricted_mode",    restricted_mode_command,    false },
+    { "save_file",          save_file_command,          false },
+    { "search_all_files",   search_all_files_command,   false },
+    { "search_first",       search_first_command,       false },
+    { "search_next",        search_next_command,        false },
+    { "search_previous",    search_previous_command,    false },
+    { "search_replace",     search_and_replace_command, true  },
+    { "search_tree",        search_tree_command,        false },
+    { "set_mark",           set_bookmark_command,       false },
+    { "set_parallel_load",  set_parallel_load_command,  false },
+    { "set_tab",            set_tab_command,            false },
+    { "start_of_line",      goto_line_start_command,    false },
+    { "tab",                tab_command,                true  },
+    { "toggle_block",       toggle_block_command,       false },
+    { "toggle_mark",        toggle_bookmark_command,    false },
+    { "toggle_regex",       toggle_regex_command,       false },
+    { "toggle_replace",     insert_command,             false },
+    { "top_of_file",        goto_file_start_command,    false },
+    { "word_left",          skip_left_command,          false },
+    { "word_right",         skip_right_command,         false },
+    { "yexit",              yexit_command,              false },
 
     // Parameter stack commands for the macro language.
-    { "drop",               drop_command               },
-    { "dup",                dup_command                },
-    { "xchg",               xchg_command               },
+    { "drop",               drop_command,               false },
+    { "dup",                dup_command,                false },
+    { "xchg",               xchg_command,               false },
 
     // Experimental for the moment.
-    { "getch",              getch_command              },
+    { "getch",              getch_command,              false },
 
     // Special marker at end.
-    { NULL,                 NULL                  }
+    { NULL,                 NULL,                       false }
 };
 
 
@@ -137,7 +148,8 @@ static int scan_table( const std::string &word )
 //! Performs actions corresponding to the specified word of macro text.
 /*!
  * If the word is a quoted string, it pushes the word onto the parameter stack. Otherwise it
- * looks up the word in the dispatch table and executes the appropriate function.
+ * looks up the word in the dispatch table and executes the appropriate function. Commands that
+ * change the text of the active file are refused if the file is read-only.
  */
 void handle_word( const EditBuffer &word )
 {
@@ -145,6 +157,14 @@ void handle_word( const EditBuffer &word )
 
     // Search the dispatch table.
     if( ( table_index = scan_table( word.to_string( ) ) ) != -1 ) {
+        if( command_table[table_index].changes_text ) {
+            YEditFile &the_file = FileList::active_file( );
+            if( the_file.read_only( ) ) {
+                error_message( "%s is read only", the_file.name( ) );
+                return;
+            }
+        }
+
         // TODO: Do something with the bool return value from the command function!
         command_table[table_index].command_function( );
     }
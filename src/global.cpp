@@ -68,6 +68,8 @@ void global_cleanup( )
 bool      yfile_flag   = false;
 Parameter search_parameter ( "SEARCH FOR:" );
 Parameter replace_parameter( "REPLACE WITH:" );
+SearchPattern search_pattern;               //!< The search string prepared for searching.
+bool      regex_search = false;     //!< =true when search strings are regular expressions.
 bool      search_set   = false;     //!< =true when search string is set.
 bool      replace_set  = false;     //!< =true when replace string is set.
 int       box_size     = 0;         //!< The number of cols used for the input box.
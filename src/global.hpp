@@ -8,6 +8,7 @@
 
 #include "parameter_stack.hpp"
 #include "mystack.hpp"
+#include "SearchPattern.hpp"
 
 extern bool yfile_flag;
   // =true if filelist.yfy is to be saved before external commands.
@@ -18,6 +19,11 @@ extern Parameter replace_parameter;
   // global.cpp to insure correct ordering of global object construction. In particular, the
   // constructors of these objects require that scr::Initialize() has already been called.
 
+extern SearchPattern search_pattern;
+  // The search string prepared for searching. It is made again whenever the search parameter is
+  // read.
+
+extern bool  regex_search; // =true when search strings are regular expressions.
 extern bool  search_set;   // =true when search string is set.
 extern bool  replace_set;  // =true when replace string is set.
 
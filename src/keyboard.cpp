@@ -3,13 +3,23 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cstring>
 
+#include "environ.hpp"
+
+#if eOPSYS == ePOSIX
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#endif
+
 #include "command.hpp"
 #include "FileList.hpp"
 #include "keyboard.hpp"
 #include "scr.hpp"
 #include "support.hpp"
+#include "TextBlock.hpp"
 #include "YEditFile.hpp"
 
 #define MAX_MACRO_LENGTH  256     // Max number of keystrokes in the keyboard macro.
@@ -45,6 +55,43 @@ public:
 };
 
 
+#if eOPSYS == ePOSIX
+// Estimated number of bytes Scr has read from the terminal but not yet returned as keys.
+static long scr_buffered = 0;
+
+//! Returns the number of bytes waiting to be read from the terminal.
+static long terminal_pending( )
+{
+    int count = 0;
+    if( ioctl( STDIN_FILENO, FIONREAD, &count ) < 0 ) return( 0 );
+    return( count );
+}
+#endif
+
+
+//! Reads a key from Scr, keeping track of the bytes Scr holds in its own buffer.
+/*!
+ * Scr reads the bytes of an escape sequence from the terminal before it decides what key they
+ * represent. If it doesn't recognize the sequence it returns the escape alone and keeps the
+ * rest for later calls. Pasted text may also be read in one piece. Those bytes can't be seen by
+ * poll( ), so they are counted here: a key that is a single character but took more than one
+ * byte from the terminal leaves the others with Scr. A special key is taken to have used all of
+ * the bytes it read.
+ */
+static int read_key( )
+{
+  #if eOPSYS == ePOSIX
+    const long before = terminal_pending( );
+    const int  key    = scr::key( );
+    const long used   = std::max( 0L, before - terminal_pending( ) );
+    if( key < 0x100 ) scr_buffered = std::max( 0L, scr_buffered + used - 1 );
+    return( key );
+  #else
+    return( scr::key( ) );
+  #endif
+}
+
+
 /*!
  * This function gets a keystroke from a NeverEndingSource object. It is complicated by the
  * mouse handling. Mouse activity is detected and handled here in a way which is transparent to
@@ -57,12 +104,52 @@ int NeverEndingSource::get_keystroke( )
 {
     // Display everytime a keystroke is obtained from a NeverEnding_Source.
     FileList::active_file().display();
-    
+
+    // Text missing from a file shown read only that another program shortened reads as null
+    // characters (see TextBlock::map).
+    #if eOPSYS == ePOSIX
+    if( TextBlock::shrank( ) ) warning_message( "A file shown read only was shortened" );
+    #endif
+
+    // Report on background saves and searches that finished while the last command was
+    // running. Until the user types something, check on saves and searches that are still
+    // running now and then, make the lines of files that are being loaded lazily, and bring
+    // files changed by other programs up to date. When the user pauses, write the changes
+    // recorded in the journals. If files can be watched, nothing is done while nothing changes.
+    // There is no waiting at all while Scr still holds bytes it read earlier (see read_key).
+    if( FileList::check_saves( ) ) FileList::active_file( ).display( );
+    if( FileList::check_searches( ) ) FileList::active_file( ).display( );
+    #if eOPSYS == ePOSIX
+    const int changes = FileList::changes_descriptor( );
+    bool loading = FileList::loads_pending( );
+    while( scr_buffered == 0 ) {
+        const bool polling = ( changes < 0  &&  FileList::follows_pending( ) );
+        const bool waiting =
+            ( polling  ||  FileList::saves_pending( )  ||  FileList::searches_pending( ) );
+        const bool journaling = FileList::journals_pending( );
+        const bool busy = ( loading  ||  waiting  ||  journaling );
+        if( !busy  &&  changes < 0 ) break;
+
+        pollfd events[2] = { { STDIN_FILENO, POLLIN, 0 }, { changes, POLLIN, 0 } };
+        const int timeout = loading ? 10 : ( waiting ? 100 : ( journaling ? 250 : -1 ) );
+        const int count = poll( events, ( changes < 0 ) ? 1 : 2, timeout );
+        if( count < 0  ||  ( events[0].revents != 0 ) ) break;
+        if( count == 0  &&  journaling ) FileList::flush_journals( );
+        if( loading ) loading = FileList::continue_loads( );
+        bool changed = FileList::check_saves( );
+        if( FileList::check_searches( ) ) changed = true;
+        if( ( polling  ||  events[1].revents != 0 )  &&  FileList::check_changes( ) ) changed = true;
+        if( changed ) FileList::active_file( ).display( );
+    }
+    #else
+    FileList::flush_journals( );
+    #endif
+
     // Read a keystroke.
-    int return_value = scr::key();
+    int return_value = read_key( );
 
     // If this is a quoted character, turn on it's MSB!
-    if( return_value == scr::K_CTRLQ ) return_value = scr::key( ) | 0x8000;
+    if( return_value == scr::K_CTRLQ ) return_value = read_key( ) | 0x8000;
     return return_value;
 }
 
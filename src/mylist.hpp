@@ -9,24 +9,53 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdlib>
+#include <new>
+#include <type_traits>
+
+#include "SlabPool.hpp"
 
 //! Doubly linked list template supporting a "current point."
 /*!
  * This template provides a fairly normally doubly linked list. However, unlike std::list, it
- * maintains a "current point" and allows (linear time) random access. This code also predates
- * Standard C++. It was created for Y many years agoe and is retained because eliminating it
- * would be more work than it would be worth (probably).
+ * maintains a "current point" and allows random access. This code also predates Standard C++.
+ * It was created for Y many years agoe and is retained because eliminating it would be more
+ * work than it would be worth (probably).
+ *
+ * In addition to being linked in sequence, the nodes of the list are organized as an implicit
+ * treap (a randomized binary search tree keyed by position). Each node records the number of
+ * nodes in its subtree. This allows random access, insertion, and erasure to be done in
+ * O(log n) expected time regardless of where in the list they occur. The priority of each node
+ * is computed from its address so it need not be stored. Short moves of the current point
+ * still just follow the links. A contiguous range of nodes can be moved from one list to
+ * another in O(log n) expected time no matter how many nodes are in the range.
+ *
+ * Nodes inserted at the end of the list (as when a file is loaded) are linked into the sequence
+ * at once but are only added to the tree when the tree is next needed. At that time the tree of
+ * all such pending nodes is built in linear time and merged with the main tree. Thus building a
+ * list from front to back costs O(1) per node.
+ *
+ * Nodes are allocated from a SlabPool owned by the list. Nodes released by one list can be
+ * reused by the same list without calling the system allocator. When the list is cleared or
+ * destroyed and its pool holds exactly the list's nodes, the whole pool is emptied at once
+ * instead of releasing the nodes one at a time. Moving the entire contents of one list into
+ * another moves the pool's slabs along with the nodes so this remains true. Moving only some
+ * of a list's nodes into another list leaves them in their own pool; the receiving list then
+ * releases its nodes one at a time until it is next cleared.
  */
 template< typename T >
 class List {
 private:
 
     //! Structure that holds the pointers that form the list.
+    /*!
+     * The sentinels are Links that are not part of the tree. Their tree members are unused.
+     */
     struct Link {
         Link *next;
         Link *previous;
-
-        virtual ~Link( );
+        Link *left;        //!< Left child in the tree (earlier nodes).
+        Link *right;       //!< Right child in the tree (later nodes).
+        long  weight;      //!< Number of nodes in the subtree rooted here.
     };
 
     //! Derived structure to hold an object of the desired type.
@@ -36,13 +65,35 @@ private:
         explicit Node( const T &existing ) : data( existing ) { }
     };
 
+    SlabPool *node_pool;  //!< Pool from which this list's nodes are allocated.
     Link *head;        //!< Points at head sentinel (Only a Link).
     Link *tail;        //!< Points at tail sentinel (Only a Link).
+    Link *root;        //!< Points at root of the tree (NULL if the list is empty).
+    long  pending;     //!< Number of nodes at the end of the list not yet in the tree.
     Link *current;     //!< Points at current point in list (Normally a Node).
     long  item_count;  //!< Number of items on the list ( >= 0).
     long  index;       //!< Index of current point ( >= 0).
+    bool  mixed;       //!< True if the list may hold nodes from other lists' pools.
+
+    //! Moves of the current point shorter than this are done by following the links.
+    static const long walk_limit = 32L;
 
     void initialize( );
+    Link *new_node( const T &new_data );
+    static void delete_node( Link *old );
+
+    // Tree management.
+    static long weight_of( const Link *subtree )
+        { return( subtree == NULL ? 0L : subtree->weight ); }
+    static void update( Link *subtree )
+        { subtree->weight = 1L + weight_of( subtree->left ) + weight_of( subtree->right ); }
+    static std::size_t priority( const Link * );
+    static void  split( Link *subtree, long count, Link *&left, Link *&right );
+    static Link *merge( Link *left, Link *right );
+    static Link *insert_at( Link *subtree, long position, Link *fresh );
+    static Link *erase_at( Link *subtree, long position );
+    Link *select( long position ) const;
+    void  settle( );
 
 public:
     List( );
@@ -56,6 +107,7 @@ public:
     T *insert( const T &new_data );
     void erase( );
     void clear( );
+    void splice( List &source, long count );
 
     //! Returns a pointer to the object at the current point.
     T *get( );
@@ -68,6 +120,10 @@ public:
     long  size( ) const
         { return( item_count ); }
 
+    //! Returns the counters of the pool from which this list's nodes are allocated.
+    const SlabPool::Statistics &node_statistics( ) const
+        { return( node_pool->statistics( ) ); }
+
     //! Special index used to represent the next new slot.
     static const long off_end = -1L;
 
@@ -113,8 +169,185 @@ inline T *List< T >::get( )
 /*           Private Members           */
 /*=====================================*/
 
-template< typename T > List< T >::Link::~Link( )
-  { return; }
+//! Computes the tree priority of a node.
+/*!
+ * The priority is a hash of the node's address. This gives priorities that are effectively
+ * random without requiring any storage in the nodes.
+ */
+template< typename T >
+std::size_t List< T >::priority( const Link *node )
+{
+    std::size_t key = reinterpret_cast< std::size_t >( node );
+    key ^= key >> 33;
+    key *= static_cast< std::size_t >( 0xff51afd7ed558ccdULL );
+    key ^= key >> 33;
+    key *= static_cast< std::size_t >( 0xc4ceb9fe1a85ec53ULL );
+    key ^= key >> 33;
+    return( key );
+}
+
+
+//! Splits a tree into two trees.
+/*!
+ * \param subtree The tree to split.
+ * \param count The number of nodes to put into the left tree.
+ * \param left Set to the tree holding the first count nodes.
+ * \param right Set to the tree holding the remaining nodes.
+ */
+template< typename T >
+void List< T >::split( Link *subtree, const long count, Link *&left, Link *&right )
+{
+    if( subtree == NULL ) {
+        left = right = NULL;
+        return;
+    }
+    const long left_weight = weight_of( subtree->left );
+    if( count <= left_weight ) {
+        split( subtree->left, count, left, subtree->left );
+        right = subtree;
+    }
+    else {
+        split( subtree->right, count - left_weight - 1, subtree->right, right );
+        left = subtree;
+    }
+    update( subtree );
+}
+
+
+//! Joins two trees. All nodes in the left tree come before all nodes in the right tree.
+/*!
+ * \return The root of the combined tree.
+ */
+template< typename T >
+typename List< T >::Link *List< T >::merge( Link *left, Link *right )
+{
+    if( left  == NULL ) return right;
+    if( right == NULL ) return left;
+    if( priority( left ) > priority( right ) ) {
+        left->right = merge( left->right, right );
+        update( left );
+        return left;
+    }
+    else {
+        right->left = merge( left, right->left );
+        update( right );
+        return right;
+    }
+}
+
+
+//! Inserts a node into a tree.
+/*!
+ * \param subtree The tree receiving the new node.
+ * \param position The index the new node is to have in the tree.
+ * \param fresh The new node.
+ * \return The root of the resulting tree.
+ */
+template< typename T >
+typename List< T >::Link *List< T >::insert_at( Link *subtree, const long position, Link *fresh )
+{
+    if( subtree == NULL || priority( fresh ) > priority( subtree ) ) {
+        split( subtree, position, fresh->left, fresh->right );
+        update( fresh );
+        return fresh;
+    }
+    const long left_weight = weight_of( subtree->left );
+    if( position <= left_weight ) {
+        subtree->left = insert_at( subtree->left, position, fresh );
+    }
+    else {
+        subtree->right = insert_at( subtree->right, position - left_weight - 1, fresh );
+    }
+    ++subtree->weight;
+    return subtree;
+}
+
+
+//! Removes a node from a tree. The node itself is not deleted.
+/*!
+ * \param subtree The tree containing the node.
+ * \param position The index of the node in the tree.
+ * \return The root of the resulting tree.
+ */
+template< typename T >
+typename List< T >::Link *List< T >::erase_at( Link *subtree, const long position )
+{
+    const long left_weight = weight_of( subtree->left );
+    if( position == left_weight ) {
+        return merge( subtree->left, subtree->right );
+    }
+    if( position < left_weight ) {
+        subtree->left = erase_at( subtree->left, position );
+    }
+    else {
+        subtree->right = erase_at( subtree->right, position - left_weight - 1 );
+    }
+    --subtree->weight;
+    return subtree;
+}
+
+
+//! Locates the node with a given index.
+/*!
+ * \param position The index of the desired node. Must be in the range [0, item_count).
+ */
+template< typename T >
+typename List< T >::Link *List< T >::select( long position ) const
+{
+    Link *subtree = root;
+    for( ;; ) {
+        const long left_weight = weight_of( subtree->left );
+        if( position == left_weight ) return subtree;
+        if( position < left_weight ) {
+            subtree = subtree->left;
+        }
+        else {
+            position -= left_weight + 1;
+            subtree = subtree->right;
+        }
+    }
+}
+
+
+//! Adds any pending nodes to the tree.
+/*!
+ * The pending nodes are built into a separate tree in linear time by keeping the right spine of
+ * that tree on a stack. If the spine becomes unusually deep the tree built so far is merged
+ * into the main tree and a new tree is started.
+ */
+template< typename T >
+void List< T >::settle( )
+{
+    if( pending == 0L ) return;
+
+    // Find the first pending node.
+    Link *node = tail;
+    for( long i = 0; i < pending; ++i ) node = node->previous;
+
+    const int spine_limit = 64;
+    Link     *spine[spine_limit];
+    int       depth = 0;
+    for( ; node != tail; node = node->next ) {
+
+        // Nodes of lower priority on the spine become the left subtree of the new node.
+        Link *last = NULL;
+        while( depth > 0  &&  priority( spine[depth - 1] ) < priority( node ) ) {
+            last = spine[--depth];
+            update( last );
+        }
+        if( depth == spine_limit ) {
+            while( depth > 0 ) update( spine[--depth] );
+            root = merge( root, spine[0] );
+        }
+        node->left  = last;
+        node->right = NULL;
+        if( depth > 0 ) spine[depth - 1]->right = node;
+        spine[depth++] = node;
+    }
+    while( depth > 0 ) update( spine[--depth] );
+    root    = merge( root, spine[0] );
+    pending = 0L;
+}
 
 
 //! Prepares the list for use. Called by constructors.
@@ -124,13 +357,17 @@ template< typename T > List< T >::Link::~Link( )
 template< typename T >
 void List< T >::initialize( )
 {
+    node_pool = SlabPool::make( sizeof( Node ) );
     head = new Link;
     tail = new Link;
 
     // Initialize the members of the list object.
+    root       = NULL;
+    pending    = 0L;
     current    = tail;
     item_count = 0L;
     index      = 0L;
+    mixed      = false;
 
     // Link the sentinels.
     head->previous = head;
@@ -139,6 +376,34 @@ void List< T >::initialize( )
     tail->previous = head;
 }
 
+
+//! Allocates a node from the pool and copies the given data into it.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+template< typename T >
+typename List< T >::Link *List< T >::new_node( const T &new_data )
+{
+    void *const raw = node_pool->allocate( );
+    try {
+        return new( raw ) Node( new_data );
+    }
+    catch( ... ) {
+        SlabPool::release( raw );
+        throw;
+    }
+}
+
+
+//! Destroys a node and returns its memory to the pool it came from.
+template< typename T >
+void List< T >::delete_node( Link *old )
+{
+    Node *const old_node = static_cast< Node * >( old );
+    old_node->~Node( );
+    SlabPool::release( old_node );
+}
+
 /*====================================*/
 /*           Public Members           */
 /*====================================*/
@@ -186,11 +451,15 @@ List< T > &List< T >::operator=( const List &existing )
     while( ( object_ptr = stepper( ) ) != NULL ) {
         temp.insert( *object_ptr );
     }
+    std::swap( node_pool,  temp.node_pool  );
     std::swap( head,       temp.head       );
     std::swap( tail,       temp.tail       );
+    std::swap( root,       temp.root       );
+    std::swap( pending,    temp.pending    );
     std::swap( current,    temp.current    );
     std::swap( item_count, temp.item_count );
     std::swap( index,      temp.index      );
+    std::swap( mixed,      temp.mixed      );
 
     return *this;
 }
@@ -203,18 +472,17 @@ List< T >::~List( )
     clear();
     delete head;
     delete tail;
+    node_pool->detach( );
 }
 
 
 //! Moves the current point to the specified index.
 /*!
- * This function allows random indexing into a list. It is "smart" in that it will use next() or
- * previous() from the closest of three possible points: The head, the tail, or the current
- * point. For example, if the desired index is only 100 nodes from the current point and 10000
- * nodes from either end, this function will start at the current point. Yet, if the desired
- * index in only 100 nodes from the tail (and 10000 nodes from the current point), it will start
- * at the tail. If the given index is out of bounds, the current point is left just past the end
- * of the list.
+ * This function allows random indexing into a list. If the desired index is close to one of
+ * three possible points (the head, the tail, or the current point) the current point is moved
+ * there by following the links from the closest of those points. Otherwise the node is located
+ * by searching the tree in O(log n) expected time. If the given index is out of bounds, the
+ * current point is left just past the end of the list.
  *
  * \param new_index The desired location of the current point (zero based).
  */
@@ -248,6 +516,14 @@ void List< T >::jump_to( const long new_index )
         min        = distances[TAIL];
     }
 
+    // Long moves are done by searching the tree.
+    if( min >= walk_limit ) {
+        settle( );
+        current = select( new_index );
+        index   = new_index;
+        return;
+    }
+
     // Do the actual work of moving the current point.
     switch( best_start ) {
     case HEAD:
@@ -316,14 +592,19 @@ T *List< T >::previous( )
 template< typename T >
 T *List< T >::insert( const T &new_data )
 {
-    Node *const fresh = new Node( new_data );
+    Link *const fresh = new_node( new_data );
+    if( current == tail ) ++pending;
+    else {
+        settle( );
+        root = insert_at( root, index, fresh );
+    }
     item_count++;
     fresh->next             = current;
     fresh->previous         = current->previous;
     current->previous->next = fresh;
     current->previous       = fresh;
     index++;
-    return( &fresh->data );
+    return( &static_cast< Node * >( fresh )->data );
 }
 
 
@@ -337,11 +618,13 @@ void List< T >::erase( )
     if( current == tail ) return;
     Link *old = current;
 
+    settle( );
+    root = erase_at( root, index );
     current = current->next;
     old->previous->next = current;
     current->previous = old->previous;
     item_count--;
-    delete old;
+    delete_node( old );
 }
 
 
@@ -353,22 +636,96 @@ template< typename T >
 void List< T >::clear( )
 {
     Link *temp;
-    
-    // Trash all the nodes in the list.
+
+    // If the pool holds nothing but this list's nodes, destroy the nodes and empty the pool in
+    // one step. Otherwise each node must go back to the pool it came from.
+    const bool sole_user =
+        !mixed  &&  node_pool->statistics( ).live == static_cast< std::size_t >( item_count );
     current = head->next;
+    if( sole_user ) {
+        if( !std::is_trivially_destructible< Node >::value ) {
+            for( ; current != tail; current = current->next ) {
+                static_cast< Node * >( current )->~Node( );
+            }
+        }
+        node_pool->release_all( );
+        current = tail;
+    }
     while( current->next != current ) {
         temp = current;
         current = current->next;
-        delete temp;
+        delete_node( temp );
     }
 
     // Make sure these members are correct.
+    root       = NULL;
+    pending    = 0L;
     item_count = 0L;
     index      = 0L;
+    mixed      = false;
 
     // Make sure the head and tail sentinels are linked together!
     head->next     = tail;
     tail->previous = head;
 }
 
+
+
+//! Moves a range of items from another list into this list.
+/*!
+ * The items starting at the source list's current point are unlinked from the source list and
+ * linked into this list before this list's current point, in the same order. No items are
+ * copied and no nodes are allocated or released. The source list's current point is left at
+ * the item that followed the range. This list's current point is advanced past the new items
+ * so it still refers to the same item it did before. The time required does not depend on the
+ * number of items moved, except that when all of the source list's items are moved the slabs
+ * holding them are moved to this list's pool (see the class description).
+ *
+ * \param source The list giving up the items. Must not be this list.
+ * \param count The number of items to move. If fewer than count items follow the source
+ * list's current point, only those items are moved.
+ */
+template< typename T >
+void List< T >::splice( List &source, long count )
+{
+    if( &source == this ) return;
+    count = std::min( count, source.item_count - source.index );
+    if( count <= 0L ) return;
+    settle( );
+    source.settle( );
+
+    // Locate the ends of the range and remove it from the source tree.
+    Link *const first = source.current;
+    Link *const last  = source.select( source.index + count - 1 );
+    Link *left;
+    Link *range;
+    Link *right;
+    split( source.root, source.index, left, range );
+    split( range, count, range, right );
+    source.root = merge( left, right );
+
+    // Unlink the range from the source sequence.
+    first->previous->next = last->next;
+    last->next->previous  = first->previous;
+    source.current        = last->next;
+    source.item_count    -= count;
+
+    // Take the source's slabs if they hold exactly the nodes being moved. Otherwise this list
+    // now holds nodes from another pool.
+    const bool whole_pool = source.item_count == 0L  &&  !source.mixed  &&
+        source.node_pool->statistics( ).live == static_cast< std::size_t >( count );
+    if( !whole_pool  ||  !node_pool->absorb( *source.node_pool ) ) mixed = true;
+    if( source.item_count == 0L ) source.mixed = false;
+
+    // Add the range to this tree and link it into the sequence before the current point.
+    split( root, index, left, right );
+    root = merge( merge( left, range ), right );
+    first->previous         = current->previous;
+    last->next              = current;
+    current->previous->next = first;
+    current->previous       = last;
+    item_count += count;
+    index      += count;
+}
+
 #endif
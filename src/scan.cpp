@@ -0,0 +1,97 @@
+/*! \file    scan.cpp
+ *  \brief   Implementation of the fast text scanning functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <bit>
+#include "scan.hpp"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+//! Finds the first byte that ends a line or that must be processed when a line is loaded.
+/*!
+ * \param text Pointer to the first byte to examine.
+ * \param end Pointer just past the last byte to examine.
+ * \return Pointer to the first newline or raw byte (see is_raw_byte) in [text, end), or end if
+ * there are none.
+ */
+const char *find_line_special( const char *text, const char *const end )
+{
+#ifdef SCAN_SSE2
+    const __m128i newlines = _mm_set1_epi8( '\n' );
+    const __m128i tabs     = _mm_set1_epi8( '\t' );
+    const __m128i nulls    = _mm_setzero_si128( );
+
+    // Each byte of a match vector is all ones if the byte of text matches. The high bit of each
+    // byte of the text itself marks the non-ASCII characters.
+    while( end - text >= 16 ) {
+        const __m128i chunk = _mm_loadu_si128( reinterpret_cast< const __m128i * >( text ) );
+        const __m128i found = _mm_or_si128(
+            _mm_or_si128( _mm_cmpeq_epi8( chunk, newlines ), _mm_cmpeq_epi8( chunk, tabs ) ),
+            _mm_or_si128( _mm_cmpeq_epi8( chunk, nulls ), chunk ) );
+        const unsigned mask = static_cast< unsigned >( _mm_movemask_epi8( found ) );
+        if( mask != 0 ) return( text + std::countr_zero( mask ) );
+        text += 16;
+    }
+#endif
+
+    while( text != end  &&  *text != '\n'  &&  !is_raw_byte( *text ) ) ++text;
+    return( text );
+}
+
+
+//! Finds the start of the run of spaces at the end of some text.
+/*!
+ * The text is scanned backwards from the end so the cost depends only on the number of
+ * trailing spaces.
+ *
+ * \param text Pointer to the first byte of the text.
+ * \param end Pointer just past the last byte of the text.
+ * \return Pointer just past the last byte in [text, end) that is not a space, or text if all
+ * the bytes are spaces.
+ */
+const char *find_trailing_spaces( const char *const text, const char *end )
+{
+#ifdef SCAN_SSE2
+    const __m128i spaces = _mm_set1_epi8( ' ' );
+
+    // Skip entire chunks of spaces. The last chunk examined might contain a non-space.
+    while( end - text >= 16 ) {
+        const __m128i chunk = _mm_loadu_si128( reinterpret_cast< const __m128i * >( end - 16 ) );
+        const unsigned mask =
+            static_cast< unsigned >( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, spaces ) ) );
+        if( mask != 0xFFFF ) return( end - std::countl_one( mask << 16 ) );
+        end -= 16;
+    }
+#endif
+
+    while( end != text  &&  *( end - 1 ) == ' ' ) --end;
+    return( end );
+}
+
+
+//! Makes the text of a line from raw text, as it is when the line is loaded.
+/*!
+ * Null characters and non-ASCII characters are removed (note that control characters are
+ * kept). Tabs are expanded assuming 8 column tab stops.
+ *
+ * \param text Pointer to the first byte of the raw text. It must not contain a newline.
+ * \param length The number of bytes of raw text.
+ * \param result Receives the cooked text, replacing whatever it held.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void cook_text( const char *const text, const std::size_t length, std::string &result )
+{
+    result.clear( );
+    for( std::size_t i = 0; i < length; ++i ) {
+        const char ch = text[i];
+        if( ch == '\0' || ( ch & 0x80 ) ) continue;
+        if( ch != '\t' ) result.push_back( ch );
+        else {
+            result.append( 8 - ( result.size( ) % 8 ), ' ' );
+        }
+    }
+}
@@ -0,0 +1,29 @@
+/*! \file    scan.hpp
+ *  \brief   Fast scanning of raw text.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * The functions here examine large amounts of text, such as the contents of a file, and are
+ * written to be as fast as possible. Where the platform allows, they examine many bytes at once
+ * using vector instructions. Otherwise they fall back to a simple loop.
+ */
+
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <cstddef>
+#include <string>
+
+//! Returns true if a byte must be processed before it can appear in a line of a file.
+/*!
+ * Tabs must be expanded, and null characters and non-ASCII characters must be removed.
+ */
+inline bool is_raw_byte( const char ch )
+{
+    return( ch == '\t'  ||  ch == '\0'  ||  ( ch & 0x80 ) );
+}
+
+const char *find_line_special( const char *text, const char *end );
+const char *find_trailing_spaces( const char *text, const char *end );
+void cook_text( const char *text, std::size_t length, std::string &result );
+
+#endif
@@ -500,3 +500,33 @@ bool SCALA_YEditFile::insert_char( char letter )
     }
     return true;
 }
+
+
+//! Replaces the text of the file with the given lines and moves to the first of them.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void RESULTS_YEditFile::set_results( const std::vector< std::string > &results )
+{
+    file_data.clear( );
+    for( const std::string &result : results ) {
+        file_data.insert( new EditBuffer( result.data( ), result.size( ) ) );
+    }
+    current_point.jump_to_line( 0 );
+    current_point.jump_to_column( 0 );
+    set_block_state( false );
+    is_changed = false;
+}
+
+
+//! Adds lines to the end of the file without moving the cursor.
+/*!
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void RESULTS_YEditFile::add_results( const std::vector< std::string > &results )
+{
+    file_data.set_end( );
+    for( const std::string &result : results ) {
+        file_data.insert( new EditBuffer( result.data( ), result.size( ) ) );
+    }
+}
@@ -6,6 +6,9 @@
 #ifndef SPECIAL_HPP
 #define SPECIAL_HPP
 
+#include <string>
+#include <vector>
+
 #include "scr.hpp"
 #include "YEditFile.hpp"
 
@@ -63,6 +66,20 @@ public:
     virtual bool previous_procedure( );
 };
 
+//! Shows the results of a search. Each line describes a match (see format_match).
+/*!
+ * Results files are made by the editor rather than loaded. They are never watched or
+ * journaled, and they are left unchanged so that they are only saved if the user asks.
+ */
+class RESULTS_YEditFile : public YEditFile {
+public:
+    RESULTS_YEditFile( const char *file_name ) :
+        YEditFile( file_name, 8, scr::WHITE ) { }
+
+    void set_results( const std::vector< std::string > &results );
+    void add_results( const std::vector< std::string > &results );
+};
+
 //! For now the SCALA_YEditFile is a copy of C_YEditFile. This won't be true forever, however.
 class SCALA_YEditFile : public YEditFile {
 private: